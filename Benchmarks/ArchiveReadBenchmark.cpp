@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+
+#include "SyntheticScene.h"
+
+#include "BufferedOutputStream.h"
+#include "MappedFile.h"
+#include "MemoryStream.h"
+#include "IO/InputArchive.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Reads the file in small blocks, so that both backends start from a warm page cache without raising peak RSS.
+void WarmPageCache(const std::filesystem::path &filePath) {
+	std::ifstream fin(filePath, std::ios::in | std::ios::binary);
+	std::vector<char> block(1024 * 1024);
+	while(fin.read(block.data(), static_cast<std::streamsize>(block.size())) || fin.gcount() > 0) {
+	}
+}
+
+struct ReadResult
+{
+	double m_milliseconds = 0.0;
+	uint64_t m_checksum = 0;
+	uint64_t m_peakResidentBytes = 0;
+};
+
+ReadResult ReadWithIfstream(const std::filesystem::path &filePath) {
+	BenchmarkTimer timer;
+	std::ifstream fin(filePath, std::ios::in | std::ios::binary);
+	uint8_t fileEndian;
+	fin.read(reinterpret_cast<char *>(&fileEndian), sizeof(fileEndian));
+
+	std::vector<SyntheticScene::MeshStreams> meshes;
+	cd::InputArchive inputArchive(&fin);
+	ReadResult result;
+	result.m_checksum = SyntheticScene::Read(inputArchive, meshes);
+	result.m_milliseconds = timer.GetMilliseconds();
+	result.m_peakResidentBytes = GetPeakResidentBytes();
+	return result;
+}
+
+ReadResult ReadWithMapping(const std::filesystem::path &filePath) {
+	BenchmarkTimer timer;
+	MappedFile file(filePath.string().c_str());
+	MemoryInputStream stream(file.GetData(), file.GetSize());
+	uint8_t fileEndian;
+	stream.read(reinterpret_cast<char *>(&fileEndian), sizeof(fileEndian));
+
+	std::vector<SyntheticScene::MeshStreams> meshes;
+	cd::InputArchive inputArchive(&stream);
+	ReadResult result;
+	result.m_checksum = SyntheticScene::Read(inputArchive, meshes);
+	result.m_milliseconds = timer.GetMilliseconds();
+	result.m_peakResidentBytes = GetPeakResidentBytes();
+	return result;
+}
+
+}
+
+bool RunArchiveReadBenchmark(const BenchmarkArguments &arguments) {
+	const uint64_t megabytes = GetNumberArgument(arguments, 0, 256);
+	const std::string backend = GetStringArgument(arguments, 1, "both");
+
+	const uint32_t meshCount = SyntheticScene::GetMeshCount(megabytes);
+
+	const std::filesystem::path filePath = std::filesystem::temp_directory_path() / "CDSDK_ArchiveReadBenchmark.bin";
+	{
+		std::ofstream fout(filePath, std::ios::out | std::ios::binary);
+		BufferedOutputStream stream(fout);
+		SyntheticScene::Write(stream, meshCount);
+	}
+	const uint64_t fileBytes = std::filesystem::file_size(filePath);
+	printf("Synthetic scene : %u nodes, %u meshes, %.1f MiB, warm page cache\n", SyntheticScene::NodeCount, meshCount, fileBytes / (1024.0 * 1024.0));
+	WarmPageCache(filePath);
+
+	bool succeeded = true;
+	uint64_t referenceChecksum = 0;
+	auto report = [&](const char *pName, const ReadResult &result) {
+		printf("  %-8s : %8.1f ms, %7.1f MiB/s, peak RSS %.1f MiB\n", pName, result.m_milliseconds,
+			fileBytes / (1024.0 * 1024.0) / (result.m_milliseconds / 1000.0), result.m_peakResidentBytes / (1024.0 * 1024.0));
+		if(referenceChecksum != 0 && result.m_checksum != referenceChecksum) {
+			printf("  %s read different data\n", pName);
+			succeeded = false;
+		}
+		referenceChecksum = result.m_checksum;
+	};
+
+	if("ifstream" == backend || "both" == backend) {
+		report("ifstream", ReadWithIfstream(filePath));
+	}
+	if("mapped" == backend || "both" == backend) {
+		report("mapped", ReadWithMapping(filePath));
+	}
+
+	std::error_code errorCode;
+	std::filesystem::remove(filePath, errorCode);
+	return succeeded;
+}
@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include "SyntheticScene.h"
+
+#include "BufferedOutputStream.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+
+struct WriteResult
+{
+	double m_milliseconds = 0.0;
+	uint64_t m_fileBytes = 0;
+};
+
+// ofstream keeps its filebuf's own small buffer, which is what CDConsumer writes through.
+// unbuffered turns that buffer off so that every archive field becomes a write to the file.
+// buffered puts BufferedOutputStream in front of the ofstream.
+WriteResult WriteScene(const std::filesystem::path &filePath, const std::string &backend, uint32_t meshCount) {
+	BenchmarkTimer timer;
+	{
+		std::ofstream fout;
+		if("unbuffered" == backend) {
+			fout.rdbuf()->pubsetbuf(nullptr, 0);
+		}
+		fout.open(filePath, std::ios::out | std::ios::binary);
+
+		if("buffered" == backend) {
+			BufferedOutputStream stream(fout);
+			SyntheticScene::Write(stream, meshCount);
+			stream.Flush();
+		}
+		else {
+			SyntheticScene::Write(fout, meshCount);
+		}
+	}
+
+	WriteResult result;
+	result.m_milliseconds = timer.GetMilliseconds();
+	result.m_fileBytes = std::filesystem::file_size(filePath);
+	return result;
+}
+
+}
+
+bool RunArchiveWriteBenchmark(const BenchmarkArguments &arguments) {
+	const uint64_t megabytes = GetNumberArgument(arguments, 0, 64);
+	const std::string backend = GetStringArgument(arguments, 1, "all");
+	const uint32_t meshCount = SyntheticScene::GetMeshCount(megabytes);
+	printf("Synthetic scene : %u nodes, %u meshes\n", SyntheticScene::NodeCount, meshCount);
+
+	bool succeeded = true;
+	uint64_t referenceBytes = 0;
+	for(const char *pBackend : { "ofstream", "unbuffered", "buffered" }) {
+		if(backend != pBackend && backend != "all") {
+			continue;
+		}
+
+		// Each backend gets its own file, truncating the previous one's dirty pages would be timed otherwise.
+		const std::filesystem::path filePath = std::filesystem::temp_directory_path() / ("CDSDK_ArchiveWriteBenchmark_" + std::string(pBackend) + ".bin");
+		const WriteResult result = WriteScene(filePath, pBackend, meshCount);
+		std::error_code errorCode;
+		std::filesystem::remove(filePath, errorCode);
+
+		printf("  %-10s : %8.1f ms, %7.1f MiB/s, %.1f MiB\n", pBackend, result.m_milliseconds,
+			result.m_fileBytes / (1024.0 * 1024.0) / (result.m_milliseconds / 1000.0), result.m_fileBytes / (1024.0 * 1024.0));
+		if(referenceBytes != 0 && result.m_fileBytes != referenceBytes) {
+			printf("  %s wrote a different amount of data\n", pBackend);
+			succeeded = false;
+		}
+		referenceBytes = result.m_fileBytes;
+	}
+
+	return succeeded;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Console benchmarks and checks of the example's CPU side systems, run by CDSDK_Benchmarks.
+// Each one prints its results and returns false when a correctness check fails, which makes the process exit with 1.
+
+using BenchmarkArguments = std::vector<std::string>;
+
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer() : m_start(std::chrono::steady_clock::now()) {}
+
+	void Restart() { m_start = std::chrono::steady_clock::now(); }
+
+	double GetMilliseconds() const {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// Peak resident set size of the process so far, 0 where the platform doesn't report it.
+uint64_t GetPeakResidentBytes();
+
+// Argument at index converted to an unsigned number, defaultValue when it is missing or not a number.
+uint64_t GetNumberArgument(const BenchmarkArguments &arguments, std::size_t index, uint64_t defaultValue);
+
+// Argument at index, defaultValue when it is missing.
+std::string GetStringArgument(const BenchmarkArguments &arguments, std::size_t index, const char *pDefaultValue);
+
+// archive-read [megabytes] [ifstream|mapped|both]
+// Reads a synthetic scene stream through cd::InputArchive over an ifstream, as CDProducer does,
+// and over a MappedFile, as MappedCDProducer does. Peak RSS is per process, run one backend per process to compare it.
+bool RunArchiveReadBenchmark(const BenchmarkArguments &arguments);
+
+// archive-write [megabytes] [ofstream|unbuffered|buffered|all]
+// Writes the same synthetic scene stream through cd::OutputArchive over a plain ofstream, an ofstream with its buffer
+// turned off, and BufferedOutputStream, then compares the wall time including the close.
+bool RunArchiveWriteBenchmark(const BenchmarkArguments &arguments);
+
+// hash [megabytes] [file]
+// Hashes a random file of that size, or the given file, with cd::FileHash, the portable Sha256, the SHA-NI one,
+// Sha256File and Sha256FileTree on several thread counts, and checks that the digests agree.
+bool RunHashBenchmark(const BenchmarkArguments &arguments);
+
+// light-cluster [lightCount] [iterations]
+// Checks LightClusterBuilder's cluster and index lists against a brute force overlap test of every light with the
+// view space box of every cluster, then times Build on the calling thread and on a ThreadPool started beforehand.
+bool RunLightClusterBenchmark(const BenchmarkArguments &arguments);
+
+// frustum-cull [boxCount] [iterations]
+// Computes world bounds of random meshes with CullingBoxes::AddTransformed, as GLScene::UpdateBounds does, then checks
+// FrustumCuller::Cull against a scalar loop over the frustum planes and SceneBVH::QueryFrustum against Cull, and times them.
+bool RunFrustumCullBenchmark(const BenchmarkArguments &arguments);
+
+// triangle-ray [triangleCount] [rayCount] [checkedRayCount]
+// Builds a TriangleBVH over synthetic spheres of 8K, 131K and 2M triangles, or of triangleCount, and casts random rays
+// at them with the SSE and AVX packet tests. Reports rays per second and checks hits against brute force Moller-Trumbore.
+bool RunTriangleRayBenchmark(const BenchmarkArguments &arguments);
+
+// texture-decode [copies] [directory]
+// Decodes the png files of the directory, then copies times as many, serially and through TextureDecodeQueue on
+// pools of several sizes. Each size runs on a pool started beforehand, as the example reuses one, and on a pool
+// started and joined around the decodes.
+bool RunTextureDecodeBenchmark(const BenchmarkArguments &arguments);
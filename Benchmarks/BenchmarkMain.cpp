@@ -0,0 +1,100 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+struct BenchmarkEntry
+{
+	const char *m_pName;
+	bool (*m_pRun)(const BenchmarkArguments &arguments);
+};
+
+constexpr BenchmarkEntry Benchmarks[] = {
+	{ "archive-read", RunArchiveReadBenchmark },
+	{ "archive-write", RunArchiveWriteBenchmark },
+	{ "frustum-cull", RunFrustumCullBenchmark },
+	{ "hash", RunHashBenchmark },
+	{ "light-cluster", RunLightClusterBenchmark },
+	{ "texture-decode", RunTextureDecodeBenchmark },
+	{ "triangle-ray", RunTriangleRayBenchmark },
+};
+
+}
+
+uint64_t GetPeakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	rusage usage;
+	if(0 != getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+	// Kilobytes on Linux.
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+uint64_t GetNumberArgument(const BenchmarkArguments &arguments, std::size_t index, uint64_t defaultValue) {
+	if(index >= arguments.size()) {
+		return defaultValue;
+	}
+
+	char *pEnd = nullptr;
+	const unsigned long long value = std::strtoull(arguments[index].c_str(), &pEnd, 10);
+	return pEnd != arguments[index].c_str() && '\0' == *pEnd ? static_cast<uint64_t>(value) : defaultValue;
+}
+
+std::string GetStringArgument(const BenchmarkArguments &arguments, std::size_t index, const char *pDefaultValue) {
+	return index < arguments.size() ? arguments[index] : std::string(pDefaultValue);
+}
+
+// CDSDK_Benchmarks runs every benchmark with its default arguments.
+// CDSDK_Benchmarks <name> [arguments] runs one of them.
+int main(int argc, char **argv) {
+	if(argc > 1) {
+		for(const BenchmarkEntry &benchmark : Benchmarks) {
+			if(0 == strcmp(argv[1], benchmark.m_pName)) {
+				return benchmark.m_pRun(BenchmarkArguments(argv + 2, argv + argc)) ? 0 : 1;
+			}
+		}
+
+		printf("Unknown benchmark %s, available :", argv[1]);
+		for(const BenchmarkEntry &benchmark : Benchmarks) {
+			printf(" %s", benchmark.m_pName);
+		}
+		printf("\n");
+		return 1;
+	}
+
+	bool succeeded = true;
+	for(const BenchmarkEntry &benchmark : Benchmarks) {
+		printf("== %s\n", benchmark.m_pName);
+		succeeded &= benchmark.m_pRun(BenchmarkArguments());
+	}
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include "Benchmark.h"
+
+#include "CpuFeatures.h"
+#include "FrustumCulling.h"
+#include "SceneBVH.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct MeshInstance
+{
+	cd::AABB m_localBox;
+	glm::mat4 m_worldMatrix;
+};
+
+// Boxes of a few units with a random yaw and non-uniform scale, scattered around a camera at the origin looking down -z.
+std::vector<MeshInstance> MakeInstances(uint32_t instanceCount) {
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<MeshInstance> instances(instanceCount);
+	for(MeshInstance &instance : instances) {
+		const cd::Point halfSize(0.25f + unit(random) * 2.5f, 0.25f + unit(random) * 2.5f, 0.25f + unit(random) * 2.5f);
+		instance.m_localBox = cd::AABB(cd::Point(-halfSize.x(), -halfSize.y(), -halfSize.z()), halfSize);
+
+		glm::mat4 worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3((unit(random) - 0.5f) * 2000.0f,
+			(unit(random) - 0.5f) * 200.0f, (unit(random) - 0.5f) * 2000.0f));
+		worldMatrix = glm::rotate(worldMatrix, unit(random) * 6.2831853f, glm::vec3(0.0f, 1.0f, 0.0f));
+		instance.m_worldMatrix = glm::scale(worldMatrix, glm::vec3(0.5f + unit(random), 0.5f + unit(random), 0.5f + unit(random)));
+	}
+	return instances;
+}
+
+// Plain array of structures loop over cd::Plane, the same test as FrustumCuller without the SoA layout or SIMD.
+uint32_t CullReference(const FrustumCuller &culler, const std::vector<glm::vec3> &centers, const std::vector<glm::vec3> &extents, uint8_t *pVisible) {
+	uint32_t visibleCount = 0;
+	for(std::size_t boxIndex = 0; boxIndex < centers.size(); ++boxIndex) {
+		const glm::vec3 &center = centers[boxIndex];
+		const glm::vec3 &extent = extents[boxIndex];
+		bool visible = true;
+		for(const cd::Plane &plane : culler.GetPlanes()) {
+			const cd::Vec3f &normal = plane.GetNormal();
+			const float distance = normal.x() * center.x + normal.y() * center.y + normal.z() * center.z - plane.GetDistance();
+			const float radius = std::abs(normal.x()) * extent.x + std::abs(normal.y()) * extent.y + std::abs(normal.z()) * extent.z;
+			if(distance + radius < 0.0f) {
+				visible = false;
+				break;
+			}
+		}
+		pVisible[boxIndex] = visible ? 1 : 0;
+		visibleCount += pVisible[boxIndex];
+	}
+	return visibleCount;
+}
+
+}
+
+bool RunFrustumCullBenchmark(const BenchmarkArguments &arguments) {
+	const uint32_t boxCount = static_cast<uint32_t>(GetNumberArgument(arguments, 0, 1000000));
+	const uint32_t iterationCount = static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 1, 20), 1));
+	const std::vector<MeshInstance> instances = MakeInstances(boxCount);
+
+	FrustumCuller culler;
+	culler.SetViewProjection(glm::perspective(0.785398163f, 800.0f / 600.0f, 0.1f, 1000.0f) *
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	// World bounds the way GLScene::UpdateBounds computes them every frame which moved a node.
+	CullingBoxes boxes;
+	BenchmarkTimer timer;
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		boxes.Clear();
+		boxes.Reserve(instances.size());
+		for(const MeshInstance &instance : instances) {
+			boxes.AddTransformed(instance.m_localBox, instance.m_worldMatrix);
+		}
+	}
+	const double transformMilliseconds = timer.GetMilliseconds() / iterationCount;
+
+	std::vector<glm::vec3> centers(boxCount);
+	std::vector<glm::vec3> extents(boxCount);
+	for(uint32_t boxIndex = 0; boxIndex < boxCount; ++boxIndex) {
+		centers[boxIndex] = glm::vec3(boxes.GetCenterX()[boxIndex], boxes.GetCenterY()[boxIndex], boxes.GetCenterZ()[boxIndex]);
+		extents[boxIndex] = glm::vec3(boxes.GetExtentX()[boxIndex], boxes.GetExtentY()[boxIndex], boxes.GetExtentZ()[boxIndex]);
+	}
+
+	std::vector<uint8_t> visible(boxCount);
+	uint32_t visibleCount = 0;
+	timer.Restart();
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		visibleCount = culler.Cull(boxes, visible.data());
+	}
+	const double cullMilliseconds = timer.GetMilliseconds() / iterationCount;
+
+	std::vector<uint8_t> referenceVisible(boxCount);
+	uint32_t referenceVisibleCount = 0;
+	timer.Restart();
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		referenceVisibleCount = CullReference(culler, centers, extents, referenceVisible.data());
+	}
+	const double referenceMilliseconds = timer.GetMilliseconds() / iterationCount;
+
+	// Built like GLScene::UpdateBounds does, the query runs the same kernels on leaf ranges and must keep the same boxes.
+	timer.Restart();
+	SceneBVH bvh;
+	bvh.Build(boxes, 0, FrustumCuller::GetBatchSize());
+	const double buildMilliseconds = timer.GetMilliseconds();
+
+	std::vector<uint32_t> queryItems;
+	timer.Restart();
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		queryItems.clear();
+		bvh.QueryFrustum(culler, queryItems);
+	}
+	const double queryMilliseconds = timer.GetMilliseconds() / iterationCount;
+
+	uint32_t mismatchCount = 0;
+	for(uint32_t boxIndex = 0; boxIndex < boxCount; ++boxIndex) {
+		mismatchCount += visible[boxIndex] != referenceVisible[boxIndex] ? 1 : 0;
+	}
+
+	std::vector<uint8_t> queryVisible(boxCount);
+	uint32_t queryMismatchCount = 0;
+	for(uint32_t itemIndex : queryItems) {
+		queryMismatchCount += queryVisible[itemIndex] ? 1 : 0;
+		queryVisible[itemIndex] = 1;
+	}
+	for(uint32_t boxIndex = 0; boxIndex < boxCount; ++boxIndex) {
+		queryMismatchCount += queryVisible[boxIndex] != visible[boxIndex] ? 1 : 0;
+	}
+
+	printf("%u boxes, %u visible, %u iterations\n", boxCount, visibleCount, iterationCount);
+	printf("  AddTransformed             : %8.3f ms\n", transformMilliseconds);
+	printf("  FrustumCuller::Cull (%s) : %8.3f ms, %.0f Mboxes/s\n", CpuFeatures::Get().m_avx2 ? "AVX2" : "SSE ",
+		cullMilliseconds, boxCount / cullMilliseconds / 1000.0);
+	printf("  AoS scalar reference       : %8.3f ms, %.0f Mboxes/s\n", referenceMilliseconds, boxCount / referenceMilliseconds / 1000.0);
+	printf("  SceneBVH::Build            : %8.3f ms, %u nodes\n", buildMilliseconds, bvh.GetNodeCount());
+	printf("  SceneBVH::QueryFrustum     : %8.3f ms\n", queryMilliseconds);
+
+	bool succeeded = true;
+	if(mismatchCount != 0 || visibleCount != referenceVisibleCount) {
+		printf("  %u boxes differ from the reference\n", mismatchCount);
+		succeeded = false;
+	}
+	if(queryMismatchCount != 0) {
+		printf("  %u boxes differ between QueryFrustum and Cull\n", queryMismatchCount);
+		succeeded = false;
+	}
+	return succeeded;
+}
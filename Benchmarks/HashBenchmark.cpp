@@ -0,0 +1,153 @@
+#include "Benchmark.h"
+
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include "Sha256.h"
+#include "Hashers/FileHash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Random bytes, so that nothing on the way to the disk can shortcut them.
+bool WriteRandomFile(const std::filesystem::path &filePath, uint64_t byteCount) {
+	std::mt19937_64 random(5);
+	std::vector<uint64_t> block(1024 * 1024 / sizeof(uint64_t));
+	std::ofstream fout(filePath, std::ios::out | std::ios::binary);
+	for(uint64_t written = 0; written < byteCount && fout; written += block.size() * sizeof(uint64_t)) {
+		for(uint64_t &value : block) {
+			value = random();
+		}
+		const uint64_t blockBytes = std::min<uint64_t>(block.size() * sizeof(uint64_t), byteCount - written);
+		fout.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(blockBytes));
+	}
+	return static_cast<bool>(fout);
+}
+
+Sha256::Digest HashMapped(const MappedFile &file, bool useAcceleration) {
+	Sha256 sha(useAcceleration);
+	sha.Update(file.GetData(), file.GetSize());
+	return sha.Finalize();
+}
+
+// The tree layout documented at Sha256FileTree, built serially with the portable implementation.
+std::string HashTreeReference(const MappedFile &file, std::size_t leafSize) {
+	const uint64_t fileSize = file.GetSize();
+	uint8_t sizes[16];
+	for(int i = 0; i < 8; ++i) {
+		sizes[i] = static_cast<uint8_t>(fileSize >> (i * 8));
+		sizes[i + 8] = static_cast<uint8_t>(static_cast<uint64_t>(leafSize) >> (i * 8));
+	}
+
+	Sha256 root(false);
+	root.Update(sizes, sizeof(sizes));
+	for(uint64_t offset = 0; offset < fileSize; offset += leafSize) {
+		Sha256 leaf(false);
+		leaf.Update(file.GetData() + offset, static_cast<std::size_t>(std::min<uint64_t>(leafSize, fileSize - offset)));
+		const Sha256::Digest leafDigest = leaf.Finalize();
+		root.Update(leafDigest.data(), leafDigest.size());
+	}
+	return Sha256::ToHexString(root.Finalize());
+}
+
+double GetMegabytesPerSecond(uint64_t byteCount, double milliseconds) {
+	return byteCount / (1024.0 * 1024.0) / (milliseconds / 1000.0);
+}
+
+}
+
+bool RunHashBenchmark(const BenchmarkArguments &arguments) {
+	const uint64_t megabytes = std::max<uint64_t>(GetNumberArgument(arguments, 0, 64), 1);
+	std::filesystem::path filePath = GetStringArgument(arguments, 1, "");
+	const bool temporaryFile = filePath.empty();
+	if(temporaryFile) {
+		std::error_code error;
+		filePath = std::filesystem::temp_directory_path(error) / "CDSDK_HashBenchmark.bin";
+		if(!WriteRandomFile(filePath, megabytes * 1024 * 1024)) {
+			printf("Failed to write %s\n", filePath.string().c_str());
+			return false;
+		}
+	}
+
+	// Unmapped before the temporary file is removed.
+	bool succeeded = true;
+	{
+		MappedFile file(filePath.string().c_str());
+		if(!file.IsValid()) {
+			printf("Failed to map %s\n", filePath.string().c_str());
+			succeeded = false;
+		}
+		else {
+			const uint64_t fileSize = file.GetSize();
+			printf("%s, %.1f MiB, SHA-NI %s\n", filePath.string().c_str(), fileSize / (1024.0 * 1024.0),
+				Sha256::IsAccelerated() ? "available" : "not available");
+
+			// Touches every page once, so that the first timed pass doesn't pay for reading the file.
+			HashMapped(file, true);
+
+			BenchmarkTimer timer;
+			const Sha256::Digest scalarDigest = HashMapped(file, false);
+			const double scalarMilliseconds = timer.GetMilliseconds();
+			printf("  Sha256 portable           : %8.1f ms, %7.1f MiB/s\n", scalarMilliseconds, GetMegabytesPerSecond(fileSize, scalarMilliseconds));
+
+			timer.Restart();
+			const Sha256::Digest acceleratedDigest = HashMapped(file, true);
+			const double acceleratedMilliseconds = timer.GetMilliseconds();
+			printf("  Sha256 %s           : %8.1f ms, %7.1f MiB/s\n", Sha256::IsAccelerated() ? "SHA-NI  " : "portable",
+				acceleratedMilliseconds, GetMegabytesPerSecond(fileSize, acceleratedMilliseconds));
+
+			timer.Restart();
+			const std::string fileDigest = Sha256File(filePath.string().c_str());
+			const double fileMilliseconds = timer.GetMilliseconds();
+			printf("  Sha256File                : %8.1f ms, %7.1f MiB/s\n", fileMilliseconds, GetMegabytesPerSecond(fileSize, fileMilliseconds));
+
+			// The hex digest of the file's digest, see Sha256File.
+			timer.Restart();
+			const std::string picoDigest = cd::FileHash(filePath.string().c_str());
+			const double picoMilliseconds = timer.GetMilliseconds();
+			printf("  cd::FileHash (picosha2)   : %8.1f ms, %7.1f MiB/s\n", picoMilliseconds, GetMegabytesPerSecond(fileSize, picoMilliseconds));
+
+			if(scalarDigest != acceleratedDigest || Sha256::ToHexString(scalarDigest) != fileDigest) {
+				printf("  Sha256 digests differ : %s %s %s\n", Sha256::ToHexString(scalarDigest).c_str(),
+					Sha256::ToHexString(acceleratedDigest).c_str(), fileDigest.c_str());
+				succeeded = false;
+			}
+			const std::string expectedPicoDigest = Sha256::ToHexString(Sha256::Hash(scalarDigest.data(), scalarDigest.size()));
+			if(picoDigest != expectedPicoDigest) {
+				printf("  cd::FileHash gave %s instead of %s\n", picoDigest.c_str(), expectedPicoDigest.c_str());
+				succeeded = false;
+			}
+
+			const std::string treeReference = HashTreeReference(file, DefaultTreeHashLeafSize);
+			std::vector<std::size_t> threadCounts = { 1, 2, 4, 8 };
+			if(std::find(threadCounts.begin(), threadCounts.end(), GetDefaultThreadCount()) == threadCounts.end()) {
+				threadCounts.push_back(GetDefaultThreadCount());
+			}
+			printf("Hardware threads : %zu, %zu KiB leaves\n", GetDefaultThreadCount(), DefaultTreeHashLeafSize / 1024);
+			for(std::size_t threadCount : threadCounts) {
+				timer.Restart();
+				const std::string treeDigest = Sha256FileTree(filePath.string().c_str(), DefaultTreeHashLeafSize, threadCount);
+				const double treeMilliseconds = timer.GetMilliseconds();
+				printf("  Sha256FileTree %2zu threads : %8.1f ms, %7.1f MiB/s\n", threadCount, treeMilliseconds,
+					GetMegabytesPerSecond(fileSize, treeMilliseconds));
+				if(treeDigest != treeReference) {
+					printf("  Tree digest %s instead of %s\n", treeDigest.c_str(), treeReference.c_str());
+					succeeded = false;
+				}
+			}
+		}
+	}
+
+	if(temporaryFile) {
+		std::error_code error;
+		std::filesystem::remove(filePath, error);
+	}
+	return succeeded;
+}
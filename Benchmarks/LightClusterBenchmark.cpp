@@ -0,0 +1,190 @@
+#include "Benchmark.h"
+
+#include "LightCluster.h"
+#include "Scene/LightType.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Same projection as the example's render loop.
+constexpr float FovY = 0.785398163f;
+constexpr float Aspect = 800.0f / 600.0f;
+constexpr float NearPlane = 0.001f;
+constexpr float FarPlane = 10000.0f;
+
+// Point lights in front of the camera with ranges from a few centimeters to a few tiles, plus the cases which the
+// builder special cases : a directional light which touches everything and a light without range which touches nothing.
+std::vector<LightUniforms> MakeLights(uint32_t lightCount, const glm::mat4 &view) {
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const glm::mat4 inverseView = glm::inverse(view);
+	const float tanHalfFovY = std::tan(FovY * 0.5f);
+
+	std::vector<LightUniforms> lights(lightCount);
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex) {
+		LightUniforms &light = lights[lightIndex];
+		const float depth = 0.5f + unit(random) * unit(random) * 200.0f;
+		const glm::vec3 viewPosition((unit(random) * 2.4f - 1.2f) * depth * tanHalfFovY * Aspect,
+			(unit(random) * 2.4f - 1.2f) * depth * tanHalfFovY, -depth);
+		light.m_position = glm::vec3(inverseView * glm::vec4(viewPosition, 1.0f));
+		light.m_range = 0.05f + unit(random) * unit(random) * 5.0f;
+		light.m_color = glm::vec3(1.0f);
+		light.m_intensity = 1.0f;
+		light.m_direction = glm::vec3(0.0f, -1.0f, 0.0f);
+		light.m_type = static_cast<int32_t>(cd::LightType::Point);
+	}
+	if(lightCount > 1) {
+		lights[0].m_type = static_cast<int32_t>(cd::LightType::Directional);
+		lights[1].m_range = 0.0f;
+	}
+	return lights;
+}
+
+// Overlap of a light with one cluster, computed independently of the builder : the cluster's view space box comes from
+// its eight frustum corners and the sphere test runs in double.
+// Returns 1 for overlap, 0 for none and -1 when the sphere only grazes the box, where float rounding may go either way.
+int TestCluster(const LightUniforms &light, const glm::mat4 &view, uint32_t clusterIndex) {
+	if(static_cast<int32_t>(cd::LightType::Directional) == light.m_type) {
+		return 1;
+	}
+	if(light.m_range <= 0.0f) {
+		return 0;
+	}
+
+	const uint32_t sliceIndex = clusterIndex / LightClusterBuilder::TileCount;
+	const uint32_t tileY = clusterIndex % LightClusterBuilder::TileCount / LightClusterBuilder::TileCountX;
+	const uint32_t tileX = clusterIndex % LightClusterBuilder::TileCountX;
+	const double depthRatio = static_cast<double>(FarPlane) / NearPlane;
+	const double depths[2] = {
+		NearPlane * std::pow(depthRatio, static_cast<double>(sliceIndex) / LightClusterBuilder::SliceCount),
+		NearPlane * std::pow(depthRatio, static_cast<double>(sliceIndex + 1) / LightClusterBuilder::SliceCount) };
+	const double tanHalfFovY = std::tan(FovY * 0.5);
+	const double tanHalfFovX = tanHalfFovY * Aspect;
+
+	double boxMin[3] = { 1e30, 1e30, -depths[1] };
+	double boxMax[3] = { -1e30, -1e30, -depths[0] };
+	for(double depth : depths) {
+		for(uint32_t cornerX = 0; cornerX < 2; ++cornerX) {
+			for(uint32_t cornerY = 0; cornerY < 2; ++cornerY) {
+				const double ndcX = -1.0 + 2.0 * (tileX + cornerX) / LightClusterBuilder::TileCountX;
+				const double ndcY = -1.0 + 2.0 * (tileY + cornerY) / LightClusterBuilder::TileCountY;
+				boxMin[0] = std::min(boxMin[0], ndcX * depth * tanHalfFovX);
+				boxMax[0] = std::max(boxMax[0], ndcX * depth * tanHalfFovX);
+				boxMin[1] = std::min(boxMin[1], ndcY * depth * tanHalfFovY);
+				boxMax[1] = std::max(boxMax[1], ndcY * depth * tanHalfFovY);
+			}
+		}
+	}
+
+	const glm::vec3 center = glm::vec3(view * glm::vec4(light.m_position, 1.0f));
+	const double radiusSquared = static_cast<double>(light.m_range) * light.m_range;
+	double distanceSquared = 0.0;
+	double magnitudeSquared = radiusSquared;
+	for(int axis = 0; axis < 3; ++axis) {
+		const double distance = std::max(boxMin[axis] - center[axis], 0.0) + std::max(center[axis] - boxMax[axis], 0.0);
+		const double magnitude = std::max(std::abs(boxMin[axis]), std::abs(boxMax[axis]));
+		distanceSquared += distance * distance;
+		magnitudeSquared += magnitude * magnitude;
+	}
+
+	if(std::abs(distanceSquared - radiusSquared) <= magnitudeSquared * 1e-5) {
+		return -1;
+	}
+	return distanceSquared < radiusSquared ? 1 : 0;
+}
+
+// Checks the packed cluster and index lists against TestCluster for every light and cluster.
+bool ValidateClusters(const LightClusterBuilder &builder, const std::vector<LightUniforms> &lights, const glm::mat4 &view) {
+	const std::vector<uint32_t> &clusters = builder.GetClusters();
+	const std::vector<uint16_t> &lightIndices = builder.GetLightIndices();
+	if(clusters.size() != LightClusterBuilder::ClusterCount * 2) {
+		printf("  Expected %u clusters, got %zu\n", LightClusterBuilder::ClusterCount, clusters.size() / 2);
+		return false;
+	}
+
+	uint64_t missingCount = 0;
+	uint64_t extraCount = 0;
+	uint64_t assignedCount = 0;
+	uint32_t expectedOffset = 0;
+	std::vector<uint8_t> assigned(lights.size());
+	for(uint32_t clusterIndex = 0; clusterIndex < LightClusterBuilder::ClusterCount; ++clusterIndex) {
+		const uint32_t offset = clusters[clusterIndex * 2];
+		const uint32_t count = clusters[clusterIndex * 2 + 1];
+		if(offset != expectedOffset || offset + count > lightIndices.size()) {
+			printf("  Cluster %u has list [%u, %u) but the previous one ended at %u of %zu\n",
+				clusterIndex, offset, offset + count, expectedOffset, lightIndices.size());
+			return false;
+		}
+		expectedOffset = offset + count;
+
+		std::fill(assigned.begin(), assigned.end(), 0);
+		for(uint32_t listIndex = offset; listIndex < offset + count; ++listIndex) {
+			const uint16_t lightIndex = lightIndices[listIndex];
+			if(lightIndex >= lights.size() || assigned[lightIndex]) {
+				printf("  Cluster %u lists light %u twice or out of range\n", clusterIndex, lightIndex);
+				return false;
+			}
+			assigned[lightIndex] = 1;
+		}
+		assignedCount += count;
+
+		for(uint32_t lightIndex = 0; lightIndex < lights.size(); ++lightIndex) {
+			const int expected = TestCluster(lights[lightIndex], view, clusterIndex);
+			if(1 == expected && !assigned[lightIndex]) {
+				++missingCount;
+			}
+			else if(0 == expected && assigned[lightIndex]) {
+				++extraCount;
+			}
+		}
+	}
+
+	printf("  %llu light cluster pairs assigned, %llu missing, %llu extra\n",
+		static_cast<unsigned long long>(assignedCount), static_cast<unsigned long long>(missingCount), static_cast<unsigned long long>(extraCount));
+	return 0 == missingCount && 0 == extraCount;
+}
+
+}
+
+bool RunLightClusterBenchmark(const BenchmarkArguments &arguments) {
+	const uint32_t lightCount = static_cast<uint32_t>(std::min<uint64_t>(GetNumberArgument(arguments, 0, MaxLightCount), UINT16_MAX + 1));
+	const uint32_t iterationCount = static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 1, 200), 1));
+
+	const glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 2.0f, 5.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const std::vector<LightUniforms> lights = MakeLights(lightCount, view);
+
+	LightClusterBuilder builder;
+	builder.SetProjection(FovY, Aspect, NearPlane, FarPlane);
+	builder.Build(view, lights.data(), lightCount);
+	printf("%u lights, %u clusters\n", lightCount, LightClusterBuilder::ClusterCount);
+	if(builder.GetLightIndices().size() >= LightClusterBuilder::MaxLightIndexCount) {
+		printf("  Index list is full, lights were dropped, use fewer lights to validate\n");
+		return false;
+	}
+	const bool succeeded = ValidateClusters(builder, lights, view);
+
+	// The pool is started beforehand, as the example's lives as long as the scene.
+	ThreadPool threadPool;
+	printf("  Hardware threads : %zu\n", threadPool.GetThreadCount());
+	BenchmarkTimer timer;
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		builder.Build(view, lights.data(), lightCount);
+	}
+	printf("  Build, calling thread : %.3f ms\n", timer.GetMilliseconds() / iterationCount);
+
+	timer.Restart();
+	for(uint32_t iteration = 0; iteration < iterationCount; ++iteration) {
+		builder.Build(view, lights.data(), lightCount, &threadPool);
+	}
+	printf("  Build, thread pool    : %.3f ms\n", timer.GetMilliseconds() / iterationCount);
+	return succeeded && ValidateClusters(builder, lights, view);
+}
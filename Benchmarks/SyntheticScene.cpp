@@ -0,0 +1,55 @@
+#include "SyntheticScene.h"
+
+#include "Base/Endian.h"
+#include "IO/OutputArchive.hpp"
+
+namespace SyntheticScene
+{
+
+uint32_t GetMeshCount(uint64_t megabytes) {
+	const uint64_t meshBytes = MeshVertexCount * (sizeof(cd::Point) + 2 * sizeof(cd::Direction) + sizeof(cd::UV) + 3 * sizeof(uint32_t));
+	return static_cast<uint32_t>(megabytes * 1024 * 1024 / meshBytes);
+}
+
+void Write(std::ostream &stream, uint32_t meshCount) {
+	cd::OutputArchive outputArchive(&stream);
+	outputArchive << static_cast<uint8_t>(cd::Endian::GetNative());
+
+	outputArchive << NodeCount;
+	for(uint32_t nodeIndex = 0; nodeIndex < NodeCount; ++nodeIndex) {
+		outputArchive << nodeIndex << ("Node" + std::to_string(nodeIndex)) << (nodeIndex / ChildrenPerNode) << ChildrenPerNode;
+		for(uint32_t childIndex = 0; childIndex < ChildrenPerNode; ++childIndex) {
+			outputArchive << nodeIndex * ChildrenPerNode + childIndex + 1;
+		}
+		outputArchive << cd::Transform::Identity();
+	}
+
+	MeshStreams mesh;
+	mesh.m_positions.resize(MeshVertexCount);
+	mesh.m_normals.resize(MeshVertexCount);
+	mesh.m_tangents.resize(MeshVertexCount);
+	mesh.m_uvs.resize(MeshVertexCount);
+	mesh.m_indices.resize(MeshVertexCount * 3);
+	for(uint32_t vertexIndex = 0; vertexIndex < MeshVertexCount; ++vertexIndex) {
+		const float value = static_cast<float>(vertexIndex);
+		mesh.m_positions[vertexIndex] = cd::Point(value, value * 0.5f, -value);
+		mesh.m_normals[vertexIndex] = cd::Direction(0.0f, 1.0f, 0.0f);
+		mesh.m_tangents[vertexIndex] = cd::Direction(1.0f, 0.0f, 0.0f);
+		mesh.m_uvs[vertexIndex] = cd::UV(value / MeshVertexCount, 1.0f - value / MeshVertexCount);
+	}
+	for(uint32_t index = 0; index < mesh.m_indices.size(); ++index) {
+		mesh.m_indices[index] = (index * 7) % MeshVertexCount;
+	}
+
+	outputArchive << meshCount;
+	for(uint32_t meshIndex = 0; meshIndex < meshCount; ++meshIndex) {
+		outputArchive << meshIndex << ("Mesh" + std::to_string(meshIndex)) << MeshVertexCount << static_cast<uint32_t>(mesh.m_indices.size());
+		outputArchive.ExportBuffer(mesh.m_positions.data(), mesh.m_positions.size());
+		outputArchive.ExportBuffer(mesh.m_normals.data(), mesh.m_normals.size());
+		outputArchive.ExportBuffer(mesh.m_tangents.data(), mesh.m_tangents.size());
+		outputArchive.ExportBuffer(mesh.m_uvs.data(), mesh.m_uvs.size());
+		outputArchive.ExportBuffer(mesh.m_indices.data(), mesh.m_indices.size());
+	}
+}
+
+}
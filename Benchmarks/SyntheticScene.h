@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Math/Transform.hpp"
+#include "Math/Vector.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Records shaped like the ones SceneDatabase serializes: nodes are many small fields, meshes a few big buffers.
+namespace SyntheticScene
+{
+
+constexpr uint32_t NodeCount = 100000;
+constexpr uint32_t ChildrenPerNode = 4;
+constexpr uint32_t MeshVertexCount = 16384;
+
+struct MeshStreams
+{
+	std::vector<cd::Point> m_positions;
+	std::vector<cd::Direction> m_normals;
+	std::vector<cd::Direction> m_tangents;
+	std::vector<cd::UV> m_uvs;
+	std::vector<uint32_t> m_indices;
+};
+
+// Number of meshes which makes the stream roughly megabytes long, 0 leaves only the scalar heavy node records.
+uint32_t GetMeshCount(uint64_t megabytes);
+
+// Writes the endian byte, then the scene, through a cd::OutputArchive on top of stream.
+void Write(std::ostream &stream, uint32_t meshCount);
+
+// Deserializes everything after the endian byte into memory like a producer filling a SceneDatabase.
+// Returns a checksum of what was read.
+template<typename InputArchive>
+uint64_t Read(InputArchive &inputArchive, std::vector<MeshStreams> &meshes) {
+	uint64_t checksum = 0;
+
+	uint32_t nodeCount;
+	inputArchive >> nodeCount;
+	std::string name;
+	for(uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+		uint32_t nodeID, parentID, childCount;
+		inputArchive >> nodeID >> name >> parentID >> childCount;
+		checksum += nodeID + parentID + name.size();
+		for(uint32_t childIndex = 0; childIndex < childCount; ++childIndex) {
+			uint32_t childID;
+			inputArchive >> childID;
+			checksum += childID;
+		}
+		cd::Transform transform;
+		inputArchive >> transform;
+		checksum += static_cast<uint64_t>(transform.GetScale().x());
+	}
+
+	uint32_t meshCount;
+	inputArchive >> meshCount;
+	meshes.resize(meshCount);
+	for(MeshStreams &mesh : meshes) {
+		uint32_t meshID, vertexCount, indexCount;
+		inputArchive >> meshID >> name >> vertexCount >> indexCount;
+		mesh.m_positions.resize(vertexCount);
+		mesh.m_normals.resize(vertexCount);
+		mesh.m_tangents.resize(vertexCount);
+		mesh.m_uvs.resize(vertexCount);
+		mesh.m_indices.resize(indexCount);
+		inputArchive.ImportBuffer(mesh.m_positions.data());
+		inputArchive.ImportBuffer(mesh.m_normals.data());
+		inputArchive.ImportBuffer(mesh.m_tangents.data());
+		inputArchive.ImportBuffer(mesh.m_uvs.data());
+		inputArchive.ImportBuffer(mesh.m_indices.data());
+		checksum += meshID + static_cast<uint64_t>(mesh.m_positions.back().x()) + mesh.m_indices.back();
+	}
+	return checksum;
+}
+
+}
@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+
+#include "ParallelFor.h"
+#include "TextureDecoder.h"
+#include "ThreadPool.h"
+
+// The example defines it in GLConsumer.cpp, which needs a GL context.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct EncodedFile
+{
+	std::string m_name;
+	std::vector<std::byte> m_data;
+};
+
+std::vector<EncodedFile> ReadImageFiles(const std::string &directory) {
+	std::vector<EncodedFile> files;
+	std::error_code errorCode;
+	for(const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, errorCode)) {
+		if(!entry.is_regular_file() || entry.path().extension() != ".png") {
+			continue;
+		}
+
+		std::ifstream fin(entry.path(), std::ios::in | std::ios::binary);
+		const std::vector<char> bytes((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		EncodedFile &file = files.emplace_back();
+		file.m_name = entry.path().filename().string();
+		file.m_data.resize(bytes.size());
+		std::copy(bytes.begin(), bytes.end(), reinterpret_cast<char *>(file.m_data.data()));
+	}
+	std::sort(files.begin(), files.end(), [](const EncodedFile &a, const EncodedFile &b) { return a.m_name < b.m_name; });
+	return files;
+}
+
+// Sum of the decoded sizes, which every way of decoding the same files has to agree on.
+uint64_t DecodeSerially(const std::vector<EncodedFile> &files, uint32_t copies) {
+	uint64_t decodedBytes = 0;
+	for(uint32_t copy = 0; copy < copies; ++copy) {
+		for(const EncodedFile &file : files) {
+			DecodedImage image;
+			image.LoadFromMemory(file.m_data.data(), file.m_data.size());
+			decodedBytes += image.GetByteCount();
+		}
+	}
+	return decodedBytes;
+}
+
+// Requests every file like TextureStreamer does and takes the images as they finish.
+uint64_t DecodeOnPool(ThreadPool &threadPool, const std::vector<EncodedFile> &files, uint32_t copies) {
+	TextureDecodeQueue decodeQueue(threadPool);
+	for(uint32_t copy = 0; copy < copies; ++copy) {
+		for(const EncodedFile &file : files) {
+			decodeQueue.Request(file.m_name, file.m_data);
+		}
+	}
+
+	uint64_t decodedBytes = 0;
+	DecodedTexture texture;
+	while(decodeQueue.WaitPop(texture)) {
+		decodedBytes += texture.m_image.GetByteCount();
+	}
+	return decodedBytes;
+}
+
+}
+
+bool RunTextureDecodeBenchmark(const BenchmarkArguments &arguments) {
+	const uint32_t copies = static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 0, 8), 1));
+	const std::string directory = GetStringArgument(arguments, 1, "Models/textures");
+
+	const std::vector<EncodedFile> files = ReadImageFiles(directory);
+	if(files.empty()) {
+		printf("No png files in %s, run from the repository root or pass the directory\n", directory.c_str());
+		return false;
+	}
+
+	std::vector<std::size_t> threadCounts = { 1, 2, 4, 8 };
+	if(std::find(threadCounts.begin(), threadCounts.end(), GetDefaultThreadCount()) == threadCounts.end()) {
+		threadCounts.push_back(GetDefaultThreadCount());
+	}
+
+	printf("Hardware threads : %zu\n", GetDefaultThreadCount());
+	bool succeeded = true;
+	for(uint32_t setCopies : { 1u, copies }) {
+		printf("%s, %zu textures :\n", 1 == setCopies ? directory.c_str() : "Copies of it", files.size() * setCopies);
+
+		BenchmarkTimer timer;
+		const uint64_t expectedBytes = DecodeSerially(files, setCopies);
+		printf("  serial                 : %8.1f ms, %.1f MiB decoded\n", timer.GetMilliseconds(), expectedBytes / (1024.0 * 1024.0));
+
+		for(std::size_t threadCount : threadCounts) {
+			// A pool which lives across loads, like GLScene's, against one started and joined for the load.
+			ThreadPool threadPool(threadCount);
+			timer.Restart();
+			const uint64_t reusedBytes = DecodeOnPool(threadPool, files, setCopies);
+			const double reusedMilliseconds = timer.GetMilliseconds();
+
+			timer.Restart();
+			uint64_t newPoolBytes = 0;
+			{
+				ThreadPool newThreadPool(threadCount);
+				newPoolBytes = DecodeOnPool(newThreadPool, files, setCopies);
+			}
+			const double newPoolMilliseconds = timer.GetMilliseconds();
+
+			printf("  %zu threads, reused pool : %8.1f ms, new pool : %8.1f ms\n", threadCount, reusedMilliseconds, newPoolMilliseconds);
+			if(reusedBytes != expectedBytes || newPoolBytes != expectedBytes) {
+				printf("  Decoded %llu and %llu bytes instead of %llu\n", static_cast<unsigned long long>(reusedBytes),
+					static_cast<unsigned long long>(newPoolBytes), static_cast<unsigned long long>(expectedBytes));
+				succeeded = false;
+			}
+		}
+	}
+	return succeeded;
+}
@@ -0,0 +1,182 @@
+#include "Benchmark.h"
+
+#include "CpuFeatures.h"
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct SyntheticMesh
+{
+	std::vector<cd::Point> m_positions;
+	std::vector<cd::Polygon> m_polygons;
+};
+
+// Unit UV sphere of about triangleCount triangles, with a little radial noise so that no two triangles share a plane.
+SyntheticMesh MakeSphere(uint32_t triangleCount) {
+	const uint32_t segmentCount = std::max(4u, static_cast<uint32_t>(std::sqrt(static_cast<double>(triangleCount))));
+	const uint32_t ringCount = std::max(2u, segmentCount / 2);
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> noise(0.99f, 1.01f);
+
+	SyntheticMesh mesh;
+	for(uint32_t ring = 0; ring <= ringCount; ++ring) {
+		const float polar = 3.14159265f * ring / ringCount;
+		for(uint32_t segment = 0; segment <= segmentCount; ++segment) {
+			const float azimuth = 6.2831853f * segment / segmentCount;
+			const float radius = noise(random);
+			mesh.m_positions.emplace_back(radius * std::sin(polar) * std::cos(azimuth), radius * std::cos(polar), radius * std::sin(polar) * std::sin(azimuth));
+		}
+	}
+	for(uint32_t ring = 0; ring < ringCount; ++ring) {
+		for(uint32_t segment = 0; segment < segmentCount; ++segment) {
+			const uint32_t a = ring * (segmentCount + 1) + segment;
+			const uint32_t b = a + segmentCount + 1;
+			mesh.m_polygons.emplace_back(cd::VertexID(a), cd::VertexID(b), cd::VertexID(a + 1));
+			mesh.m_polygons.emplace_back(cd::VertexID(a + 1), cd::VertexID(b), cd::VertexID(b + 1));
+		}
+	}
+	return mesh;
+}
+
+// From a shell around the sphere towards points a bit wider than it, so that most rays hit and some miss.
+std::vector<cd::Ray> MakeRays(uint32_t rayCount) {
+	std::mt19937 random(7);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto randomDirection = [&]() {
+		glm::vec3 direction(normal(random), normal(random), normal(random));
+		return glm::normalize(direction);
+	};
+
+	std::vector<cd::Ray> rays;
+	rays.reserve(rayCount);
+	for(uint32_t rayIndex = 0; rayIndex < rayCount; ++rayIndex) {
+		const glm::vec3 origin = randomDirection() * 3.0f;
+		const glm::vec3 target = randomDirection() * 1.1f * std::cbrt(unit(random));
+		const glm::vec3 direction = glm::normalize(target - origin);
+		rays.emplace_back(cd::Point(origin.x, origin.y, origin.z), cd::Direction(direction.x, direction.y, direction.z));
+	}
+	return rays;
+}
+
+// Moller-Trumbore against every triangle, with the same operations as the packet kernels.
+TriangleHit RaycastBruteForce(const SyntheticMesh &mesh, const cd::Ray &ray) {
+	const cd::Point &origin = ray.Origin();
+	const cd::Direction &direction = ray.Direction();
+
+	TriangleHit hit;
+	for(uint32_t triangleIndex = 0; triangleIndex < mesh.m_polygons.size(); ++triangleIndex) {
+		const cd::Polygon &polygon = mesh.m_polygons[triangleIndex];
+		const cd::Point &a = mesh.m_positions[polygon[0].Data()];
+		const cd::Point edge1 = mesh.m_positions[polygon[1].Data()] - a;
+		const cd::Point edge2 = mesh.m_positions[polygon[2].Data()] - a;
+
+		const float px = direction.y() * edge2.z() - direction.z() * edge2.y();
+		const float py = direction.z() * edge2.x() - direction.x() * edge2.z();
+		const float pz = direction.x() * edge2.y() - direction.y() * edge2.x();
+		const float inverseDeterminant = 1.0f / (edge1.x() * px + edge1.y() * py + edge1.z() * pz);
+
+		const float tx = origin.x() - a.x();
+		const float ty = origin.y() - a.y();
+		const float tz = origin.z() - a.z();
+		const float u = (tx * px + ty * py + tz * pz) * inverseDeterminant;
+
+		const float qx = ty * edge1.z() - tz * edge1.y();
+		const float qy = tz * edge1.x() - tx * edge1.z();
+		const float qz = tx * edge1.y() - ty * edge1.x();
+		const float v = (direction.x() * qx + direction.y() * qy + direction.z() * qz) * inverseDeterminant;
+		const float distance = (edge2.x() * qx + edge2.y() * qy + edge2.z() * qz) * inverseDeterminant;
+
+		if(u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < hit.m_distance) {
+			hit.m_triangleIndex = triangleIndex;
+			hit.m_distance = distance;
+			hit.m_u = u;
+			hit.m_v = v;
+		}
+	}
+	return hit;
+}
+
+// Ties on shared edges may pick either triangle, so hits only have to agree on the distance.
+bool IsSameHit(const TriangleHit &hit, const TriangleHit &reference) {
+	if(hit.IsValid() != reference.IsValid()) {
+		return false;
+	}
+	return !hit.IsValid() || std::abs(hit.m_distance - reference.m_distance) <= 1e-5f * std::max(1.0f, reference.m_distance);
+}
+
+}
+
+bool RunTriangleRayBenchmark(const BenchmarkArguments &arguments) {
+	const uint32_t rayCount = static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 1, 200000), 1));
+	const uint32_t checkedRayCount = static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 2, 256), 1));
+	std::vector<uint32_t> triangleCounts = { 8192, 131072, 2097152 };
+	if(arguments.size() > 0) {
+		triangleCounts = { static_cast<uint32_t>(std::max<uint64_t>(GetNumberArgument(arguments, 0, 8192), 8)) };
+	}
+
+	const std::vector<cd::Ray> rays = MakeRays(rayCount);
+	std::vector<bool> useAVXs = { false };
+	if(CpuFeatures::Get().m_avx2) {
+		useAVXs.push_back(true);
+	}
+
+	bool succeeded = true;
+	for(uint32_t triangleCount : triangleCounts) {
+		const SyntheticMesh mesh = MakeSphere(triangleCount);
+
+		BenchmarkTimer timer;
+		TriangleBVH bvh;
+		bvh.Build(mesh.m_positions, mesh.m_polygons, 1);
+		const double buildMilliseconds = timer.GetMilliseconds();
+		printf("%u triangles, %u nodes, %u packets, Build %.1f ms\n", bvh.GetTriangleCount(), bvh.GetNodeCount(), bvh.GetPacketCount(), buildMilliseconds);
+
+		for(bool useAVX : useAVXs) {
+			bvh.SetUseAVX(useAVX);
+
+			uint32_t hitCount = 0;
+			timer.Restart();
+			for(const cd::Ray &ray : rays) {
+				hitCount += bvh.Raycast(ray).IsValid() ? 1 : 0;
+			}
+			const double raycastMilliseconds = timer.GetMilliseconds();
+
+			uint32_t occludedCount = 0;
+			timer.Restart();
+			for(const cd::Ray &ray : rays) {
+				occludedCount += bvh.IsOccluded(ray) ? 1 : 0;
+			}
+			const double occludedMilliseconds = timer.GetMilliseconds();
+
+			printf("  %s Raycast : %5.2f Mrays/s, IsOccluded : %5.2f Mrays/s, %.1f%% hit\n", useAVX ? "AVX" : "SSE",
+				rayCount / raycastMilliseconds / 1000.0, rayCount / occludedMilliseconds / 1000.0, 100.0 * hitCount / rayCount);
+			if(hitCount != occludedCount) {
+				printf("  %u rays hit but %u are occluded\n", hitCount, occludedCount);
+				succeeded = false;
+			}
+		}
+
+		uint32_t mismatchCount = 0;
+		const uint32_t rayStep = std::max(1u, rayCount / checkedRayCount);
+		for(uint32_t rayIndex = 0; rayIndex < rayCount; rayIndex += rayStep) {
+			const TriangleHit reference = RaycastBruteForce(mesh, rays[rayIndex]);
+			for(bool useAVX : useAVXs) {
+				bvh.SetUseAVX(useAVX);
+				mismatchCount += IsSameHit(bvh.Raycast(rays[rayIndex]), reference) ? 0 : 1;
+			}
+		}
+		if(mismatchCount != 0) {
+			printf("  %u rays differ from the brute force test\n", mismatchCount);
+			succeeded = false;
+		}
+	}
+	return succeeded;
+}
@@ -5,7 +5,8 @@
 #define INV_PI 0.3183098862
 #define INV_PI2 0.1013211836
 
-#define D_LIGHT_COUNT 4
+// Must match MaxLightCount in UniformBuffer.h.
+#define D_MAX_LIGHT_COUNT 256
 #define T_POINT_LIGHT 0
 #define T_DIRECTIONAL_LIGHT 2
 
@@ -23,7 +24,16 @@ uniform sampler2D s_texORM;
 uniform sampler2D s_texLUT;
 uniform samplerCube s_texCube;
 uniform samplerCube s_texCubeIrr;
-uniform vec3 u_cameraPos;
+
+layout (std140) uniform FrameBlock {
+	mat4 u_view;
+	mat4 u_projection;
+	vec3 u_cameraPos;
+	float u_clusterSliceScale;
+	vec2 u_framebufferSize;
+	float u_clusterSliceBias;
+	ivec4 u_clusterGrid;
+};
 
 // -------------------- PBR -------------------- //
 
@@ -96,7 +106,9 @@ vec3 SampleAlbedoTexture(vec2 uv) {
 
 vec3 SampleNormalTexture(vec2 uv, vec3 tangent, vec3 bitangent, vec3 normal) {
 	mat3 TBN = mat3(tangent, bitangent, normal);
-	vec3 normalTexture = normalize(texture(s_texNormal, uv).xyz * 2.0 - 1.0);
+	// z is rebuilt from x and y, so two channel BC5 normal maps work the same as RGB ones.
+	vec2 normalXY = texture(s_texNormal, uv).xy * 2.0 - 1.0;
+	vec3 normalTexture = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 	return normalize(TBN * normalTexture);
 }
 
@@ -112,16 +124,31 @@ vec3 CalcuateF0(Material material) {
 
 // -------------------- Light -------------------- //
 
+// Members are ordered so that std140 packs every scalar behind a vec3.
 struct Light {
-	int type;
 	vec3 position;
-	float intensity;
-	vec3 color;
 	float range;
+	vec3 color;
+	float intensity;
 	vec3 direction;
+	int type;
+};
+
+layout (std140) uniform LightBlock {
+	int u_lightCount;
+	Light u_lights[D_MAX_LIGHT_COUNT];
 };
 
-uniform Light u_lights[D_LIGHT_COUNT];
+// Light index list offset and count of every cluster, and the lists themselves, built by LightClusterBuilder.
+uniform usamplerBuffer s_lightClusters;
+uniform usamplerBuffer s_lightIndices;
+
+int GetClusterIndex(vec3 worldPos) {
+	float depth = -(u_view * vec4(worldPos, 1.0)).z;
+	int slice = clamp(int(log(depth) * u_clusterSliceScale + u_clusterSliceBias), 0, u_clusterGrid.z - 1);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / u_framebufferSize * vec2(u_clusterGrid.xy)), ivec2(0), u_clusterGrid.xy - 1);
+	return (slice * u_clusterGrid.y + tile.y) * u_clusterGrid.x + tile.x;
+}
 
 float SmoothDistanceAtt(float squaredDistance, float invSqrAttRadius) {
 	float factor = squaredDistance * invSqrAttRadius;
@@ -178,8 +205,9 @@ vec3 CalculateDirectionalLight(Light light, Material material, vec3 worldPos, ve
 
 vec3 CalculateLights(Material material, vec3 worldPos, vec3 viewDir, vec3 diffuseBRDF) {
 	vec3 color = vec3(0.0);
-	for(int lightIndex = 0; lightIndex < D_LIGHT_COUNT; ++lightIndex) {
-		Light light = u_lights[lightIndex];
+	uvec2 cluster = texelFetch(s_lightClusters, GetClusterIndex(worldPos)).xy;
+	for(uint clusterLightIndex = 0u; clusterLightIndex < cluster.y; ++clusterLightIndex) {
+		Light light = u_lights[int(texelFetch(s_lightIndices, int(cluster.x + clusterLightIndex)).x)];
 		switch(light.type) {
 			case T_POINT_LIGHT:
 				color += CalculatePointLight(light, material, worldPos, viewDir, diffuseBRDF); break;
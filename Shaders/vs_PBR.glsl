@@ -5,6 +5,8 @@ layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_texcoord0;
 layout (location = 3) in vec3 a_tangent;
 layout (location = 4) in vec3 a_bitangent;
+// Per instance world matrix, takes locations 5 to 8.
+layout (location = 5) in mat4 a_model;
 
 
 out vec3 v_worldPos;
@@ -13,17 +15,23 @@ out vec2 v_texcoord0;
 out vec3 v_tangent;
 out vec3 v_bitangent;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameBlock {
+	mat4 u_view;
+	mat4 u_projection;
+	vec3 u_cameraPos;
+	float u_clusterSliceScale;
+	vec2 u_framebufferSize;
+	float u_clusterSliceBias;
+	ivec4 u_clusterGrid;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(a_position, 1.0);
+	gl_Position = u_projection * u_view * a_model * vec4(a_position, 1.0);
 	
-	v_worldPos = vec3(model * vec4(a_position, 1.0));
+	v_worldPos = vec3(a_model * vec4(a_position, 1.0));
 	
-	mat3 modelInvTrans = mat3(transpose(inverse(model)));
+	mat3 modelInvTrans = mat3(transpose(inverse(a_model)));
 	v_normal    = normalize(modelInvTrans * a_normal);
 	v_tangent   = normalize(modelInvTrans * a_tangent);
 	v_bitangent = normalize(modelInvTrans * a_bitangent);
@@ -0,0 +1,222 @@
+#include "AssetCache.h"
+
+#include "Sha256.h"
+#include "Hashers/StringHash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr const char TemporarySuffix[] = ".tmp";
+constexpr const char DependenciesSuffix[] = ".deps";
+
+struct CacheEntry
+{
+	std::filesystem::path m_path;
+	uint64_t m_size;
+	std::filesystem::file_time_type m_lastUsedTime;
+};
+
+// Unique per writer so that processes or threads producing the same entry don't write over each other.
+std::filesystem::path GetTemporaryPath(const std::filesystem::path &entryPath) {
+	static std::atomic<uint32_t> s_temporaryCounter = 0;
+	std::filesystem::path temporaryPath = entryPath;
+	temporaryPath += '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + '.' +
+		std::to_string(s_temporaryCounter++) + TemporarySuffix;
+	return temporaryPath;
+}
+
+}
+
+std::string AssetCache::MakeKey(const char *pSourceFilePath, std::string_view options) {
+	// Tree hashing spreads large sources over all cores, cache lookups hash the source every time.
+	const std::string sourceHash = Sha256FileTree(pSourceFilePath);
+	if(sourceHash.empty()) {
+		return std::string();
+	}
+
+	char optionsHash[17];
+	std::snprintf(optionsHash, sizeof(optionsHash), "%016" PRIx64, cd::StringHash<uint64_t>(options));
+	return sourceHash + '-' + optionsHash;
+}
+
+AssetCache::AssetCache(std::filesystem::path directory, uint64_t maxBytes, std::chrono::hours maxAge) :
+	m_directory(std::move(directory)), m_maxBytes(maxBytes), m_maxAge(maxAge) {
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	m_valid = std::filesystem::is_directory(m_directory, error);
+	if(!m_valid) {
+		printf("Failed to create asset cache directory : %s\n", m_directory.string().c_str());
+	}
+}
+
+std::filesystem::path AssetCache::GetEntryPath(const std::string &key, const char *pExtension) const {
+	return m_directory / (key + pExtension);
+}
+
+std::filesystem::path AssetCache::GetDependenciesPath(const std::filesystem::path &entryPath) {
+	std::filesystem::path dependenciesPath = entryPath;
+	dependenciesPath += DependenciesSuffix;
+	return dependenciesPath;
+}
+
+bool AssetCache::AreDependenciesCurrent(const std::filesystem::path &dependenciesPath) {
+	// Missing when the entry is still being published or eviction only took this half of it.
+	std::ifstream fin(dependenciesPath, std::ios::in | std::ios::binary);
+	if(!fin) {
+		return false;
+	}
+
+	// One "<sha256> <path>" line per dependency, the hash is empty for files which couldn't be read.
+	std::string line;
+	while(std::getline(fin, line)) {
+		const std::size_t separator = line.find(' ');
+		if(std::string::npos == separator || Sha256File(line.c_str() + separator + 1) != line.substr(0, separator)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::optional<std::filesystem::path> AssetCache::Find(const std::string &key, const char *pExtension) const {
+	if(!m_valid || key.empty()) {
+		return std::nullopt;
+	}
+
+	std::filesystem::path entryPath = GetEntryPath(key, pExtension);
+	std::error_code error;
+	if(!std::filesystem::is_regular_file(entryPath, error)) {
+		return std::nullopt;
+	}
+
+	// A stale entry stays until Store replaces it with one made from the current dependencies.
+	const std::filesystem::path dependenciesPath = GetDependenciesPath(entryPath);
+	if(!AreDependenciesCurrent(dependenciesPath)) {
+		printf("Asset cache entry is out of date : %s\n", entryPath.string().c_str());
+		return std::nullopt;
+	}
+
+	// Write time doubles as last use time, read only caches just keep aging.
+	const std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+	std::filesystem::last_write_time(entryPath, now, error);
+	std::filesystem::last_write_time(dependenciesPath, now, error);
+	return entryPath;
+}
+
+std::optional<std::filesystem::path> AssetCache::Store(const std::string &key, const char *pExtension, const ProduceFunction &produce,
+	const std::vector<std::filesystem::path> &dependencyPaths) const {
+	if(!m_valid || key.empty()) {
+		return std::nullopt;
+	}
+
+	// Hashed before produce reads them, so a file edited meanwhile leaves an entry which misses instead of a stale one.
+	std::string dependencies;
+	for(const std::filesystem::path &dependencyPath : dependencyPaths) {
+		dependencies += Sha256File(dependencyPath.string().c_str()) + ' ' + dependencyPath.string() + '\n';
+	}
+
+	std::filesystem::path entryPath = GetEntryPath(key, pExtension);
+	const std::filesystem::path temporaryPath = GetTemporaryPath(entryPath);
+
+	std::error_code error;
+	if(!produce(temporaryPath)) {
+		std::filesystem::remove(temporaryPath, error);
+		return std::nullopt;
+	}
+
+	std::filesystem::rename(temporaryPath, entryPath, error);
+	if(error) {
+		std::filesystem::remove(temporaryPath, error);
+		// Another writer may have published the same entry first, which is as good.
+		if(!std::filesystem::is_regular_file(entryPath, error)) {
+			printf("Failed to publish asset cache entry : %s\n", entryPath.string().c_str());
+			return std::nullopt;
+		}
+	}
+
+	// Published after the entry, Find misses until both are in place.
+	const std::filesystem::path dependenciesPath = GetDependenciesPath(entryPath);
+	const std::filesystem::path temporaryDependenciesPath = GetTemporaryPath(dependenciesPath);
+	{
+		std::ofstream fout(temporaryDependenciesPath, std::ios::out | std::ios::binary);
+		fout.write(dependencies.data(), dependencies.size());
+	}
+	std::filesystem::rename(temporaryDependenciesPath, dependenciesPath, error);
+	if(error) {
+		std::filesystem::remove(temporaryDependenciesPath, error);
+		printf("Failed to publish asset cache dependencies : %s\n", dependenciesPath.string().c_str());
+		return std::nullopt;
+	}
+
+	Evict();
+	return entryPath;
+}
+
+bool AssetCache::Remove(const std::string &key, const char *pExtension) const {
+	if(!m_valid || key.empty()) {
+		return false;
+	}
+
+	const std::filesystem::path entryPath = GetEntryPath(key, pExtension);
+	std::error_code error;
+	std::filesystem::remove(GetDependenciesPath(entryPath), error);
+	return std::filesystem::remove(entryPath, error);
+}
+
+void AssetCache::Evict() const {
+	if(!m_valid) {
+		return;
+	}
+
+	const std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+	std::vector<CacheEntry> entries;
+	uint64_t totalBytes = 0;
+
+	std::error_code error;
+	for(const std::filesystem::directory_entry &directoryEntry : std::filesystem::directory_iterator(m_directory, error)) {
+		if(!directoryEntry.is_regular_file(error)) {
+			continue;
+		}
+
+		CacheEntry entry { directoryEntry.path(), directoryEntry.file_size(error), directoryEntry.last_write_time(error) };
+		if(error) {
+			continue;
+		}
+
+		// Temporary files of live writers are young, old ones were left by writers which crashed.
+		if(now - entry.m_lastUsedTime > m_maxAge) {
+			std::filesystem::remove(entry.m_path, error);
+			continue;
+		}
+		if(entry.m_path.extension() == TemporarySuffix) {
+			continue;
+		}
+
+		totalBytes += entry.m_size;
+		entries.push_back(std::move(entry));
+	}
+
+	if(totalBytes <= m_maxBytes) {
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const CacheEntry &lhs, const CacheEntry &rhs) {
+		return lhs.m_lastUsedTime < rhs.m_lastUsedTime;
+	});
+	for(const CacheEntry &entry : entries) {
+		if(totalBytes <= m_maxBytes) {
+			break;
+		}
+		if(std::filesystem::remove(entry.m_path, error)) {
+			totalBytes -= entry.m_size;
+		}
+	}
+}
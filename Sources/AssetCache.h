@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Content addressed on-disk cache for derived assets such as converted scenes and decoded textures.
+// Entries are files in one local directory, named by a key built from the source file contents and the options
+// which produced them, so changing either one misses instead of returning stale data.
+// Entries are only published by an atomic rename, so a crashed or concurrent writer never leaves a partial entry behind.
+// Other files an entry was made from, like the textures of a scene, are listed with their hashes next to it and
+// checked on every lookup.
+class AssetCache
+{
+public:
+	static constexpr uint64_t DefaultMaxBytes = 1ULL << 30;
+	static constexpr std::chrono::hours DefaultMaxAge = std::chrono::hours(24 * 30);
+
+	using ProduceFunction = std::function<bool(const std::filesystem::path &)>;
+
+	// Hash of the source file contents and the options, such as processor settings and output format versions.
+	// Returns an empty key, which is never cached, if the source can't be read.
+	static std::string MakeKey(const char *pSourceFilePath, std::string_view options);
+
+public:
+	AssetCache() = delete;
+	explicit AssetCache(std::filesystem::path directory, uint64_t maxBytes = DefaultMaxBytes, std::chrono::hours maxAge = DefaultMaxAge);
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+	AssetCache(AssetCache&&) = delete;
+	AssetCache& operator=(AssetCache&&) = delete;
+	~AssetCache() = default;
+
+	bool IsValid() const { return m_valid; }
+	const std::filesystem::path &GetDirectory() const { return m_directory; }
+
+	// Path of the entry if it is cached and none of its dependencies changed since it was stored.
+	// A hit refreshes the entry's age so eviction keeps recently used entries.
+	std::optional<std::filesystem::path> Find(const std::string &key, const char *pExtension) const;
+
+	// Calls produce with a temporary path in the cache directory and publishes the file under key if it returns true.
+	// dependencyPaths are the files produce reads besides the source of the key, they are hashed before it runs.
+	// Returns the entry path, or nullopt if producing or publishing failed.
+	std::optional<std::filesystem::path> Store(const std::string &key, const char *pExtension, const ProduceFunction &produce,
+		const std::vector<std::filesystem::path> &dependencyPaths = {}) const;
+
+	// Removes the entry, e.g. when it turned out to be corrupt. Returns false if there was none.
+	bool Remove(const std::string &key, const char *pExtension) const;
+
+	// Removes entries not used for maxAge, then least recently used ones until the cache fits in maxBytes.
+	void Evict() const;
+
+private:
+	std::filesystem::path GetEntryPath(const std::string &key, const char *pExtension) const;
+	static std::filesystem::path GetDependenciesPath(const std::filesystem::path &entryPath);
+	static bool AreDependenciesCurrent(const std::filesystem::path &dependenciesPath);
+
+	std::filesystem::path m_directory;
+	uint64_t m_maxBytes;
+	std::chrono::hours m_maxAge;
+	bool m_valid = false;
+};
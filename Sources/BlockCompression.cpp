@@ -0,0 +1,478 @@
+#include "BlockCompression.h"
+
+#include "CpuFeatures.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+constexpr uint32_t BlockSize = 4;
+constexpr uint32_t BlockPixelCount = BlockSize * BlockSize;
+
+// Pixels of one block in row major order as float channels, four pixels of a channel fill one SSE register.
+struct BlockPixels
+{
+	alignas(16) float m_channels[4][BlockPixelCount];
+};
+
+// End points of a line through RGBA space, pixels are encoded as evenly spaced levels between them.
+struct Segment
+{
+	float m_start[4];
+	float m_end[4];
+};
+
+// BC1 index of each level from color0 to color1, the two interpolated colors come after the end points.
+constexpr uint32_t ColorIndexOfLevel[4] = { 0, 2, 3, 1 };
+
+// 128 bit block filled from the lowest bit up, as BC7 stores its fields.
+class BlockBitWriter
+{
+public:
+	void Write(uint32_t value, uint32_t bitCount) {
+		const uint32_t wordIndex = m_bitCount / 64;
+		const uint32_t shift = m_bitCount % 64;
+		m_words[wordIndex] |= static_cast<uint64_t>(value) << shift;
+		if(shift + bitCount > 64) {
+			m_words[wordIndex + 1] |= static_cast<uint64_t>(value) >> (64 - shift);
+		}
+		m_bitCount += bitCount;
+	}
+
+	void Store(uint8_t *pBlock) const {
+		for(uint32_t byteIndex = 0; byteIndex < 16; ++byteIndex) {
+			pBlock[byteIndex] = static_cast<uint8_t>(m_words[byteIndex / 8] >> (8 * (byteIndex % 8)));
+		}
+	}
+
+private:
+	uint64_t m_words[2] = {};
+	uint32_t m_bitCount = 0;
+};
+
+void LoadBlock(const uint8_t *pPixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockPixels &block) {
+	alignas(16) uint8_t rgba[BlockPixelCount * 4];
+	const uint32_t firstX = blockX * BlockSize;
+	const uint32_t firstY = blockY * BlockSize;
+	for(uint32_t row = 0; row < BlockSize; ++row) {
+		const uint32_t y = std::min(firstY + row, height - 1);
+		const uint8_t *pRow = pPixels + static_cast<std::size_t>(y) * width * 4;
+		if(firstX + BlockSize <= width) {
+			std::memcpy(rgba + row * 16, pRow + firstX * 4, 16);
+			continue;
+		}
+		for(uint32_t column = 0; column < BlockSize; ++column) {
+			std::memcpy(rgba + row * 16 + column * 4, pRow + std::min(firstX + column, width - 1) * 4, 4);
+		}
+	}
+
+#if CD_ARCH_X86
+	// Each row of four RGBA pixels is widened to floats and transposed into four channel registers.
+	const __m128i zero = _mm_setzero_si128();
+	for(uint32_t row = 0; row < BlockSize; ++row) {
+		const __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(rgba + row * 16));
+		const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+		const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+		__m128 red = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+		__m128 green = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+		__m128 blue = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+		__m128 alpha = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+		_MM_TRANSPOSE4_PS(red, green, blue, alpha);
+		_mm_store_ps(block.m_channels[0] + row * 4, red);
+		_mm_store_ps(block.m_channels[1] + row * 4, green);
+		_mm_store_ps(block.m_channels[2] + row * 4, blue);
+		_mm_store_ps(block.m_channels[3] + row * 4, alpha);
+	}
+#else
+	for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+		for(uint32_t channel = 0; channel < 4; ++channel) {
+			block.m_channels[channel][pixel] = rgba[pixel * 4 + channel];
+		}
+	}
+#endif
+}
+
+void GetChannelRange(const float *pValues, float &minValue, float &maxValue) {
+#if CD_ARCH_X86
+	const __m128 values0 = _mm_load_ps(pValues);
+	const __m128 values1 = _mm_load_ps(pValues + 4);
+	const __m128 values2 = _mm_load_ps(pValues + 8);
+	const __m128 values3 = _mm_load_ps(pValues + 12);
+	__m128 minValues = _mm_min_ps(_mm_min_ps(values0, values1), _mm_min_ps(values2, values3));
+	__m128 maxValues = _mm_max_ps(_mm_max_ps(values0, values1), _mm_max_ps(values2, values3));
+	minValues = _mm_min_ps(minValues, _mm_shuffle_ps(minValues, minValues, _MM_SHUFFLE(1, 0, 3, 2)));
+	maxValues = _mm_max_ps(maxValues, _mm_shuffle_ps(maxValues, maxValues, _MM_SHUFFLE(1, 0, 3, 2)));
+	minValues = _mm_min_ps(minValues, _mm_shuffle_ps(minValues, minValues, _MM_SHUFFLE(2, 3, 0, 1)));
+	maxValues = _mm_max_ps(maxValues, _mm_shuffle_ps(maxValues, maxValues, _MM_SHUFFLE(2, 3, 0, 1)));
+	minValue = _mm_cvtss_f32(minValues);
+	maxValue = _mm_cvtss_f32(maxValues);
+#else
+	minValue = *std::min_element(pValues, pValues + BlockPixelCount);
+	maxValue = *std::max_element(pValues, pValues + BlockPixelCount);
+#endif
+}
+
+// Bounding box diagonal of the first channelCount channels. Channels which fall while the widest one rises are flipped,
+// so the diagonal follows the pixels, and both ends move inwards by inset of the range since extremes are rarely worth one.
+Segment FitSegment(const BlockPixels &block, uint32_t channelCount, float inset) {
+	Segment segment;
+	float means[4];
+	float ranges[4];
+	uint32_t widestChannel = 0;
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		float minValue, maxValue;
+		GetChannelRange(block.m_channels[channel], minValue, maxValue);
+		ranges[channel] = maxValue - minValue;
+		const float insetValue = ranges[channel] * inset;
+		segment.m_start[channel] = minValue + insetValue;
+		segment.m_end[channel] = maxValue - insetValue;
+
+		float sum = 0.0f;
+		for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+			sum += block.m_channels[channel][pixel];
+		}
+		means[channel] = sum / BlockPixelCount;
+
+		if(ranges[channel] > ranges[widestChannel]) {
+			widestChannel = channel;
+		}
+	}
+
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		if(channel == widestChannel) {
+			continue;
+		}
+
+		float covariance = 0.0f;
+		for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+			covariance += (block.m_channels[widestChannel][pixel] - means[widestChannel]) * (block.m_channels[channel][pixel] - means[channel]);
+		}
+		if(covariance < 0.0f) {
+			std::swap(segment.m_start[channel], segment.m_end[channel]);
+		}
+	}
+	return segment;
+}
+
+// Level of every pixel along the segment, 0 at the start and levelCount - 1 at the end, rounded to the nearest one.
+// Only channels from firstChannel to firstChannel + channelCount take part.
+void GetSegmentLevels(const BlockPixels &block, uint32_t firstChannel, uint32_t channelCount, const Segment &segment, uint32_t levelCount,
+	uint8_t *pLevels) {
+	float scaledDirection[4];
+	float lengthSquared = 0.0f;
+	for(uint32_t channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+		scaledDirection[channel] = segment.m_end[channel] - segment.m_start[channel];
+		lengthSquared += scaledDirection[channel] * scaledDirection[channel];
+	}
+	if(lengthSquared < 1e-6f) {
+		std::memset(pLevels, 0, BlockPixelCount);
+		return;
+	}
+
+	const float scale = static_cast<float>(levelCount - 1) / lengthSquared;
+	for(uint32_t channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+		scaledDirection[channel] *= scale;
+	}
+
+#if CD_ARCH_X86
+	const __m128 maxLevel = _mm_set1_ps(static_cast<float>(levelCount - 1));
+	__m128i levels[4];
+	for(uint32_t pixel = 0; pixel < BlockPixelCount; pixel += 4) {
+		__m128 position = _mm_setzero_ps();
+		for(uint32_t channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+			const __m128 offset = _mm_sub_ps(_mm_load_ps(block.m_channels[channel] + pixel), _mm_set1_ps(segment.m_start[channel]));
+			position = _mm_add_ps(position, _mm_mul_ps(offset, _mm_set1_ps(scaledDirection[channel])));
+		}
+		position = _mm_min_ps(_mm_max_ps(position, _mm_setzero_ps()), maxLevel);
+		levels[pixel / 4] = _mm_cvtps_epi32(position);
+	}
+	const __m128i packedLevels = _mm_packus_epi16(_mm_packs_epi32(levels[0], levels[1]), _mm_packs_epi32(levels[2], levels[3]));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(pLevels), packedLevels);
+#else
+	for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+		float position = 0.0f;
+		for(uint32_t channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+			position += (block.m_channels[channel][pixel] - segment.m_start[channel]) * scaledDirection[channel];
+		}
+		position = std::min(std::max(position, 0.0f), static_cast<float>(levelCount - 1));
+		pLevels[pixel] = static_cast<uint8_t>(std::lround(position));
+	}
+#endif
+}
+
+// Squared error of the pixels against the colors which their levels select on the segment.
+float GetSegmentError(const BlockPixels &block, uint32_t channelCount, const Segment &segment, uint32_t levelCount, const uint8_t *pLevels) {
+	const float levelScale = 1.0f / static_cast<float>(levelCount - 1);
+	float error = 0.0f;
+	for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+		const float weight = pLevels[pixel] * levelScale;
+		for(uint32_t channel = 0; channel < channelCount; ++channel) {
+			const float value = segment.m_start[channel] + (segment.m_end[channel] - segment.m_start[channel]) * weight;
+			const float difference = value - block.m_channels[channel][pixel];
+			error += difference * difference;
+		}
+	}
+	return error;
+}
+
+// Least squares end points for fixed pixel levels. Returns false when all pixels share one level.
+bool RefineSegment(const BlockPixels &block, uint32_t channelCount, uint32_t levelCount, const uint8_t *pLevels, Segment &segment) {
+	const float levelScale = 1.0f / static_cast<float>(levelCount - 1);
+	float startStart = 0.0f;
+	float startEnd = 0.0f;
+	float endEnd = 0.0f;
+	float startSums[4] = {};
+	float endSums[4] = {};
+	for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+		const float endWeight = pLevels[pixel] * levelScale;
+		const float startWeight = 1.0f - endWeight;
+		startStart += startWeight * startWeight;
+		startEnd += startWeight * endWeight;
+		endEnd += endWeight * endWeight;
+		for(uint32_t channel = 0; channel < channelCount; ++channel) {
+			startSums[channel] += startWeight * block.m_channels[channel][pixel];
+			endSums[channel] += endWeight * block.m_channels[channel][pixel];
+		}
+	}
+
+	const float determinant = startStart * endEnd - startEnd * startEnd;
+	if(std::abs(determinant) < 1e-6f) {
+		return false;
+	}
+
+	const float inverseDeterminant = 1.0f / determinant;
+	for(uint32_t channel = 0; channel < channelCount; ++channel) {
+		const float start = (endEnd * startSums[channel] - startEnd * endSums[channel]) * inverseDeterminant;
+		const float end = (startStart * endSums[channel] - startEnd * startSums[channel]) * inverseDeterminant;
+		segment.m_start[channel] = std::min(std::max(start, 0.0f), 255.0f);
+		segment.m_end[channel] = std::min(std::max(end, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+// Rounds the color to R5G6B5 and returns it, with the color which the GPU expands it back to.
+uint16_t QuantizeColor(const float *pColor, float *pDecodedColor) {
+	const uint32_t red = static_cast<uint32_t>(std::lround(pColor[0] * (31.0f / 255.0f)));
+	const uint32_t green = static_cast<uint32_t>(std::lround(pColor[1] * (63.0f / 255.0f)));
+	const uint32_t blue = static_cast<uint32_t>(std::lround(pColor[2] * (31.0f / 255.0f)));
+	pDecodedColor[0] = static_cast<float>((red << 3) | (red >> 2));
+	pDecodedColor[1] = static_cast<float>((green << 2) | (green >> 4));
+	pDecodedColor[2] = static_cast<float>((blue << 3) | (blue >> 2));
+	return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+struct ColorBlockFit
+{
+	uint16_t m_color0;
+	uint16_t m_color1;
+	uint8_t m_levels[BlockPixelCount];
+	float m_error;
+};
+
+ColorBlockFit FitColorBlock(const BlockPixels &block, const Segment &segment) {
+	ColorBlockFit fit;
+	Segment decoded;
+	fit.m_color0 = QuantizeColor(segment.m_start, decoded.m_start);
+	fit.m_color1 = QuantizeColor(segment.m_end, decoded.m_end);
+	GetSegmentLevels(block, 0, 3, decoded, 4, fit.m_levels);
+	fit.m_error = GetSegmentError(block, 3, decoded, 4, fit.m_levels);
+	return fit;
+}
+
+// BC1 color block, always in four color mode so that BC3 can share it.
+void EncodeColorBlock(const BlockPixels &block, uint8_t *pBlock) {
+	ColorBlockFit fit = FitColorBlock(block, FitSegment(block, 3, 1.0f / 16.0f));
+
+	Segment refinedSegment;
+	if(RefineSegment(block, 3, 4, fit.m_levels, refinedSegment)) {
+		const ColorBlockFit refinedFit = FitColorBlock(block, refinedSegment);
+		if(refinedFit.m_error < fit.m_error) {
+			fit = refinedFit;
+		}
+	}
+
+	// Four color mode needs color0 > color1, equal colors decode every index to color0.
+	uint32_t indices = 0;
+	if(fit.m_color0 != fit.m_color1) {
+		const bool swapColors = fit.m_color0 < fit.m_color1;
+		if(swapColors) {
+			std::swap(fit.m_color0, fit.m_color1);
+		}
+		for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+			const uint32_t level = swapColors ? 3 - fit.m_levels[pixel] : fit.m_levels[pixel];
+			indices |= ColorIndexOfLevel[level] << (2 * pixel);
+		}
+	}
+
+	pBlock[0] = static_cast<uint8_t>(fit.m_color0);
+	pBlock[1] = static_cast<uint8_t>(fit.m_color0 >> 8);
+	pBlock[2] = static_cast<uint8_t>(fit.m_color1);
+	pBlock[3] = static_cast<uint8_t>(fit.m_color1 >> 8);
+	for(uint32_t byteIndex = 0; byteIndex < 4; ++byteIndex) {
+		pBlock[4 + byteIndex] = static_cast<uint8_t>(indices >> (8 * byteIndex));
+	}
+}
+
+// BC4 block of one channel in eight value mode, the channel's range is exact so nothing is gained by a fit.
+void EncodeChannelBlock(const BlockPixels &block, uint32_t channel, uint8_t *pBlock) {
+	float minValue, maxValue;
+	GetChannelRange(block.m_channels[channel], minValue, maxValue);
+	const uint8_t high = static_cast<uint8_t>(maxValue);
+	const uint8_t low = static_cast<uint8_t>(minValue);
+	pBlock[0] = high;
+	pBlock[1] = low;
+
+	uint64_t indices = 0;
+	if(high > low) {
+		Segment segment;
+		segment.m_start[channel] = minValue;
+		segment.m_end[channel] = maxValue;
+		uint8_t levels[BlockPixelCount];
+		GetSegmentLevels(block, channel, 1, segment, 8, levels);
+
+		// Index 0 is the high value, 1 the low one and 2 to 7 step down from high to low.
+		for(uint32_t pixel = 0; pixel < BlockPixelCount; ++pixel) {
+			const uint32_t level = levels[pixel];
+			const uint64_t index = 7 == level ? 0 : (0 == level ? 1 : 8 - level);
+			indices |= index << (3 * pixel);
+		}
+	}
+
+	for(uint32_t byteIndex = 0; byteIndex < 6; ++byteIndex) {
+		pBlock[2 + byteIndex] = static_cast<uint8_t>(indices >> (8 * byteIndex));
+	}
+}
+
+// 7 bit end point per channel plus a p-bit shared by the channels, which becomes the lowest bit of each 8 bit value.
+void QuantizeBC7Endpoint(const float *pColor, uint8_t *pEndpoint, uint8_t &pBit, float *pDecodedColor) {
+	float bestError = std::numeric_limits<float>::max();
+	for(uint32_t candidatePBit = 0; candidatePBit < 2; ++candidatePBit) {
+		uint8_t endpoint[4];
+		float decoded[4];
+		float error = 0.0f;
+		for(uint32_t channel = 0; channel < 4; ++channel) {
+			const long value = std::lround((pColor[channel] - candidatePBit) * 0.5f);
+			endpoint[channel] = static_cast<uint8_t>(std::min(std::max(value, 0L), 127L));
+			decoded[channel] = static_cast<float>((endpoint[channel] << 1) | candidatePBit);
+			error += (decoded[channel] - pColor[channel]) * (decoded[channel] - pColor[channel]);
+		}
+		if(error < bestError) {
+			bestError = error;
+			pBit = static_cast<uint8_t>(candidatePBit);
+			std::memcpy(pEndpoint, endpoint, sizeof(endpoint));
+			std::memcpy(pDecodedColor, decoded, sizeof(decoded));
+		}
+	}
+}
+
+struct BC7BlockFit
+{
+	uint8_t m_endpoints[2][4];
+	uint8_t m_pBits[2];
+	uint8_t m_levels[BlockPixelCount];
+	float m_error;
+};
+
+BC7BlockFit FitBC7Block(const BlockPixels &block, const Segment &segment) {
+	BC7BlockFit fit;
+	Segment decoded;
+	QuantizeBC7Endpoint(segment.m_start, fit.m_endpoints[0], fit.m_pBits[0], decoded.m_start);
+	QuantizeBC7Endpoint(segment.m_end, fit.m_endpoints[1], fit.m_pBits[1], decoded.m_end);
+	GetSegmentLevels(block, 0, 4, decoded, 16, fit.m_levels);
+	fit.m_error = GetSegmentError(block, 4, decoded, 16, fit.m_levels);
+	return fit;
+}
+
+// BC7 mode 6, the 4 bit weights are close enough to even steps that levels are found as for the other formats.
+void EncodeBC7Block(const BlockPixels &block, uint8_t *pBlock) {
+	BC7BlockFit fit = FitBC7Block(block, FitSegment(block, 4, 1.0f / 32.0f));
+
+	Segment refinedSegment;
+	if(RefineSegment(block, 4, 16, fit.m_levels, refinedSegment)) {
+		const BC7BlockFit refinedFit = FitBC7Block(block, refinedSegment);
+		if(refinedFit.m_error < fit.m_error) {
+			fit = refinedFit;
+		}
+	}
+
+	// The first pixel's index is stored without its top bit, which has to be 0.
+	if(fit.m_levels[0] >= 8) {
+		std::swap(fit.m_endpoints[0], fit.m_endpoints[1]);
+		std::swap(fit.m_pBits[0], fit.m_pBits[1]);
+		for(uint8_t &level : fit.m_levels) {
+			level = static_cast<uint8_t>(15 - level);
+		}
+	}
+
+	BlockBitWriter writer;
+	writer.Write(1 << 6, 7);
+	for(uint32_t channel = 0; channel < 4; ++channel) {
+		writer.Write(fit.m_endpoints[0][channel], 7);
+		writer.Write(fit.m_endpoints[1][channel], 7);
+	}
+	writer.Write(fit.m_pBits[0], 1);
+	writer.Write(fit.m_pBits[1], 1);
+	writer.Write(fit.m_levels[0], 3);
+	for(uint32_t pixel = 1; pixel < BlockPixelCount; ++pixel) {
+		writer.Write(fit.m_levels[pixel], 4);
+	}
+	writer.Store(pBlock);
+}
+
+}
+
+bool IsBlockCompressionSupported(cd::TextureFormat format) {
+	return cd::TextureFormat::BC1 == format || cd::TextureFormat::BC3 == format || cd::TextureFormat::BC5 == format ||
+		cd::TextureFormat::BC7 == format;
+}
+
+uint32_t GetBlockByteCount(cd::TextureFormat format) {
+	return cd::TextureFormat::BC1 == format || cd::TextureFormat::BC4 == format ? 8 : 16;
+}
+
+std::size_t GetBlockCompressedSize(cd::TextureFormat format, uint32_t width, uint32_t height) {
+	const std::size_t blockCount = static_cast<std::size_t>((width + BlockSize - 1) / BlockSize) * ((height + BlockSize - 1) / BlockSize);
+	return blockCount * GetBlockByteCount(format);
+}
+
+void CompressBlocks(cd::TextureFormat format, const uint8_t *pPixels, uint32_t width, uint32_t height, uint8_t *pBlocks, std::size_t threadCount) {
+	if(!IsBlockCompressionSupported(format) || 0 == width || 0 == height) {
+		return;
+	}
+
+	const uint32_t blockCountX = (width + BlockSize - 1) / BlockSize;
+	const uint32_t blockCountY = (height + BlockSize - 1) / BlockSize;
+	const uint32_t blockByteCount = GetBlockByteCount(format);
+	ParallelFor(blockCountY, [=](std::size_t blockY) {
+		BlockPixels block;
+		uint8_t *pBlock = pBlocks + blockY * blockCountX * blockByteCount;
+		for(uint32_t blockX = 0; blockX < blockCountX; ++blockX, pBlock += blockByteCount) {
+			LoadBlock(pPixels, width, height, blockX, static_cast<uint32_t>(blockY), block);
+			switch(format) {
+			case cd::TextureFormat::BC1:
+				EncodeColorBlock(block, pBlock);
+				break;
+			case cd::TextureFormat::BC3:
+				EncodeChannelBlock(block, 3, pBlock);
+				EncodeColorBlock(block, pBlock + 8);
+				break;
+			case cd::TextureFormat::BC5:
+				EncodeChannelBlock(block, 0, pBlock);
+				EncodeChannelBlock(block, 1, pBlock + 8);
+				break;
+			default:
+				EncodeBC7Block(block, pBlock);
+				break;
+			}
+		}
+	}, threadCount);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Scene/TextureFormat.h"
+
+// Encoders for the 4x4 block formats which desktop GL samples directly: BC1, BC3, BC5 and BC7.
+// Blocks are fitted to the bounding box diagonal along the pixels' main correlation, then BC1 endpoints are refined
+// by least squares. BC7 only uses mode 6, one RGBA subset with 16 levels, which is fast to fit and good on smooth data.
+// Pixel levels are found 4 pixels at a time with SSE and block rows are spread over threads.
+
+// Whether CompressBlocks can encode the format.
+bool IsBlockCompressionSupported(cd::TextureFormat format);
+
+// 8 for BC1 and BC4, 16 for the other BC formats.
+uint32_t GetBlockByteCount(cd::TextureFormat format);
+
+// Bytes of a width x height image, partial blocks at the edges count as whole ones.
+std::size_t GetBlockCompressedSize(cd::TextureFormat format, uint32_t width, uint32_t height);
+
+// Encodes tightly packed RGBA8 rows into blocks in row major order, as glCompressedTexImage2D reads them.
+// Blocks over the right or bottom edge repeat the last column or row. BC1 ignores alpha, BC5 only keeps red and green.
+// threadCount 0 means GetDefaultThreadCount().
+void CompressBlocks(cd::TextureFormat format, const uint8_t *pPixels, uint32_t width, uint32_t height, uint8_t *pBlocks,
+	std::size_t threadCount = 0);
@@ -0,0 +1,51 @@
+#include "BufferTexture.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Keeps the buffer non-empty so the texture is complete before the first update.
+constexpr std::size_t MinCapacity = 256;
+
+}
+
+BufferTexture::BufferTexture(GLenum internalFormat) :
+	m_internalFormat(internalFormat) {
+	glGenBuffers(1, &m_bufferID);
+	glGenTextures(1, &m_textureID);
+
+	m_capacity = MinCapacity;
+	glBindBuffer(GL_TEXTURE_BUFFER, m_bufferID);
+	glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, m_internalFormat, m_bufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+BufferTexture::~BufferTexture() {
+	glDeleteTextures(1, &m_textureID);
+	glDeleteBuffers(1, &m_bufferID);
+}
+
+void BufferTexture::Update(const void *pData, std::size_t size) {
+	// Grow geometrically so that a slowly growing array doesn't reallocate every frame.
+	if(size > m_capacity) {
+		m_capacity = std::max(size, m_capacity * 2);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_bufferID);
+	glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr, GL_DYNAMIC_DRAW);
+	if(size > 0) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), pData);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void BufferTexture::Bind(GLuint textureUnit) const {
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureID);
+	glActiveTexture(GL_TEXTURE0);
+}
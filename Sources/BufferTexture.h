@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Buffer texture for arrays which outgrow uniform blocks, read with texelFetch from a samplerBuffer.
+class BufferTexture
+{
+public:
+	BufferTexture() = delete;
+	explicit BufferTexture(GLenum internalFormat);
+	BufferTexture(const BufferTexture&) = delete;
+	BufferTexture& operator=(const BufferTexture&) = delete;
+	BufferTexture(BufferTexture&&) = delete;
+	BufferTexture& operator=(BufferTexture&&) = delete;
+	~BufferTexture();
+
+	// Replaces the contents with one glBufferSubData call into orphaned storage, growing the buffer when needed.
+	void Update(const void *pData, std::size_t size);
+
+	void Bind(GLuint textureUnit) const;
+
+private:
+	GLuint m_bufferID = 0;
+	GLuint m_textureID = 0;
+	GLenum m_internalFormat;
+	std::size_t m_capacity = 0;
+};
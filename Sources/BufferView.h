@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ByteSwapBuffer.h"
+#include "MemoryStream.h"
+
+#include <cassert>
+#include <cstdint>
+#include <istream>
+#include <type_traits>
+#include <vector>
+
+// Typed, length-checked, read-only view of a contiguous array.
+// It doesn't own the data so it must not outlive the archive memory or storage it points to.
+template<typename T>
+class BufferView
+{
+public:
+	static_assert(std::is_trivially_copyable_v<T>, "BufferView only supports trivially copyable element types.");
+
+	BufferView() = default;
+	BufferView(const T *pData, std::size_t count) : m_pData(pData), m_count(count) {}
+	explicit BufferView(const std::vector<T> &data) : m_pData(data.data()), m_count(data.size()) {}
+
+	const T *GetData() const { return m_pData; }
+	std::size_t GetCount() const { return m_count; }
+	std::size_t GetBytes() const { return m_count * sizeof(T); }
+	bool IsEmpty() const { return 0 == m_count; }
+
+	const T &operator[](std::size_t index) const {
+		assert(index < m_count);
+		return m_pData[index];
+	}
+
+	const T *begin() const { return m_pData; }
+	const T *end() const { return m_pData + m_count; }
+
+private:
+	const T *m_pData = nullptr;
+	std::size_t m_count = 0;
+};
+
+// Reads one buffer in the layout written by cd::TOutputArchive::ExportBuffer, a uint64_t byte count and then the payload,
+// from the stream which a cd::InputArchive is reading.
+// For a MemoryInputStream the view borrows the payload in place and nothing is copied.
+// Otherwise, or when the payload isn't aligned for T, it is copied into fallbackStorage and the view points there.
+// Byte swapped streams always take the copy path because the swap happens in place.
+// Returns false and sets failbit if the byte count isn't a whole number of T or runs past the end of the stream.
+template<bool SwapBytesOrder = false, typename T>
+bool ImportBufferView(std::istream &stream, BufferView<T> &view, std::vector<T> &fallbackStorage) {
+	view = BufferView<T>();
+
+	uint64_t bufferBytes;
+	if(!stream.read(reinterpret_cast<char *>(&bufferBytes), sizeof(uint64_t))) {
+		return false;
+	}
+	if constexpr (SwapBytesOrder) {
+		bufferBytes = cd::byte_swap<uint64_t>(bufferBytes);
+	}
+
+	if(bufferBytes % sizeof(T) != 0) {
+		stream.setstate(std::ios_base::failbit);
+		return false;
+	}
+	const std::size_t count = static_cast<std::size_t>(bufferBytes / sizeof(T));
+
+	if(auto *pMemoryBuffer = dynamic_cast<MemoryStreamBuf *>(stream.rdbuf())) {
+		if(bufferBytes > pMemoryBuffer->GetRemaining()) {
+			stream.setstate(std::ios_base::failbit);
+			return false;
+		}
+
+		const char *pCursor = pMemoryBuffer->GetCursor();
+		if(!SwapBytesOrder && reinterpret_cast<std::uintptr_t>(pCursor) % alignof(T) == 0) {
+			view = BufferView<T>(reinterpret_cast<const T *>(pCursor), count);
+			pMemoryBuffer->Advance(static_cast<std::size_t>(bufferBytes));
+			return true;
+		}
+	}
+
+	fallbackStorage.resize(count);
+	if(!stream.read(reinterpret_cast<char *>(fallbackStorage.data()), static_cast<std::streamsize>(bufferBytes))) {
+		fallbackStorage.clear();
+		return false;
+	}
+	if constexpr (SwapBytesOrder) {
+		ByteSwapBuffer(fallbackStorage.data(), count);
+	}
+
+	view = BufferView<T>(fallbackStorage);
+	return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+// Write-combining streambuf which accumulates writes in one large block and forwards full blocks to a target streambuf.
+// cd::OutputArchive issues one ostream::write per scalar so this turns millions of small writes into a few big ones.
+class BlockStreamBuf final : public std::streambuf
+{
+public:
+	static constexpr std::size_t DefaultBlockSize = 1024 * 1024;
+
+	explicit BlockStreamBuf(std::streambuf *pTarget, std::size_t blockSize = DefaultBlockSize) :
+		m_pTarget(pTarget),
+		m_block(blockSize > 0 ? blockSize : DefaultBlockSize) {
+		setp(m_block.data(), m_block.data() + m_block.size());
+	}
+	BlockStreamBuf(const BlockStreamBuf&) = delete;
+	BlockStreamBuf& operator=(const BlockStreamBuf&) = delete;
+	~BlockStreamBuf() { Flush(); }
+
+	std::size_t GetBlockSize() const { return m_block.size(); }
+	std::size_t GetPendingBytes() const { return static_cast<std::size_t>(pptr() - pbase()); }
+	uint64_t GetBytesWritten() const { return m_forwardedBytes + GetPendingBytes(); }
+
+	// Forwards pending bytes to the target and flushes it.
+	bool Flush() {
+		return WritePending() && m_pTarget->pubsync() == 0;
+	}
+
+protected:
+	int_type overflow(int_type ch) override {
+		if(!WritePending()) {
+			return traits_type::eof();
+		}
+		if(!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char *pSource, std::streamsize count) override {
+		const std::size_t bytes = static_cast<std::size_t>(count);
+		if(bytes <= static_cast<std::size_t>(epptr() - pptr())) {
+			std::memcpy(pptr(), pSource, bytes);
+			pbump(static_cast<int>(bytes));
+			return count;
+		}
+
+		if(!WritePending()) {
+			return 0;
+		}
+
+		// Big payloads such as vertex buffers skip the block and go straight to the target.
+		if(bytes >= m_block.size()) {
+			const std::streamsize writtenBytes = m_pTarget->sputn(pSource, count);
+			m_forwardedBytes += static_cast<uint64_t>(writtenBytes);
+			return writtenBytes;
+		}
+
+		std::memcpy(pptr(), pSource, bytes);
+		pbump(static_cast<int>(bytes));
+		return count;
+	}
+
+	int sync() override {
+		return Flush() ? 0 : -1;
+	}
+
+	// Only supports position queries so that tellp() reports how many bytes went through this stream.
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+		if(0 == offset && std::ios_base::cur == direction && (which & std::ios_base::out)) {
+			return pos_type(static_cast<off_type>(GetBytesWritten()));
+		}
+		return pos_type(off_type(-1));
+	}
+
+private:
+	bool WritePending() {
+		const std::streamsize pendingBytes = static_cast<std::streamsize>(GetPendingBytes());
+		if(pendingBytes > 0 && m_pTarget->sputn(pbase(), pendingBytes) != pendingBytes) {
+			return false;
+		}
+		m_forwardedBytes += static_cast<uint64_t>(pendingBytes);
+		setp(m_block.data(), m_block.data() + m_block.size());
+		return true;
+	}
+
+	std::streambuf *m_pTarget;
+	std::vector<char> m_block;
+	uint64_t m_forwardedBytes = 0;
+};
+
+// std::ostream wrapper to construct a cd::OutputArchive on top of BlockStreamBuf.
+// Pending bytes are forwarded on Flush() and on destruction.
+class BufferedOutputStream final : public std::ostream
+{
+public:
+	explicit BufferedOutputStream(std::ostream &target, std::size_t blockSize = BlockStreamBuf::DefaultBlockSize) :
+		std::ostream(nullptr),
+		m_buffer(target.rdbuf(), blockSize) {
+		rdbuf(&m_buffer);
+	}
+	BufferedOutputStream(const BufferedOutputStream&) = delete;
+	BufferedOutputStream& operator=(const BufferedOutputStream&) = delete;
+
+	bool Flush() {
+		if(!m_buffer.Flush()) {
+			setstate(std::ios_base::badbit);
+			return false;
+		}
+		return true;
+	}
+
+	std::size_t GetBlockSize() const { return m_buffer.GetBlockSize(); }
+
+private:
+	BlockStreamBuf m_buffer;
+};
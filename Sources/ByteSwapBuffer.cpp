@@ -0,0 +1,131 @@
+#include "ByteSwapBuffer.h"
+
+#include "CpuFeatures.h"
+#include "Utilities/ByteSwap.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+template<typename T>
+void ByteSwapScalar(unsigned char *pBytes, std::size_t elementCount) {
+	for(std::size_t i = 0; i < elementCount; ++i) {
+		T value;
+		std::memcpy(&value, pBytes + i * sizeof(T), sizeof(T));
+		value = cd::byte_swap<T>(value);
+		std::memcpy(pBytes + i * sizeof(T), &value, sizeof(T));
+	}
+}
+
+#if CD_ARCH_X86
+
+// pshufb masks which reverse the bytes inside every 2, 4 or 8 byte lane of a 128 bit register.
+template<std::size_t ElementSize>
+struct ShuffleMask;
+
+template<>
+struct ShuffleMask<2>
+{
+	static constexpr char Bytes[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+};
+
+template<>
+struct ShuffleMask<4>
+{
+	static constexpr char Bytes[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+};
+
+template<>
+struct ShuffleMask<8>
+{
+	static constexpr char Bytes[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+};
+
+// Returns the number of bytes swapped, the tail is left to the caller.
+template<std::size_t ElementSize>
+CD_TARGET("ssse3") std::size_t ByteSwapSSSE3(unsigned char *pBytes, std::size_t byteCount) {
+	const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ShuffleMask<ElementSize>::Bytes));
+
+	std::size_t offset = 0;
+	for(; offset + 64 <= byteCount; offset += 64) {
+		__m128i *p = reinterpret_cast<__m128i *>(pBytes + offset);
+		__m128i a = _mm_loadu_si128(p + 0);
+		__m128i b = _mm_loadu_si128(p + 1);
+		__m128i c = _mm_loadu_si128(p + 2);
+		__m128i d = _mm_loadu_si128(p + 3);
+		_mm_storeu_si128(p + 0, _mm_shuffle_epi8(a, mask));
+		_mm_storeu_si128(p + 1, _mm_shuffle_epi8(b, mask));
+		_mm_storeu_si128(p + 2, _mm_shuffle_epi8(c, mask));
+		_mm_storeu_si128(p + 3, _mm_shuffle_epi8(d, mask));
+	}
+	for(; offset + 16 <= byteCount; offset += 16) {
+		__m128i *p = reinterpret_cast<__m128i *>(pBytes + offset);
+		_mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+	}
+	return offset;
+}
+
+template<std::size_t ElementSize>
+CD_TARGET("avx2") std::size_t ByteSwapAVX2(unsigned char *pBytes, std::size_t byteCount) {
+	// vpshufb shuffles inside each 128 bit half so the same mask is broadcast to both halves.
+	const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ShuffleMask<ElementSize>::Bytes)));
+
+	std::size_t offset = 0;
+	for(; offset + 128 <= byteCount; offset += 128) {
+		__m256i *p = reinterpret_cast<__m256i *>(pBytes + offset);
+		__m256i a = _mm256_loadu_si256(p + 0);
+		__m256i b = _mm256_loadu_si256(p + 1);
+		__m256i c = _mm256_loadu_si256(p + 2);
+		__m256i d = _mm256_loadu_si256(p + 3);
+		_mm256_storeu_si256(p + 0, _mm256_shuffle_epi8(a, mask));
+		_mm256_storeu_si256(p + 1, _mm256_shuffle_epi8(b, mask));
+		_mm256_storeu_si256(p + 2, _mm256_shuffle_epi8(c, mask));
+		_mm256_storeu_si256(p + 3, _mm256_shuffle_epi8(d, mask));
+	}
+	for(; offset + 32 <= byteCount; offset += 32) {
+		__m256i *p = reinterpret_cast<__m256i *>(pBytes + offset);
+		_mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+	}
+	return offset;
+}
+
+#endif
+
+template<typename T>
+void ByteSwapElements(void *pData, std::size_t elementCount) {
+	unsigned char *pBytes = static_cast<unsigned char *>(pData);
+	const std::size_t byteCount = elementCount * sizeof(T);
+	std::size_t swappedBytes = 0;
+
+#if CD_ARCH_X86
+	const CpuFeatures &features = CpuFeatures::Get();
+	if(features.m_avx2) {
+		swappedBytes = ByteSwapAVX2<sizeof(T)>(pBytes, byteCount);
+	}
+	if(features.m_ssse3) {
+		swappedBytes += ByteSwapSSSE3<sizeof(T)>(pBytes + swappedBytes, byteCount - swappedBytes);
+	}
+#endif
+
+	ByteSwapScalar<T>(pBytes + swappedBytes, (byteCount - swappedBytes) / sizeof(T));
+}
+
+}
+
+void ByteSwapBuffer16(void *pData, std::size_t elementCount) {
+	ByteSwapElements<uint16_t>(pData, elementCount);
+}
+
+void ByteSwapBuffer32(void *pData, std::size_t elementCount) {
+	ByteSwapElements<uint32_t>(pData, elementCount);
+}
+
+void ByteSwapBuffer64(void *pData, std::size_t elementCount) {
+	ByteSwapElements<uint64_t>(pData, elementCount);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "IO/InputArchive.hpp"
+#include "IO/OutputArchive.hpp"
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Bulk in-place byte swap of arrays of 2, 4 or 8 byte elements.
+// Uses AVX2 or SSSE3 pshufb kernels when the CPU has them and cd::byte_swap otherwise.
+void ByteSwapBuffer16(void *pData, std::size_t elementCount);
+void ByteSwapBuffer32(void *pData, std::size_t elementCount);
+void ByteSwapBuffer64(void *pData, std::size_t elementCount);
+
+namespace details
+{
+
+template<typename T, typename = void>
+struct SwapScalar
+{
+	using Type = T;
+};
+
+// Math types such as cd::Vec3f and cd::Quaternion, and ObjectIDs, are arrays of ValueType.
+template<typename T>
+struct SwapScalar<T, std::void_t<typename T::ValueType>>
+{
+	using Type = typename T::ValueType;
+};
+
+}
+
+// Swaps every scalar inside count elements of T.
+template<typename T>
+void ByteSwapBuffer(T *pData, std::size_t count) {
+	using Scalar = typename details::SwapScalar<T>::Type;
+	static_assert(sizeof(T) % sizeof(Scalar) == 0);
+
+	const std::size_t scalarCount = count * (sizeof(T) / sizeof(Scalar));
+	if constexpr (2 == sizeof(Scalar)) {
+		ByteSwapBuffer16(pData, scalarCount);
+	}
+	else if constexpr (4 == sizeof(Scalar)) {
+		ByteSwapBuffer32(pData, scalarCount);
+	}
+	else if constexpr (8 == sizeof(Scalar)) {
+		ByteSwapBuffer64(pData, scalarCount);
+	}
+	else {
+		static_assert(1 == sizeof(Scalar), "Unsupported scalar size.");
+	}
+}
+
+// Typed counterpart of TOutputArchive::ExportBuffer.
+// The SDK archives copy buffers raw, so a SwapBytes archive would leave every element in the native byte order.
+// This swaps the elements too, so typed arrays round-trip across endians. ImportBufferView is the reading side.
+template<bool SwapBytesOrder, typename T>
+cd::TOutputArchive<SwapBytesOrder> &ExportTypedBuffer(cd::TOutputArchive<SwapBytesOrder> &outputArchive, const T *pData, std::size_t count) {
+	if constexpr (SwapBytesOrder) {
+		std::vector<T> swapped(pData, pData + count);
+		ByteSwapBuffer(swapped.data(), count);
+		outputArchive.ExportBuffer(swapped.data(), count);
+	}
+	else {
+		outputArchive.ExportBuffer(pData, count);
+	}
+	return outputArchive;
+}
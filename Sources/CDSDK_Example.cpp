@@ -8,6 +8,11 @@
 #include "shader.h"
 #include "camera.h"
 #include "scene.h"
+#include "BufferTexture.h"
+#include "LightCluster.h"
+#include "UniformBuffer.h"
+
+#include <memory>
 
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void ProcessInput(GLFWwindow* window, float deltaTime);
@@ -16,11 +21,9 @@ void ScrollCallback(GLFWwindow* window, double xIn, double yIn);
 
 Camera g_camera;
 
-std::string GetUniformName(const uint32_t index, const char *member) {
-    std::stringstream ss;
-    ss << "u_lights[" << index << "]." << member;
-    return ss.str();
-}
+// Units above the ones RenderQueue uses for material textures.
+constexpr GLuint LightClustersTextureUnit = 8;
+constexpr GLuint LightIndicesTextureUnit = 9;
 
 void SetupCamera(const cd::SceneDatabase *pScene) {
     if(pScene->GetCameraCount()) {
@@ -75,6 +78,32 @@ int main()
 
     SetupCamera(scene.GetSene());
 
+    glm::mat4 rootTransform(1.0f);
+    rootTransform = glm::scale(rootTransform, glm::vec3(0.4f, 0.4f, 0.4f));
+    rootTransform = glm::rotate(rootTransform, glm::radians(180.0f), glm::vec3(0.0, 1.0, 0.0));
+    scene.SetRootTransform(rootTransform);
+
+    // Per frame camera data and the lights are uploaded as whole uniform blocks, one buffer update each per frame.
+    auto pFrameBuffer = std::make_unique<UniformBuffer>(UniformBlockBinding::Frame, sizeof(FrameUniforms));
+    auto pLightBuffer = std::make_unique<UniformBuffer>(UniformBlockBinding::Lights, sizeof(LightBlock));
+    pbrShader.BindUniformBlock("FrameBlock", static_cast<GLuint>(UniformBlockBinding::Frame));
+    pbrShader.BindUniformBlock("LightBlock", static_cast<GLuint>(UniformBlockBinding::Lights));
+
+    FrameUniforms frameUniforms;
+    std::unique_ptr<LightBlock> pLightBlock = std::make_unique<LightBlock>();
+
+    // Lights are culled per view frustum cluster on the CPU, fragments only shade the lights of their cluster.
+    LightClusterBuilder lightClusterBuilder;
+    auto pLightClusters = std::make_unique<BufferTexture>(GL_RG32UI);
+    auto pLightIndices = std::make_unique<BufferTexture>(GL_R16UI);
+    pbrShader.Use();
+    pbrShader.SetInt("s_lightClusters", LightClustersTextureUnit);
+    pbrShader.SetInt("s_lightIndices", LightIndicesTextureUnit);
+    frameUniforms.m_clusterGrid = glm::ivec4(LightClusterBuilder::TileCountX, LightClusterBuilder::TileCountY, LightClusterBuilder::SliceCount, 0);
+
+    bool renderStatsPrinted = false;
+    bool textureStreamStatsPrinted = false;
+    bool pickButtonDown = false;
     float deltaTime = 0.0f;
     float lastFrameTime = 0.0f;
     while (!glfwWindowShouldClose(window)) {
@@ -91,47 +120,72 @@ int main()
         glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 projection = glm::perspective(glm::radians(g_camera.m_zoom), 800.0f / 600.0f, 0.001f, 10000.0f);
+        const float fovY = glm::radians(g_camera.m_zoom);
+        constexpr float aspect = 800.0f / 600.0f;
+        constexpr float nearPlane = 0.001f;
+        constexpr float farPlane = 10000.0f;
+        glm::mat4 projection = glm::perspective(fovY, aspect, nearPlane, farPlane);
         glm::mat4 view = g_camera.GetViewMatrix();
-        glm::mat4 model(1.0f);
-        model = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
-        model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0, 1.0, 0.0));
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-
-        pbrShader.Use();
-        pbrShader.SetMat4("projection", projection);
-        pbrShader.SetMat4("view", view);
-        pbrShader.SetMat4("model", model);
-        pbrShader.SetVec3("u_cameraPos", g_camera.m_position);
 
         const cd::SceneDatabase *pScene = scene.GetSene();
-        if(pScene->GetLightCount()) {
-            uint32_t index = 0;
-            for(const auto &light : pScene->GetLights()) {
-                const int type = static_cast<int>(light.GetType());
-                const glm::vec3 position = { light.GetPosition().x(), light.GetPosition().y(), light.GetPosition().z() };
-                const float intensity = light.GetIntensity();
-                const glm::vec3 clolr = { light.GetColor().x(), light.GetColor().y(), light.GetColor().z() };
-                const float range = light.GetRange();
-                const glm::vec3 direction = { light.GetDirection().x(), light.GetDirection().y() , light.GetDirection().z() };
-
-                pbrShader.SetInt(GetUniformName(index, "type"), type);
-                pbrShader.SetVec3(GetUniformName(index, "position"), position);
-                pbrShader.SetFloat(GetUniformName(index, "intensity"), intensity);
-                pbrShader.SetVec3(GetUniformName(index, "color"), clolr);
-                pbrShader.SetFloat(GetUniformName(index, "range"), range);
-                pbrShader.SetVec3(GetUniformName(index, "direction"), direction);
-
-                ++index;
-            }
+        pLightBuffer->Update(pLightBlock.get(), FillLightBlock(pScene->GetLights(), *pLightBlock));
+
+        lightClusterBuilder.SetProjection(fovY, aspect, nearPlane, farPlane);
+        lightClusterBuilder.Build(view, pLightBlock->m_lights, static_cast<uint32_t>(pLightBlock->m_lightCount), &scene.GetThreadPool());
+        const std::vector<uint32_t> &lightClusters = lightClusterBuilder.GetClusters();
+        const std::vector<uint16_t> &lightIndices = lightClusterBuilder.GetLightIndices();
+        pLightClusters->Update(lightClusters.data(), lightClusters.size() * sizeof(uint32_t));
+        pLightIndices->Update(lightIndices.data(), lightIndices.size() * sizeof(uint16_t));
+        pLightClusters->Bind(LightClustersTextureUnit);
+        pLightIndices->Bind(LightIndicesTextureUnit);
+
+        int framebufferWidth = 0;
+        int framebufferHeight = 0;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+        frameUniforms.m_view = view;
+        frameUniforms.m_projection = projection;
+        frameUniforms.m_cameraPosition = g_camera.m_position;
+        frameUniforms.m_clusterSliceScale = lightClusterBuilder.GetSliceScale();
+        frameUniforms.m_clusterSliceBias = lightClusterBuilder.GetSliceBias();
+        frameUniforms.m_framebufferSize = glm::vec2(framebufferWidth, framebufferHeight);
+        pFrameBuffer->Update(frameUniforms);
+
+        scene.Draw(pbrShader, projection * view);
+        if (!renderStatsPrinted) {
+            scene.GetCullingStats().Print();
+            scene.GetRenderStats().Print();
+            renderStatsPrinted = true;
+        }
+        if (!textureStreamStatsPrinted && !scene.IsStreamingTextures()) {
+            scene.GetTextureStreamStats().Print();
+            textureStreamStatsPrinted = true;
         }
 
-        scene.Draw(pbrShader);
+        // The cursor is captured by the camera, so a left click picks along the view direction.
+        const bool pickButtonPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (pickButtonPressed && !pickButtonDown) {
+            const cd::Ray pickRay(cd::Vec3f(g_camera.m_position.x, g_camera.m_position.y, g_camera.m_position.z),
+                cd::Vec3f(g_camera.m_front.x, g_camera.m_front.y, g_camera.m_front.z));
+            const ScenePickResult pickResult = scene.Pick(pickRay);
+            if (pickResult.IsValid()) {
+                printf("Picked triangle %u of mesh %u of node %u at distance %f\n", pickResult.m_triangleIndex, pickResult.m_meshIndex,
+                    pickResult.m_nodeIndex, pickResult.m_distance);
+            }
+        }
+        pickButtonDown = pickButtonPressed;
 
         glfwPollEvents();
         glfwSwapBuffers(window);
     }
 
+    // GL objects have to be deleted while the context exists.
+    pFrameBuffer.reset();
+    pLightBuffer.reset();
+    pLightClusters.reset();
+    pLightIndices.reset();
+    scene.Clear();
+
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,82 @@
+#include "CpuFeatures.h"
+
+#if CD_ARCH_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+
+#if CD_ARCH_X86
+
+void QueryCpuid(unsigned int leaf, unsigned int subLeaf, unsigned int registers[4]) {
+#ifdef _MSC_VER
+	int values[4];
+	__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subLeaf));
+	for(int i = 0; i < 4; ++i) {
+		registers[i] = static_cast<unsigned int>(values[i]);
+	}
+#else
+	__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+unsigned long long QueryXCR0() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+CpuFeatures DetectCpuFeatures() {
+	CpuFeatures features;
+
+	unsigned int registers[4];
+	QueryCpuid(0, 0, registers);
+	const unsigned int maxLeaf = registers[0];
+	if(maxLeaf < 1) {
+		return features;
+	}
+
+	QueryCpuid(1, 0, registers);
+	const unsigned int ecx1 = registers[2];
+	features.m_ssse3 = (ecx1 & (1u << 9)) != 0;
+	features.m_sse41 = (ecx1 & (1u << 19)) != 0;
+
+	// AVX state has to be enabled by the OS as well, otherwise ymm registers aren't preserved across context switches.
+	const bool osxsave = (ecx1 & (1u << 27)) != 0;
+	const bool avx = (ecx1 & (1u << 28)) != 0;
+	const bool osSavesYmm = osxsave && (QueryXCR0() & 0x6) == 0x6;
+
+	if(maxLeaf >= 7) {
+		QueryCpuid(7, 0, registers);
+		const unsigned int ebx7 = registers[1];
+		features.m_avx2 = avx && osSavesYmm && (ebx7 & (1u << 5)) != 0;
+		features.m_sha = (ebx7 & (1u << 29)) != 0;
+	}
+
+	return features;
+}
+
+#else
+
+CpuFeatures DetectCpuFeatures() {
+	return CpuFeatures();
+}
+
+#endif
+
+}
+
+const CpuFeatures &CpuFeatures::Get() {
+	static const CpuFeatures features = DetectCpuFeatures();
+	return features;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CD_ARCH_X86 1
+#else
+#define CD_ARCH_X86 0
+#endif
+
+// GCC and Clang need per-function target attributes to emit instructions beyond the baseline ISA.
+// MSVC emits any intrinsic without them.
+#if CD_ARCH_X86 && (defined(__GNUC__) || defined(__clang__))
+#define CD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CD_TARGET(isa)
+#endif
+
+// Instruction set extensions detected at runtime, queried once per process.
+struct CpuFeatures
+{
+	bool m_ssse3 = false;
+	bool m_sse41 = false;
+	bool m_avx2 = false;
+	bool m_sha = false;
+
+	static const CpuFeatures &Get();
+};
@@ -0,0 +1,237 @@
+#include "FrustumCulling.h"
+
+#include "CpuFeatures.h"
+
+#include <cmath>
+#include <cstdio>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+using PlaneComponents = FrustumCuller::PlaneComponents;
+
+#if CD_ARCH_X86
+
+// Counts the boxes of a vector whose bit in outsideMask is clear and writes their flags.
+uint32_t WriteVisible(int outsideMask, uint32_t laneCount, uint8_t *pVisible) {
+	uint32_t visibleCount = 0;
+	for(uint32_t lane = 0; lane < laneCount; ++lane) {
+		pVisible[lane] = (outsideMask >> lane) & 1 ? 0 : 1;
+		visibleCount += pVisible[lane];
+	}
+	return visibleCount;
+}
+
+// Returns a bit per box which is outside of a plane.
+int TestBoxesSSE(const PlaneComponents &planes, __m128 centerX, __m128 centerY, __m128 centerZ, __m128 extentX, __m128 extentY, __m128 extentZ) {
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 outside = _mm_setzero_ps();
+	for(uint32_t planeIndex = 0; planeIndex < FrustumCuller::PlaneCount; ++planeIndex) {
+		const __m128 normalX = _mm_set1_ps(planes.m_normalX[planeIndex]);
+		const __m128 normalY = _mm_set1_ps(planes.m_normalY[planeIndex]);
+		const __m128 normalZ = _mm_set1_ps(planes.m_normalZ[planeIndex]);
+		const __m128 distance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+			_mm_mul_ps(normalZ, centerZ)), _mm_set1_ps(planes.m_distance[planeIndex]));
+		const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentX),
+			_mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentY)), _mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentZ));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+	}
+	return _mm_movemask_ps(outside);
+}
+
+uint32_t CullSSE(const PlaneComponents &planes, const CullingBoxes &boxes, uint32_t firstBox, uint32_t boxCount, uint8_t *pVisible) {
+	const float *pComponents[6] = { boxes.GetCenterX() + firstBox, boxes.GetCenterY() + firstBox, boxes.GetCenterZ() + firstBox,
+		boxes.GetExtentX() + firstBox, boxes.GetExtentY() + firstBox, boxes.GetExtentZ() + firstBox };
+	const uint32_t vectorCount = boxCount & ~3u;
+	uint32_t visibleCount = 0;
+	for(uint32_t boxOffset = 0; boxOffset < vectorCount; boxOffset += 4) {
+		const int outsideMask = TestBoxesSSE(planes, _mm_loadu_ps(pComponents[0] + boxOffset), _mm_loadu_ps(pComponents[1] + boxOffset),
+			_mm_loadu_ps(pComponents[2] + boxOffset), _mm_loadu_ps(pComponents[3] + boxOffset), _mm_loadu_ps(pComponents[4] + boxOffset),
+			_mm_loadu_ps(pComponents[5] + boxOffset));
+		visibleCount += WriteVisible(outsideMask, 4, pVisible + boxOffset);
+	}
+
+	// The last boxes are copied into a zero padded vector, so that small ranges such as BVH leaves don't fall back to scalar code.
+	const uint32_t tailCount = boxCount - vectorCount;
+	if(tailCount > 0) {
+		float tail[6][4] = {};
+		for(uint32_t component = 0; component < 6; ++component) {
+			for(uint32_t lane = 0; lane < tailCount; ++lane) {
+				tail[component][lane] = pComponents[component][vectorCount + lane];
+			}
+		}
+		const int outsideMask = TestBoxesSSE(planes, _mm_loadu_ps(tail[0]), _mm_loadu_ps(tail[1]), _mm_loadu_ps(tail[2]),
+			_mm_loadu_ps(tail[3]), _mm_loadu_ps(tail[4]), _mm_loadu_ps(tail[5]));
+		visibleCount += WriteVisible(outsideMask, tailCount, pVisible + vectorCount);
+	}
+	return visibleCount;
+}
+
+CD_TARGET("avx2") int TestBoxesAVX(const PlaneComponents &planes, __m256 centerX, __m256 centerY, __m256 centerZ, __m256 extentX, __m256 extentY, __m256 extentZ) {
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 outside = _mm256_setzero_ps();
+	for(uint32_t planeIndex = 0; planeIndex < FrustumCuller::PlaneCount; ++planeIndex) {
+		const __m256 normalX = _mm256_set1_ps(planes.m_normalX[planeIndex]);
+		const __m256 normalY = _mm256_set1_ps(planes.m_normalY[planeIndex]);
+		const __m256 normalZ = _mm256_set1_ps(planes.m_normalZ[planeIndex]);
+		const __m256 distance = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, centerX), _mm256_mul_ps(normalY, centerY)),
+			_mm256_mul_ps(normalZ, centerZ)), _mm256_set1_ps(planes.m_distance[planeIndex]));
+		const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, normalX), extentX),
+			_mm256_mul_ps(_mm256_andnot_ps(signMask, normalY), extentY)), _mm256_mul_ps(_mm256_andnot_ps(signMask, normalZ), extentZ));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+	}
+	return _mm256_movemask_ps(outside);
+}
+
+CD_TARGET("avx2") uint32_t CullAVX(const PlaneComponents &planes, const CullingBoxes &boxes, uint32_t firstBox, uint32_t boxCount, uint8_t *pVisible) {
+	const float *pComponents[6] = { boxes.GetCenterX() + firstBox, boxes.GetCenterY() + firstBox, boxes.GetCenterZ() + firstBox,
+		boxes.GetExtentX() + firstBox, boxes.GetExtentY() + firstBox, boxes.GetExtentZ() + firstBox };
+	const uint32_t vectorCount = boxCount & ~7u;
+	uint32_t visibleCount = 0;
+	for(uint32_t boxOffset = 0; boxOffset < vectorCount; boxOffset += 8) {
+		const int outsideMask = TestBoxesAVX(planes, _mm256_loadu_ps(pComponents[0] + boxOffset), _mm256_loadu_ps(pComponents[1] + boxOffset),
+			_mm256_loadu_ps(pComponents[2] + boxOffset), _mm256_loadu_ps(pComponents[3] + boxOffset), _mm256_loadu_ps(pComponents[4] + boxOffset),
+			_mm256_loadu_ps(pComponents[5] + boxOffset));
+		visibleCount += WriteVisible(outsideMask, 8, pVisible + boxOffset);
+	}
+
+	// Masked loads read the last boxes without touching memory past the range, masked lanes are zero.
+	const uint32_t tailCount = boxCount - vectorCount;
+	if(tailCount > 0) {
+		const __m256i laneMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(tailCount)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		const int outsideMask = TestBoxesAVX(planes, _mm256_maskload_ps(pComponents[0] + vectorCount, laneMask),
+			_mm256_maskload_ps(pComponents[1] + vectorCount, laneMask), _mm256_maskload_ps(pComponents[2] + vectorCount, laneMask),
+			_mm256_maskload_ps(pComponents[3] + vectorCount, laneMask), _mm256_maskload_ps(pComponents[4] + vectorCount, laneMask),
+			_mm256_maskload_ps(pComponents[5] + vectorCount, laneMask));
+		visibleCount += WriteVisible(outsideMask, tailCount, pVisible + vectorCount);
+	}
+	return visibleCount;
+}
+
+#else
+
+// Signed distance of the center plus the box's radius along the normal, negative means outside.
+bool IsBoxVisible(const PlaneComponents &planes, const CullingBoxes &boxes, uint32_t boxIndex) {
+	for(uint32_t planeIndex = 0; planeIndex < FrustumCuller::PlaneCount; ++planeIndex) {
+		const float distance = planes.m_normalX[planeIndex] * boxes.GetCenterX()[boxIndex] +
+			planes.m_normalY[planeIndex] * boxes.GetCenterY()[boxIndex] +
+			planes.m_normalZ[planeIndex] * boxes.GetCenterZ()[boxIndex] - planes.m_distance[planeIndex];
+		const float radius = std::abs(planes.m_normalX[planeIndex]) * boxes.GetExtentX()[boxIndex] +
+			std::abs(planes.m_normalY[planeIndex]) * boxes.GetExtentY()[boxIndex] +
+			std::abs(planes.m_normalZ[planeIndex]) * boxes.GetExtentZ()[boxIndex];
+		if(distance + radius < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t CullScalar(const PlaneComponents &planes, const CullingBoxes &boxes, uint32_t firstBox, uint32_t boxCount, uint8_t *pVisible) {
+	uint32_t visibleCount = 0;
+	for(uint32_t boxOffset = 0; boxOffset < boxCount; ++boxOffset) {
+		pVisible[boxOffset] = IsBoxVisible(planes, boxes, firstBox + boxOffset) ? 1 : 0;
+		visibleCount += pVisible[boxOffset];
+	}
+	return visibleCount;
+}
+
+#endif
+
+}
+
+void CullingStats::Print() const {
+	printf("Culling stats : %u boxes tested, %u visible, %u culled\n", m_testedBoxes, m_visibleBoxes, m_testedBoxes - m_visibleBoxes);
+}
+
+void CullingBoxes::Clear() {
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+}
+
+void CullingBoxes::Reserve(std::size_t count) {
+	m_centerX.reserve(count);
+	m_centerY.reserve(count);
+	m_centerZ.reserve(count);
+	m_extentX.reserve(count);
+	m_extentY.reserve(count);
+	m_extentZ.reserve(count);
+}
+
+void CullingBoxes::Add(const glm::vec3 &center, const glm::vec3 &extent) {
+	m_centerX.push_back(center.x);
+	m_centerY.push_back(center.y);
+	m_centerZ.push_back(center.z);
+	m_extentX.push_back(extent.x);
+	m_extentY.push_back(extent.y);
+	m_extentZ.push_back(extent.z);
+}
+
+void CullingBoxes::AddTransformed(const cd::AABB &localBox, const glm::mat4 &worldMatrix) {
+	const cd::Point boxCenter = localBox.Center();
+	const cd::Point boxSize = localBox.Size();
+	const glm::vec3 localCenter(boxCenter.x(), boxCenter.y(), boxCenter.z());
+	const glm::vec3 localExtent = glm::vec3(boxSize.x(), boxSize.y(), boxSize.z()) * 0.5f;
+
+	// Each world axis extent is the sum of the local extents projected on it, Arvo's method in center extent form.
+	const glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(localCenter, 1.0f));
+	const glm::mat3 absMatrix = glm::mat3(glm::abs(glm::vec3(worldMatrix[0])), glm::abs(glm::vec3(worldMatrix[1])), glm::abs(glm::vec3(worldMatrix[2])));
+	Add(center, absMatrix * localExtent);
+}
+
+void FrustumCuller::SetViewProjection(const glm::mat4 &viewProjection) {
+	// Rows of the clip space matrix, glm stores columns.
+	const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	// -w <= x, y, z <= w in GL clip space.
+	const glm::vec4 planeEquations[PlaneCount] = {
+		row3 + row0, row3 - row0,
+		row3 + row1, row3 - row1,
+		row3 + row2, row3 - row2,
+	};
+
+	// a * x + b * y + c * z + d >= 0 becomes dot(normal, p) >= distance with a unit normal.
+	for(uint32_t planeIndex = 0; planeIndex < PlaneCount; ++planeIndex) {
+		const glm::vec4 &equation = planeEquations[planeIndex];
+		const float inverseLength = 1.0f / glm::length(glm::vec3(equation));
+		m_planes[planeIndex] = cd::Plane(cd::Vec3f(equation.x * inverseLength, equation.y * inverseLength, equation.z * inverseLength),
+			-equation.w * inverseLength);
+		m_planeComponents.m_normalX[planeIndex] = m_planes[planeIndex].GetNormal().x();
+		m_planeComponents.m_normalY[planeIndex] = m_planes[planeIndex].GetNormal().y();
+		m_planeComponents.m_normalZ[planeIndex] = m_planes[planeIndex].GetNormal().z();
+		m_planeComponents.m_distance[planeIndex] = m_planes[planeIndex].GetDistance();
+	}
+}
+
+uint32_t FrustumCuller::GetBatchSize() {
+#if CD_ARCH_X86
+	return CpuFeatures::Get().m_avx2 ? 8 : 4;
+#else
+	return 1;
+#endif
+}
+
+uint32_t FrustumCuller::Cull(const CullingBoxes &boxes, uint8_t *pVisible) const {
+	return Cull(boxes, 0, boxes.GetCount(), pVisible);
+}
+
+uint32_t FrustumCuller::Cull(const CullingBoxes &boxes, uint32_t firstBox, uint32_t boxCount, uint8_t *pVisible) const {
+#if CD_ARCH_X86
+	if(CpuFeatures::Get().m_avx2) {
+		return CullAVX(m_planeComponents, boxes, firstBox, boxCount, pVisible);
+	}
+	return CullSSE(m_planeComponents, boxes, firstBox, boxCount, pVisible);
+#else
+	return CullScalar(m_planeComponents, boxes, firstBox, boxCount, pVisible);
+#endif
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Math/Box.hpp"
+#include "Math/Plane.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct CullingStats
+{
+	uint32_t m_testedBoxes = 0;
+	uint32_t m_visibleBoxes = 0;
+
+	void Print() const;
+};
+
+// Axis aligned boxes as centers and half extents in SoA layout, so that FrustumCuller tests several boxes per instruction.
+class CullingBoxes
+{
+public:
+	CullingBoxes() = default;
+	CullingBoxes(const CullingBoxes&) = delete;
+	CullingBoxes& operator=(const CullingBoxes&) = delete;
+	CullingBoxes(CullingBoxes&&) = default;
+	CullingBoxes& operator=(CullingBoxes&&) = default;
+	~CullingBoxes() = default;
+
+	void Clear();
+	void Reserve(std::size_t count);
+
+	void Add(const glm::vec3 &center, const glm::vec3 &extent);
+
+	// Adds the world space bounds of a local box, the box of the transformed box's corners.
+	// cd::AABB::Transform would do the same, but it projects the extents on the transposed matrix,
+	// which shrinks the bounds of rotated meshes with non-uniform scale.
+	void AddTransformed(const cd::AABB &localBox, const glm::mat4 &worldMatrix);
+
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_centerX.size()); }
+
+	const float *GetCenterX() const { return m_centerX.data(); }
+	const float *GetCenterY() const { return m_centerY.data(); }
+	const float *GetCenterZ() const { return m_centerZ.data(); }
+	const float *GetExtentX() const { return m_extentX.data(); }
+	const float *GetExtentY() const { return m_extentY.data(); }
+	const float *GetExtentZ() const { return m_extentZ.data(); }
+
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+};
+
+// Culls boxes against the six planes of a view frustum.
+// Boxes are tested 8 at a time with AVX when the CPU has AVX2, otherwise 4 at a time with SSE, including the last ones of a range.
+// A box is only culled when it is completely outside of one plane, so boxes near frustum corners may be kept.
+class FrustumCuller
+{
+public:
+	static constexpr uint32_t PlaneCount = 6;
+
+	// Planes as separate arrays of components, which the kernels broadcast.
+	struct PlaneComponents
+	{
+		float m_normalX[PlaneCount];
+		float m_normalY[PlaneCount];
+		float m_normalZ[PlaneCount];
+		float m_distance[PlaneCount];
+	};
+
+	// Number of boxes tested by one instruction, ranges of up to this many boxes cost about as much as one box.
+	static uint32_t GetBatchSize();
+
+public:
+	FrustumCuller() = default;
+
+	// Extracts the planes from a clip space matrix such as projection * view, Gribb and Hartmann style.
+	// Planes point inside, a point p is inside when dot(normal, p) >= distance for every plane.
+	void SetViewProjection(const glm::mat4 &viewProjection);
+
+	const std::array<cd::Plane, PlaneCount> &GetPlanes() const { return m_planes; }
+
+	// Writes 1 for boxes which may be visible and 0 for culled ones, returns the number of visible boxes.
+	uint32_t Cull(const CullingBoxes &boxes, uint8_t *pVisible) const;
+
+	// Culls boxes [firstBox, firstBox + boxCount), pVisible[i] is the flag of box firstBox + i.
+	uint32_t Cull(const CullingBoxes &boxes, uint32_t firstBox, uint32_t boxCount, uint8_t *pVisible) const;
+
+private:
+	std::array<cd::Plane, PlaneCount> m_planes;
+	PlaneComponents m_planeComponents = {};
+};
@@ -2,6 +2,10 @@
 #include <stb_image.h>
 
 #include "GLConsumer.h"
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+#include "ParallelFor.h"
+#include "TextureBaker.h"
 
 constexpr cd::MaterialTextureType PossibleTextureTypes[] = {
 	cd::MaterialTextureType::BaseColor,
@@ -9,6 +13,132 @@ constexpr cd::MaterialTextureType PossibleTextureTypes[] = {
 	cd::MaterialTextureType::Metallic,
 };
 
+namespace
+{
+
+// EXT_texture_compression_s3tc, which isn't part of any core version.
+constexpr GLenum CompressedRGBS3TCDXT1 = 0x83F0;
+constexpr GLenum CompressedRGBAS3TCDXT5 = 0x83F3;
+
+bool HasExtension(const char* pName) {
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint extensionIndex = 0; extensionIndex < extensionCount; ++extensionIndex) {
+		if (0 == strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(extensionIndex))), pName)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// GL format of a baked texture, or 0 if the context can't sample it. RGTC is core since GL 3.0.
+GLenum GetCompressedFormat(cd::TextureFormat format) {
+	static const bool s_s3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+	static const bool s_bptc = GLAD_GL_VERSION_4_2 || HasExtension("GL_ARB_texture_compression_bptc");
+	switch (format) {
+	case cd::TextureFormat::BC1:
+		return s_s3tc ? CompressedRGBS3TCDXT1 : 0;
+	case cd::TextureFormat::BC3:
+		return s_s3tc ? CompressedRGBAS3TCDXT5 : 0;
+	case cd::TextureFormat::BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	case cd::TextureFormat::BC7:
+		return s_bptc ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+	default:
+		return 0;
+	}
+}
+
+struct PixelFormat
+{
+	GLenum m_internalFormat = 0;
+	GLenum m_format = 0;
+	uint32_t m_componentCount = 0;
+};
+
+// GL layout of an uncompressed texture, m_componentCount is 0 for formats which aren't 8 bit unsigned normalized.
+PixelFormat GetPixelFormat(cd::TextureFormat format) {
+	switch (format) {
+	case cd::TextureFormat::R8:
+		return { GL_R8, GL_RED, 1 };
+	case cd::TextureFormat::RG8:
+		return { GL_RG8, GL_RG, 2 };
+	case cd::TextureFormat::RGB8:
+		return { GL_RGB8, GL_RGB, 3 };
+	case cd::TextureFormat::RGBA8:
+		return { GL_RGBA8, GL_RGBA, 4 };
+	case cd::TextureFormat::BGRA8:
+		return { GL_RGBA8, GL_BGRA, 4 };
+	default:
+		return {};
+	}
+}
+
+// The first level of an 8 bit texture as the RGBA8 which GenerateMips takes. Missing channels are 0, missing alpha is opaque.
+std::vector<uint8_t> ExpandToRGBA8(const std::byte* pPixels, uint32_t width, uint32_t height, cd::TextureFormat format) {
+	const std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+	const uint32_t componentCount = GetPixelFormat(format).m_componentCount;
+	const uint8_t* pSource = reinterpret_cast<const uint8_t*>(pPixels);
+	std::vector<uint8_t> rgba(pixelCount * 4, 0);
+	for (std::size_t pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex) {
+		uint8_t* pTarget = rgba.data() + pixelIndex * 4;
+		std::copy(pSource + pixelIndex * componentCount, pSource + (pixelIndex + 1) * componentCount, pTarget);
+		if (cd::TextureFormat::BGRA8 == format) {
+			std::swap(pTarget[0], pTarget[2]);
+		}
+		if (componentCount < 4) {
+			pTarget[3] = 255;
+		}
+	}
+	return rgba;
+}
+
+// Bytes of the first mipCount levels in the texture's format, 0 for formats which are neither baked nor 8 bit.
+std::size_t GetLevelsSize(cd::TextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount) {
+	if (IsBlockCompressionSupported(format)) {
+		return GetMipChainSize(format, width, height, mipCount);
+	}
+
+	std::size_t size = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip) {
+		size += static_cast<std::size_t>(std::max(width >> mip, 1u)) * std::max(height >> mip, 1u) * GetPixelFormat(format).m_componentCount;
+	}
+	return size;
+}
+
+// Levels which the raw data holds, the whole chain or only the first level. 0 when its size doesn't match either,
+// which is how an embedded image file is told apart, its bytes have nothing to do with the texture's format.
+uint32_t GetStoredMipCount(const cd::Texture& sceneTexture) {
+	const uint32_t width = sceneTexture.GetWidth();
+	const uint32_t height = sceneTexture.GetHeight();
+	const std::size_t rawDataSize = sceneTexture.GetRawData().size();
+	if (0 == width || 0 == height || 0 == GetLevelsSize(sceneTexture.GetFormat(), width, height, 1)) {
+		return 0;
+	}
+
+	const uint32_t mipCount = sceneTexture.UseMipMap() ? GetMipCount(width, height) : 1;
+	if (rawDataSize == GetLevelsSize(sceneTexture.GetFormat(), width, height, mipCount)) {
+		return mipCount;
+	}
+	return rawDataSize == GetLevelsSize(sceneTexture.GetFormat(), width, height, 1) ? 1 : 0;
+}
+
+// Producers which didn't compute mesh AABBs leave them empty, which would cull the mesh everywhere.
+cd::AABB GetMeshBounds(const cd::Mesh& mesh) {
+	const std::vector<cd::Point>& positions = mesh.GetVertexPositions();
+	if (!mesh.GetAABB().IsEmpty() || positions.empty()) {
+		return mesh.GetAABB();
+	}
+
+	cd::AABB bounds(positions[0], positions[0]);
+	for (const cd::Point& position : positions) {
+		bounds.Merge(cd::AABB(position, position));
+	}
+	return bounds;
+}
+
+}
+
 void GLConsumer::Execute(const cd::SceneDatabase *pSceneDatabase) {
 	printf("Loading scene : %s\n", pSceneDatabase->GetName());
 	printf("Node count : %d\n", pSceneDatabase->GetNodeCount());
@@ -23,42 +153,67 @@ void GLConsumer::Execute(const cd::SceneDatabase *pSceneDatabase) {
 
 	m_meshes.reserve(pSceneDatabase->GetMeshCount());
 
-	for(const auto &mesh : pSceneDatabase->GetMeshes()) {
-		printf("\t\tMesh ID : %d\n", mesh.GetID().Data());
-		printf("\t\tMesh Name : %s\n", mesh.GetName());
-		printf("\t\tVertex Count : %d\n", mesh.GetVertexCount());
-		printf("\t\tPolygon Count : %d\n", mesh.GetPolygonCount());
-
-		std::vector<GLVertex> vertices;
-		std::vector<unsigned int> indices;
-		std::vector<GLTexture> textures;
+	// Vertex and index streams only read the SceneDatabase so they are built for all meshes in parallel.
+	// GL objects still have to be created on this thread below.
+	const std::vector<cd::Mesh> &meshes = pSceneDatabase->GetMeshes();
+	std::vector<std::vector<GLVertex>> meshVertices(meshes.size());
+	std::vector<std::vector<unsigned int>> meshIndices(meshes.size());
+	ParallelFor(meshes.size(), [this, &meshes, &meshVertices, &meshIndices](std::size_t meshIndex) {
+		const cd::Mesh &mesh = meshes[meshIndex];
 
 		// 1. vertices
-		vertices.reserve(mesh.GetVertexCount());
-		for(uint32_t vertexIndex = 0; vertexIndex < mesh.GetVertexCount(); ++vertexIndex) {
-			const cd::Point &position = mesh.GetVertexPosition(vertexIndex);
-			const cd::Direction &normal = mesh.GetVertexNormal(vertexIndex);
-			const cd::Direction &tangent = mesh.GetVertexTangent(vertexIndex);
-			const cd::UV &uv = mesh.GetVertexUV(0, vertexIndex);
-			const cd::Direction &bitangent = mesh.GetVertexBiTangent(vertexIndex);
+		std::vector<GLVertex> &vertices = meshVertices[meshIndex];
+		const auto itQuantized = m_quantizedVertices.find(mesh.GetID().Data());
+		if(itQuantized != m_quantizedVertices.end() && itQuantized->second.size() == mesh.GetVertexCount()) {
+			vertices = cd::MoveTemp(itQuantized->second);
+		}
+		else {
+			vertices.reserve(mesh.GetVertexCount());
+			for(uint32_t vertexIndex = 0; vertexIndex < mesh.GetVertexCount(); ++vertexIndex) {
+				const cd::Point &position = mesh.GetVertexPosition(vertexIndex);
+				const cd::Direction &normal = mesh.GetVertexNormal(vertexIndex);
+				const cd::Direction &tangent = mesh.GetVertexTangent(vertexIndex);
+				const cd::UV &uv = mesh.GetVertexUV(0, vertexIndex);
+				const cd::Direction &bitangent = mesh.GetVertexBiTangent(vertexIndex);
 
-			GLVertex vertex;
-			memcpy(&vertex.m_position, &position, 3 * sizeof(float));
-			memcpy(&vertex.m_normal, &normal, 3 * sizeof(float));
-			memcpy(&vertex.m_tangent, &tangent, 3 * sizeof(float));
-			memcpy(&vertex.m_texCoords, &uv, 2 * sizeof(float));
-			memcpy(&vertex.m_bitangent, &bitangent, 3 * sizeof(float));
+				GLVertex vertex;
+				memcpy(&vertex.m_position, &position, 3 * sizeof(float));
+				memcpy(&vertex.m_normal, &normal, 3 * sizeof(float));
+				memcpy(&vertex.m_tangent, &tangent, 3 * sizeof(float));
+				memcpy(&vertex.m_texCoords, &uv, 2 * sizeof(float));
+				memcpy(&vertex.m_bitangent, &bitangent, 3 * sizeof(float));
 
-			vertices.emplace_back(std::move(vertex));
+				vertices.emplace_back(std::move(vertex));
+			}
 		}
 
 		// 2. indices
+		std::vector<unsigned int> &indices = meshIndices[meshIndex];
 		indices.reserve(mesh.GetPolygonCount() * 3);
 		for(uint32_t i = 0; i < mesh.GetPolygonCount(); ++i) {
 			indices.push_back(mesh.GetPolygon(i)[0].Data());
 			indices.push_back(mesh.GetPolygon(i)[1].Data());
 			indices.push_back(mesh.GetPolygon(i)[2].Data());
 		}
+	});
+	m_quantizedVertices.clear();
+
+	std::size_t vertexCount = 0;
+	std::size_t indexCount = 0;
+	for(std::size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+		vertexCount += meshVertices[meshIndex].size();
+		indexCount += meshIndices[meshIndex].size();
+	}
+	m_meshArena.Reserve(m_meshArena.GetVertexCount() + vertexCount, m_meshArena.GetIndexCount() + indexCount);
+
+	for(std::size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+		const cd::Mesh &mesh = meshes[meshIndex];
+		printf("\t\tMesh ID : %d\n", mesh.GetID().Data());
+		printf("\t\tMesh Name : %s\n", mesh.GetName());
+		printf("\t\tVertex Count : %d\n", mesh.GetVertexCount());
+		printf("\t\tPolygon Count : %d\n", mesh.GetPolygonCount());
+
+		std::vector<GLTexture> textures;
 
 		// 3. material
 		const cd::MaterialID &materialID = mesh.GetMaterialID();
@@ -119,7 +274,7 @@ void GLConsumer::Execute(const cd::SceneDatabase *pSceneDatabase) {
 			textures.insert(textures.end(), typeTextures.begin(), typeTextures.end());
 		}
 
-		m_meshes.emplace_back(GLMesh(vertices, indices, textures));
+		m_meshes.emplace_back(GLMesh(m_meshArena, meshVertices[meshIndex], meshIndices[meshIndex], textures, GetMeshBounds(mesh)));
 	}
 
 	// const uint32_t nodeCount = pSceneDatabase->GetNodeCount();
@@ -146,8 +301,9 @@ std::vector<GLTexture> GLConsumer::LoadMaterialTextures(const cd::SceneDatabase*
 
 	const std::optional<cd::TextureID>& textureID = material.GetTextureID(textureType);
 	if (textureID.has_value()) {
-		const std::string& texturePath = pSceneDatabase->GetTexture(textureID->Data()).GetPath();
-		std::string textureName = texturePath.substr(texturePath.rfind('/') + 1, texturePath.rfind('.') - texturePath.rfind('/') - 1);
+		const cd::Texture& sceneTexture = pSceneDatabase->GetTexture(textureID->Data());
+		const std::string texturePath = sceneTexture.GetPath();
+		std::string textureName = GetTextureName(texturePath);
 		printf("\t\t\t\tTexture Name: %s\n", textureName.c_str());
 
 		const auto it = m_textureLoaded.find(textureName);
@@ -156,7 +312,10 @@ std::vector<GLTexture> GLConsumer::LoadMaterialTextures(const cd::SceneDatabase*
 		}
 		else {
 			GLTexture texture;
-			texture.m_id = TextureFromFile(textureName.c_str(), "Models/textures");
+			texture.m_id = TextureFromRawData(sceneTexture);
+			if (0 == texture.m_id) {
+				texture.m_id = TextureFromFile(textureName.c_str(), "Models/textures");
+			}
 			texture.m_type = textureType;
 			texture.m_path = texturePath;
 			m_textureLoaded[textureName] = texture;
@@ -170,37 +329,127 @@ std::vector<GLTexture> GLConsumer::LoadMaterialTextures(const cd::SceneDatabase*
 	return textures;
 }
 
+void GLConsumer::AddQuantizedMesh(const QuantizedMesh& quantizedMesh) {
+	std::vector<GLVertex> vertices(quantizedMesh.GetVertexCount());
+	quantizedMesh.DecodeVertices(vertices.data());
+
+	std::lock_guard<std::mutex> lock(m_quantizedVerticesMutex);
+	m_quantizedVertices[quantizedMesh.GetID()] = cd::MoveTemp(vertices);
+}
+
+std::string GLConsumer::GetTextureFilePath(const std::string& texturePath) {
+	return "Models/textures/" + GetTextureName(texturePath) + ".png";
+}
+
+std::string GLConsumer::GetTextureName(const std::string& texturePath) {
+	return texturePath.substr(texturePath.rfind('/') + 1, texturePath.rfind('.') - texturePath.rfind('/') - 1);
+}
+
 unsigned int GLConsumer::TextureFromFile(const char* path, const std::string& directory) {
 	std::string filename(path);
 	filename = directory + '/' + filename + ".png";
 	printf("\t\t\t\t[Read File] Texture Path: %s\n", filename.c_str());
 
+	return m_textureStreamer.Request(cd::MoveTemp(filename));
+}
+
+unsigned int GLConsumer::TextureFromRawData(const cd::Texture& sceneTexture) {
+	if (!sceneTexture.ExistRawData()) {
+		return 0;
+	}
+
+	// Levels which this context can't sample fall back to the file rather than being taken for one.
+	const uint32_t mipCount = GetStoredMipCount(sceneTexture);
+	if (mipCount > 0) {
+		return IsBlockCompressionSupported(sceneTexture.GetFormat()) ? TextureFromBlocks(sceneTexture, mipCount) : TextureFromPixels(sceneTexture, mipCount);
+	}
+
+	const std::vector<std::byte>& rawData = sceneTexture.GetRawData();
+	if (!DecodedImage::IsEncodedImage(rawData.data(), rawData.size())) {
+		return 0;
+	}
+	printf("\t\t\t\t[Raw Data] Embedded Image: %zu bytes\n", rawData.size());
+
+	return m_textureStreamer.Request(sceneTexture.GetPath(), rawData);
+}
+
+unsigned int GLConsumer::TextureFromBlocks(const cd::Texture& sceneTexture, uint32_t mipCount) {
+	const GLenum internalFormat = GetCompressedFormat(sceneTexture.GetFormat());
+	if (0 == internalFormat) {
+		return 0;
+	}
+
+	const uint32_t width = sceneTexture.GetWidth();
+	const uint32_t height = sceneTexture.GetHeight();
+	const std::vector<std::byte>& rawData = sceneTexture.GetRawData();
+	printf("\t\t\t\t[Raw Data] Texture Size: %ux%u, %u mips, %zu bytes\n", width, height, mipCount, rawData.size());
+
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format = GL_RGBA;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	std::size_t offset = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip) {
+		const uint32_t levelWidth = std::max(width >> mip, 1u);
+		const uint32_t levelHeight = std::max(height >> mip, 1u);
+		const std::size_t levelSize = GetBlockCompressedSize(sceneTexture.GetFormat(), levelWidth, levelHeight);
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(mip), internalFormat, static_cast<GLsizei>(levelWidth), static_cast<GLsizei>(levelHeight), 0,
+			static_cast<GLsizei>(levelSize), rawData.data() + offset);
+		offset += levelSize;
 	}
-	else {
-		printf("\n\t\t\t\tTexture failed to load at path: %s\n\n", filename.c_str());
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return textureID;
+}
+
+unsigned int GLConsumer::TextureFromPixels(const cd::Texture& sceneTexture, uint32_t mipCount) {
+	const PixelFormat pixelFormat = GetPixelFormat(sceneTexture.GetFormat());
+	const uint32_t width = sceneTexture.GetWidth();
+	const uint32_t height = sceneTexture.GetHeight();
+	const std::vector<std::byte>& rawData = sceneTexture.GetRawData();
+	const bool generateMips = sceneTexture.UseMipMap() && 1 == mipCount && GetMipCount(width, height) > 1;
+	printf("\t\t\t\t[Raw Data] Texture Size: %ux%u, %u components, %u mips, %zu bytes\n", width, height, pixelFormat.m_componentCount,
+		mipCount, rawData.size());
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// Rows are tightly packed, which isn't 4 byte aligned for 1 to 3 components.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	std::size_t offset = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip) {
+		const uint32_t levelWidth = std::max(width >> mip, 1u);
+		const uint32_t levelHeight = std::max(height >> mip, 1u);
+		glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(mip), pixelFormat.m_internalFormat, static_cast<GLsizei>(levelWidth), static_cast<GLsizei>(levelHeight), 0,
+			pixelFormat.m_format, GL_UNSIGNED_BYTE, rawData.data() + offset);
+		offset += static_cast<std::size_t>(levelWidth) * levelHeight * pixelFormat.m_componentCount;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// The remaining levels are filtered like the baked ones, sRGB color in linear space and normals renormalized,
+	// which glGenerateMipmap doesn't do. They are RGBA8, GL drops the channels the internal format doesn't have.
+	if (generateMips) {
+		const std::vector<uint8_t> baseLevel = ExpandToRGBA8(rawData.data(), width, height, sceneTexture.GetFormat());
+		const std::vector<MipLevel> mips = GenerateMips(baseLevel.data(), width, height, GetMipContent(sceneTexture.GetType()));
+		for (const MipLevel& mipLevel : mips) {
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(mipCount), pixelFormat.m_internalFormat, static_cast<GLsizei>(mipLevel.m_width),
+				static_cast<GLsizei>(mipLevel.m_height), 0, GL_RGBA, GL_UNSIGNED_BYTE, mipLevel.m_pixels.data());
+			++mipCount;
+		}
 	}
-	stbi_image_free(data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mipCount - 1));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
 
 	return textureID;
 }
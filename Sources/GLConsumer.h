@@ -2,11 +2,15 @@
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include "mesh.h"
+#include "QuantizedMesh.h"
+#include "TextureStreamer.h"
 #include "Framework/IConsumer.h"
 #include "Scene/SceneDatabase.h"
 
@@ -14,7 +18,9 @@ class GLConsumer final : public cdtools::IConsumer
 {
 public:
 	GLConsumer() = delete;
-	explicit GLConsumer(std::string filePath) : m_filePath(cd::MoveTemp(filePath)) {}
+	// Mesh geometry is uploaded into meshArena, textures are requested from textureStreamer and arrive while rendering.
+	GLConsumer(std::string filePath, GLMeshArena &meshArena, TextureStreamer &textureStreamer) :
+		m_filePath(cd::MoveTemp(filePath)), m_meshArena(meshArena), m_textureStreamer(textureStreamer) {}
 	GLConsumer(const GLConsumer&) = delete;
 	GLConsumer& operator=(const GLConsumer&) = delete;
 	GLConsumer(GLConsumer&&) = delete;
@@ -25,12 +31,39 @@ public:
 
 	std::vector<GLMesh>&& GetMeshes() { return cd::MoveTemp(m_meshes); }
 
+	// Decodes the GL vertices of a quantized mesh straight from its compact streams, Execute then uses them instead of
+	// converting the mesh's float streams. Thread safe, meant for MappedCDProducer::SetQuantizedMeshCallback.
+	void AddQuantizedMesh(const QuantizedMesh& quantizedMesh);
+
+	// Image of the texture's name in Models/textures, which is loaded when the texture has no usable raw data.
+	static std::string GetTextureFilePath(const std::string& texturePath);
+
 private:
 	std::string m_filePath;
+	GLMeshArena &m_meshArena;
+	TextureStreamer &m_textureStreamer;
 	std::vector<GLMesh> m_meshes;
 	std::map<std::string, GLTexture> m_textureLoaded;
 
+	// By mesh ID.
+	std::mutex m_quantizedVerticesMutex;
+	std::unordered_map<uint32_t, std::vector<GLVertex>> m_quantizedVertices;
+
+	static std::string GetTextureName(const std::string& texturePath);
+
 	std::vector<GLTexture> LoadMaterialTextures(const cd::SceneDatabase* pSceneDatabase, const cd::Material& material, const cd::MaterialTextureType textureType);
-	
+
+	// Creates the texture object right away, the file decodes and uploads in the background, see TextureStreamer.
 	unsigned int TextureFromFile(const char* path, const std::string& directory);
+
+	// Uses the data embedded in the scene instead of opening the texture's file: a block compressed mip chain baked by
+	// BakeTexture, 8 bit pixels of the texture's format and size, or the bytes of an image file, such as the processor
+	// stores with SetEmbedTextureFilesEnable, which are decoded and uploaded by the TextureStreamer.
+	// Returns 0 if the texture has no raw data or none which this context can use.
+	unsigned int TextureFromRawData(const cd::Texture& sceneTexture);
+
+	// Upload the first mipCount levels stored back to back in the raw data. Blocks return 0 if the context can't
+	// sample their format, pixels generate the remaining levels when only the first one is stored.
+	unsigned int TextureFromBlocks(const cd::Texture& sceneTexture, uint32_t mipCount);
+	unsigned int TextureFromPixels(const cd::Texture& sceneTexture, uint32_t mipCount);
 };
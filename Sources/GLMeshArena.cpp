@@ -0,0 +1,127 @@
+#include "GLMeshArena.h"
+
+#include "mesh.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+
+GLuint CreateBuffer(std::size_t size) {
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return buffer;
+}
+
+void CopyBuffer(GLuint source, GLuint destination, std::size_t size) {
+	if(0 == size) {
+		return;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, source);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(size));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+}
+
+GLMeshArena::GLMeshArena() {
+	glGenVertexArrays(1, &m_VAO);
+}
+
+GLMeshArena::~GLMeshArena() {
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_EBO);
+	glDeleteVertexArrays(1, &m_VAO);
+}
+
+void GLMeshArena::Reserve(std::size_t vertexCount, std::size_t indexCount) {
+	if(vertexCount > m_vertexCapacity || indexCount > m_indexCapacity) {
+		Grow(std::max(vertexCount, m_vertexCapacity), std::max(indexCount, m_indexCapacity));
+	}
+}
+
+GLMeshRange GLMeshArena::Allocate(const GLVertex *pVertices, uint32_t vertexCount, const uint32_t *pIndices, uint32_t indexCount) {
+	// Geometric growth keeps unreserved loading linear.
+	if(m_vertexCount + vertexCount > m_vertexCapacity || m_indexCount + indexCount > m_indexCapacity) {
+		Grow(std::max(m_vertexCount + vertexCount, m_vertexCapacity * 2), std::max(m_indexCount + indexCount, m_indexCapacity * 2));
+	}
+
+	GLMeshRange range;
+	range.m_baseVertex = static_cast<GLint>(m_vertexCount);
+	range.m_firstIndex = static_cast<uint32_t>(m_indexCount);
+	range.m_indexCount = indexCount;
+
+	// Copy targets leave the element array binding of whichever VAO is bound alone.
+	if(vertexCount > 0) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_VBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(m_vertexCount * sizeof(GLVertex)), static_cast<GLsizeiptr>(vertexCount * sizeof(GLVertex)), pVertices);
+	}
+	if(indexCount > 0) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(m_indexCount * sizeof(uint32_t)), static_cast<GLsizeiptr>(indexCount * sizeof(uint32_t)), pIndices);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_vertexCount += vertexCount;
+	m_indexCount += indexCount;
+	return range;
+}
+
+void GLMeshArena::Bind() const {
+	glBindVertexArray(m_VAO);
+}
+
+void GLMeshArena::Grow(std::size_t vertexCapacity, std::size_t indexCapacity) {
+	const GLuint VBO = CreateBuffer(vertexCapacity * sizeof(GLVertex));
+	const GLuint EBO = CreateBuffer(indexCapacity * sizeof(uint32_t));
+	if(0 == VBO || 0 == EBO) {
+		printf("Failed to grow mesh arena to %zu vertices and %zu indices\n", vertexCapacity, indexCapacity);
+	}
+
+	CopyBuffer(m_VBO, VBO, m_vertexCount * sizeof(GLVertex));
+	CopyBuffer(m_EBO, EBO, m_indexCount * sizeof(uint32_t));
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_EBO);
+
+	m_VBO = VBO;
+	m_EBO = EBO;
+	m_vertexCapacity = vertexCapacity;
+	m_indexCapacity = indexCapacity;
+	SetupVertexArray();
+}
+
+void GLMeshArena::SetupVertexArray() {
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+
+	// Position
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (void *)offsetof(GLVertex, m_position));
+
+	// Normal
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (void *)offsetof(GLVertex, m_normal));
+
+	// UV
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (void *)offsetof(GLVertex, m_texCoords));
+
+	// Tangent
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (void *)offsetof(GLVertex, m_tangent));
+
+	// Bitangent
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (void *)offsetof(GLVertex, m_bitangent));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+struct GLVertex;
+
+// Where a mesh lives in a GLMeshArena. Indices are relative to the mesh's first vertex.
+struct GLMeshRange
+{
+	GLint m_baseVertex = 0;
+	uint32_t m_firstIndex = 0;
+	uint32_t m_indexCount = 0;
+};
+
+// One vertex buffer, one index buffer and one VAO shared by all meshes of a scene.
+// Meshes are suballocated back to back and drawn with glDrawElementsBaseVertex, so drawing a scene binds a single VAO.
+// Buffers grow by copying on the GPU when an allocation doesn't fit, Reserve up front to avoid that.
+class GLMeshArena
+{
+public:
+	GLMeshArena();
+	GLMeshArena(const GLMeshArena&) = delete;
+	GLMeshArena& operator=(const GLMeshArena&) = delete;
+	GLMeshArena(GLMeshArena&&) = delete;
+	GLMeshArena& operator=(GLMeshArena&&) = delete;
+	~GLMeshArena();
+
+	void Reserve(std::size_t vertexCount, std::size_t indexCount);
+
+	// Uploads one mesh behind the previous ones.
+	GLMeshRange Allocate(const GLVertex *pVertices, uint32_t vertexCount, const uint32_t *pIndices, uint32_t indexCount);
+
+	// Binds the shared VAO, which every draw of an arena mesh needs.
+	void Bind() const;
+
+	GLuint GetVertexBuffer() const { return m_VBO; }
+	GLuint GetIndexBuffer() const { return m_EBO; }
+	std::size_t GetVertexCount() const { return m_vertexCount; }
+	std::size_t GetIndexCount() const { return m_indexCount; }
+
+private:
+	void Grow(std::size_t vertexCapacity, std::size_t indexCapacity);
+	void SetupVertexArray();
+
+	GLuint m_VAO = 0;
+	GLuint m_VBO = 0;
+	GLuint m_EBO = 0;
+	std::size_t m_vertexCount = 0;
+	std::size_t m_vertexCapacity = 0;
+	std::size_t m_indexCount = 0;
+	std::size_t m_indexCapacity = 0;
+};
@@ -0,0 +1,164 @@
+#include "LightCluster.h"
+
+#include "CpuFeatures.h"
+#include "Scene/LightType.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+// Sphere radius marking lights which touch every cluster.
+constexpr float UnboundedRadius = -1.0f;
+
+}
+
+void LightClusterBuilder::SetProjection(float fovY, float aspect, float nearPlane, float farPlane) {
+	if(!m_sliceBounds.empty() && fovY == m_fovY && aspect == m_aspect && nearPlane == m_nearPlane && farPlane == m_farPlane) {
+		return;
+	}
+
+	m_fovY = fovY;
+	m_aspect = aspect;
+	m_nearPlane = nearPlane;
+	m_farPlane = farPlane;
+
+	const float depthRatioLog = std::log(farPlane / nearPlane);
+	m_sliceScale = SliceCount / depthRatioLog;
+	m_sliceBias = -(SliceCount * std::log(nearPlane)) / depthRatioLog;
+
+	const float tanHalfFovY = std::tan(fovY * 0.5f);
+	const float tanHalfFovX = tanHalfFovY * aspect;
+
+	// Tiles are frustum slabs, whose bounds along x and y are reached at either the near or the far depth of the slice.
+	m_sliceBounds.resize(SliceCount);
+	for(uint32_t sliceIndex = 0; sliceIndex < SliceCount; ++sliceIndex) {
+		const float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(sliceIndex) / SliceCount);
+		const float sliceFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(sliceIndex + 1) / SliceCount);
+
+		SliceBounds &bounds = m_sliceBounds[sliceIndex];
+		bounds.m_minZ = -sliceFar;
+		bounds.m_maxZ = -sliceNear;
+		for(uint32_t tileY = 0; tileY < TileCountY; ++tileY) {
+			const float ndcMinY = -1.0f + 2.0f * tileY / TileCountY;
+			const float ndcMaxY = -1.0f + 2.0f * (tileY + 1) / TileCountY;
+			for(uint32_t tileX = 0; tileX < TileCountX; ++tileX) {
+				const float ndcMinX = -1.0f + 2.0f * tileX / TileCountX;
+				const float ndcMaxX = -1.0f + 2.0f * (tileX + 1) / TileCountX;
+
+				const uint32_t tileIndex = tileY * TileCountX + tileX;
+				bounds.m_minX[tileIndex] = std::min(ndcMinX * sliceNear, ndcMinX * sliceFar) * tanHalfFovX;
+				bounds.m_maxX[tileIndex] = std::max(ndcMaxX * sliceNear, ndcMaxX * sliceFar) * tanHalfFovX;
+				bounds.m_minY[tileIndex] = std::min(ndcMinY * sliceNear, ndcMinY * sliceFar) * tanHalfFovY;
+				bounds.m_maxY[tileIndex] = std::max(ndcMaxY * sliceNear, ndcMaxY * sliceFar) * tanHalfFovY;
+			}
+		}
+	}
+}
+
+void LightClusterBuilder::Build(const glm::mat4 &view, const LightUniforms *pLights, uint32_t lightCount, ThreadPool *pThreadPool) {
+	m_clusters.assign(ClusterCount * 2, 0);
+	m_lightIndices.clear();
+	if(m_sliceBounds.empty()) {
+		return;
+	}
+
+	constexpr int32_t directionalType = static_cast<int32_t>(cd::LightType::Directional);
+	m_viewSpheres.resize(lightCount);
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex) {
+		const LightUniforms &light = pLights[lightIndex];
+		if(directionalType == light.m_type) {
+			m_viewSpheres[lightIndex] = glm::vec4(0.0f, 0.0f, 0.0f, UnboundedRadius);
+		}
+		else {
+			m_viewSpheres[lightIndex] = glm::vec4(glm::vec3(view * glm::vec4(light.m_position, 1.0f)), std::max(light.m_range, 0.0f));
+		}
+	}
+
+	// Slices write only their own clusters' lists, which keep their capacity from frame to frame.
+	m_clusterLights.resize(ClusterCount);
+	if(pThreadPool) {
+		pThreadPool->ParallelFor(SliceCount, [this](std::size_t sliceIndex) {
+			BuildSlice(static_cast<uint32_t>(sliceIndex));
+		});
+	}
+	else {
+		for(uint32_t sliceIndex = 0; sliceIndex < SliceCount; ++sliceIndex) {
+			BuildSlice(sliceIndex);
+		}
+	}
+
+	uint32_t offset = 0;
+	for(uint32_t clusterIndex = 0; clusterIndex < ClusterCount; ++clusterIndex) {
+		const std::vector<uint16_t> &clusterLights = m_clusterLights[clusterIndex];
+		const uint32_t count = std::min(static_cast<uint32_t>(clusterLights.size()), MaxLightIndexCount - offset);
+		m_clusters[clusterIndex * 2] = offset;
+		m_clusters[clusterIndex * 2 + 1] = count;
+		m_lightIndices.insert(m_lightIndices.end(), clusterLights.begin(), clusterLights.begin() + count);
+		offset += count;
+	}
+}
+
+void LightClusterBuilder::BuildSlice(uint32_t sliceIndex) {
+	const SliceBounds &bounds = m_sliceBounds[sliceIndex];
+	std::vector<uint16_t> *pTileLights = &m_clusterLights[sliceIndex * TileCount];
+	for(uint32_t tileIndex = 0; tileIndex < TileCount; ++tileIndex) {
+		pTileLights[tileIndex].clear();
+	}
+
+	const uint32_t lightCount = static_cast<uint32_t>(m_viewSpheres.size());
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex) {
+		const glm::vec4 &sphere = m_viewSpheres[lightIndex];
+		if(sphere.w == UnboundedRadius) {
+			for(uint32_t tileIndex = 0; tileIndex < TileCount; ++tileIndex) {
+				pTileLights[tileIndex].push_back(static_cast<uint16_t>(lightIndex));
+			}
+			continue;
+		}
+		if(sphere.w <= 0.0f) {
+			continue;
+		}
+
+		// Squared distance from the sphere center to a box, the depth term is the same for every tile of the slice.
+		const float radiusSquared = sphere.w * sphere.w;
+		const float distanceZ = std::max(bounds.m_minZ - sphere.z, 0.0f) + std::max(sphere.z - bounds.m_maxZ, 0.0f);
+		const float distanceZSquared = distanceZ * distanceZ;
+		if(distanceZSquared > radiusSquared) {
+			continue;
+		}
+
+#if CD_ARCH_X86
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 centerX = _mm_set1_ps(sphere.x);
+		const __m128 centerY = _mm_set1_ps(sphere.y);
+		const __m128 remainingRadiusSquared = _mm_set1_ps(radiusSquared - distanceZSquared);
+		for(uint32_t tileIndex = 0; tileIndex < TileCount; tileIndex += 4) {
+			const __m128 distanceX = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(bounds.m_minX + tileIndex), centerX), zero),
+				_mm_max_ps(_mm_sub_ps(centerX, _mm_load_ps(bounds.m_maxX + tileIndex)), zero));
+			const __m128 distanceY = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(bounds.m_minY + tileIndex), centerY), zero),
+				_mm_max_ps(_mm_sub_ps(centerY, _mm_load_ps(bounds.m_maxY + tileIndex)), zero));
+			const __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(distanceX, distanceX), _mm_mul_ps(distanceY, distanceY));
+			const int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, remainingRadiusSquared));
+			for(uint32_t lane = 0; lane < 4; ++lane) {
+				if(mask & (1 << lane)) {
+					pTileLights[tileIndex + lane].push_back(static_cast<uint16_t>(lightIndex));
+				}
+			}
+		}
+#else
+		for(uint32_t tileIndex = 0; tileIndex < TileCount; ++tileIndex) {
+			const float distanceX = std::max(bounds.m_minX[tileIndex] - sphere.x, 0.0f) + std::max(sphere.x - bounds.m_maxX[tileIndex], 0.0f);
+			const float distanceY = std::max(bounds.m_minY[tileIndex] - sphere.y, 0.0f) + std::max(sphere.y - bounds.m_maxY[tileIndex], 0.0f);
+			if(distanceX * distanceX + distanceY * distanceY + distanceZSquared <= radiusSquared) {
+				pTileLights[tileIndex].push_back(static_cast<uint16_t>(lightIndex));
+			}
+		}
+#endif
+	}
+}
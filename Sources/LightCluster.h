@@ -0,0 +1,83 @@
+#pragma once
+
+#include "UniformBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Clustered forward light assignment.
+// The view frustum is split into TileCountX x TileCountY screen tiles and SliceCount depth slices which grow
+// exponentially with distance. Every cluster gets the indices of the lights whose range sphere touches its view space
+// bounding box, so the fragment shader only shades the lights of its own cluster.
+// Directional lights touch every cluster, lights without a range are never assigned since they shade nothing.
+class LightClusterBuilder
+{
+public:
+	static constexpr uint32_t TileCountX = 16;
+	static constexpr uint32_t TileCountY = 9;
+	static constexpr uint32_t SliceCount = 24;
+	static constexpr uint32_t TileCount = TileCountX * TileCountY;
+	static constexpr uint32_t ClusterCount = TileCount * SliceCount;
+
+	// GL 3.3 only guarantees 65536 texels in a buffer texture, lights beyond that are dropped from the last clusters.
+	static constexpr uint32_t MaxLightIndexCount = 65536;
+
+	static_assert(TileCount % 4 == 0, "Tiles are tested four at a time.");
+
+public:
+	LightClusterBuilder() = default;
+	LightClusterBuilder(const LightClusterBuilder&) = delete;
+	LightClusterBuilder& operator=(const LightClusterBuilder&) = delete;
+	LightClusterBuilder(LightClusterBuilder&&) = default;
+	LightClusterBuilder& operator=(LightClusterBuilder&&) = default;
+	~LightClusterBuilder() = default;
+
+	// Parameters of a glm::perspective projection, cluster bounds are only rebuilt when they change.
+	void SetProjection(float fovY, float aspect, float nearPlane, float farPlane);
+
+	// Assigns lights to clusters. Slices are spread over the pool's workers, without one they are built on the calling thread.
+	void Build(const glm::mat4 &view, const LightUniforms *pLights, uint32_t lightCount, ThreadPool *pThreadPool = nullptr);
+
+	// Light index list offset and count of every cluster, two uint32 per cluster.
+	// Clusters are ordered by slice, then tile row, then tile column.
+	const std::vector<uint32_t> &GetClusters() const { return m_clusters; }
+
+	// Indices into the LightBlock light array, referenced by GetClusters.
+	const std::vector<uint16_t> &GetLightIndices() const { return m_lightIndices; }
+
+	// Slice of a view space depth is log(depth) * scale + bias.
+	float GetSliceScale() const { return m_sliceScale; }
+	float GetSliceBias() const { return m_sliceBias; }
+
+private:
+	// View space bounds of the tiles of one slice, in SoA layout for four wide tests.
+	struct alignas(16) SliceBounds
+	{
+		float m_minX[TileCount];
+		float m_minY[TileCount];
+		float m_maxX[TileCount];
+		float m_maxY[TileCount];
+		float m_minZ;
+		float m_maxZ;
+	};
+
+	void BuildSlice(uint32_t sliceIndex);
+
+	float m_fovY = 0.0f;
+	float m_aspect = 0.0f;
+	float m_nearPlane = 0.0f;
+	float m_farPlane = 0.0f;
+	float m_sliceScale = 0.0f;
+	float m_sliceBias = 0.0f;
+	std::vector<SliceBounds> m_sliceBounds;
+
+	std::vector<glm::vec4> m_viewSpheres;
+	std::vector<std::vector<uint16_t>> m_clusterLights;
+	std::vector<uint32_t> m_clusters;
+	std::vector<uint16_t> m_lightIndices;
+};
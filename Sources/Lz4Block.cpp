@@ -0,0 +1,215 @@
+#include "Lz4Block.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t MinMatch = 4;
+// The format requires the last 5 bytes to be literals and the last match to start at least 12 bytes before the end.
+constexpr std::size_t LastLiterals = 5;
+constexpr std::size_t MatchFindLimit = 12;
+constexpr std::size_t MaxOffset = 65535;
+constexpr uint32_t HashBits = 14;
+
+uint32_t Read32(const unsigned char *p) {
+	uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+	return (sequence * 2654435761U) >> (32 - HashBits);
+}
+
+class BlockEncoder
+{
+public:
+	BlockEncoder(char *pDestination, std::size_t capacity) :
+		m_pOutput(reinterpret_cast<unsigned char *>(pDestination)),
+		m_pOutputEnd(reinterpret_cast<unsigned char *>(pDestination) + capacity),
+		m_pOutputBegin(reinterpret_cast<unsigned char *>(pDestination)) {
+	}
+
+	std::size_t GetSize() const { return m_failed ? 0 : static_cast<std::size_t>(m_pOutput - m_pOutputBegin); }
+
+	// Emits literals followed by an optional match, matchLength 0 means the final literal-only sequence.
+	void EmitSequence(const unsigned char *pLiterals, std::size_t literalLength, std::size_t offset, std::size_t matchLength) {
+		if(m_failed) {
+			return;
+		}
+
+		const std::size_t matchCode = matchLength > 0 ? matchLength - MinMatch : 0;
+		const std::size_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 + matchCode / 255 + 1;
+		if(worstCase > static_cast<std::size_t>(m_pOutputEnd - m_pOutput)) {
+			m_failed = true;
+			return;
+		}
+
+		unsigned char *pToken = m_pOutput++;
+		*pToken = static_cast<unsigned char>((literalLength >= 15 ? 15 : literalLength) << 4);
+		if(literalLength >= 15) {
+			WriteLength(literalLength - 15);
+		}
+		if(literalLength > 0) {
+			std::memcpy(m_pOutput, pLiterals, literalLength);
+			m_pOutput += literalLength;
+		}
+
+		if(0 == matchLength) {
+			return;
+		}
+
+		*m_pOutput++ = static_cast<unsigned char>(offset & 0xff);
+		*m_pOutput++ = static_cast<unsigned char>(offset >> 8);
+		*pToken |= static_cast<unsigned char>(matchCode >= 15 ? 15 : matchCode);
+		if(matchCode >= 15) {
+			WriteLength(matchCode - 15);
+		}
+	}
+
+private:
+	void WriteLength(std::size_t length) {
+		for(; length >= 255; length -= 255) {
+			*m_pOutput++ = 255;
+		}
+		*m_pOutput++ = static_cast<unsigned char>(length);
+	}
+
+	unsigned char *m_pOutput;
+	unsigned char *m_pOutputEnd;
+	unsigned char *m_pOutputBegin;
+	bool m_failed = false;
+};
+
+}
+
+std::size_t Lz4CompressBound(std::size_t sourceSize) {
+	return sourceSize + sourceSize / 255 + 16;
+}
+
+std::size_t Lz4Compress(const char *pSource, std::size_t sourceSize, char *pDestination, std::size_t destinationCapacity) {
+	const unsigned char *pInput = reinterpret_cast<const unsigned char *>(pSource);
+	BlockEncoder encoder(pDestination, destinationCapacity);
+
+	std::size_t anchor = 0;
+	if(sourceSize > MatchFindLimit) {
+		std::vector<int64_t> hashTable(std::size_t(1) << HashBits, -1);
+
+		const std::size_t matchStartLimit = sourceSize - MatchFindLimit;
+		const std::size_t matchEndLimit = sourceSize - LastLiterals;
+
+		std::size_t position = 0;
+		while(position < matchStartLimit) {
+			const uint32_t sequence = Read32(pInput + position);
+			const uint32_t hash = Hash(sequence);
+			const int64_t candidate = hashTable[hash];
+			hashTable[hash] = static_cast<int64_t>(position);
+
+			if(candidate < 0 || position - static_cast<std::size_t>(candidate) > MaxOffset || Read32(pInput + candidate) != sequence) {
+				++position;
+				continue;
+			}
+
+			std::size_t reference = static_cast<std::size_t>(candidate);
+			std::size_t matchLength = MinMatch;
+			while(position + matchLength < matchEndLimit && pInput[reference + matchLength] == pInput[position + matchLength]) {
+				++matchLength;
+			}
+
+			// Grow the match backwards into bytes which would otherwise be emitted as literals.
+			while(position > anchor && reference > 0 && pInput[position - 1] == pInput[reference - 1]) {
+				--position;
+				--reference;
+				++matchLength;
+			}
+
+			encoder.EmitSequence(pInput + anchor, position - anchor, position - reference, matchLength);
+			position += matchLength;
+			anchor = position;
+
+			if(position < matchStartLimit) {
+				hashTable[Hash(Read32(pInput + position - 2))] = static_cast<int64_t>(position - 2);
+			}
+		}
+	}
+
+	encoder.EmitSequence(pInput + anchor, sourceSize - anchor, 0, 0);
+	return encoder.GetSize();
+}
+
+bool Lz4Decompress(const char *pSource, std::size_t sourceSize, char *pDestination, std::size_t destinationSize) {
+	const unsigned char *pInput = reinterpret_cast<const unsigned char *>(pSource);
+	const unsigned char *pInputEnd = pInput + sourceSize;
+	unsigned char *pOutputBegin = reinterpret_cast<unsigned char *>(pDestination);
+	unsigned char *pOutput = pOutputBegin;
+	unsigned char *pOutputEnd = pOutputBegin + destinationSize;
+
+	auto readLength = [&pInput, pInputEnd](std::size_t &length) {
+		unsigned char byte;
+		do {
+			if(pInput >= pInputEnd) {
+				return false;
+			}
+			byte = *pInput++;
+			length += byte;
+		} while(255 == byte);
+		return true;
+	};
+
+	while(pInput < pInputEnd) {
+		const unsigned char token = *pInput++;
+
+		std::size_t literalLength = token >> 4;
+		if(15 == literalLength && !readLength(literalLength)) {
+			return false;
+		}
+		if(literalLength > static_cast<std::size_t>(pInputEnd - pInput) || literalLength > static_cast<std::size_t>(pOutputEnd - pOutput)) {
+			return false;
+		}
+		if(literalLength > 0) {
+			std::memcpy(pOutput, pInput, literalLength);
+			pInput += literalLength;
+			pOutput += literalLength;
+		}
+
+		// The last sequence only has literals.
+		if(pInput == pInputEnd) {
+			break;
+		}
+
+		if(pInputEnd - pInput < 2) {
+			return false;
+		}
+		const std::size_t offset = static_cast<std::size_t>(pInput[0]) | (static_cast<std::size_t>(pInput[1]) << 8);
+		pInput += 2;
+		if(0 == offset || offset > static_cast<std::size_t>(pOutput - pOutputBegin)) {
+			return false;
+		}
+
+		std::size_t matchLength = token & 15;
+		if(15 == matchLength && !readLength(matchLength)) {
+			return false;
+		}
+		matchLength += MinMatch;
+		if(matchLength > static_cast<std::size_t>(pOutputEnd - pOutput)) {
+			return false;
+		}
+
+		const unsigned char *pMatch = pOutput - offset;
+		if(offset >= matchLength) {
+			std::memcpy(pOutput, pMatch, matchLength);
+			pOutput += matchLength;
+		}
+		else {
+			// Overlapping copy repeats the last offset bytes, so it has to go byte by byte.
+			for(std::size_t i = 0; i < matchLength; ++i) {
+				*pOutput++ = pMatch[i];
+			}
+		}
+	}
+
+	return pOutput == pOutputEnd;
+}
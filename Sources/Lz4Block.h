@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Self-contained codec for the LZ4 block format, so compressed scene chunks can be decoded by any LZ4 implementation.
+// Every block is independent, there is no dictionary or state shared between calls.
+
+// Worst case compressed size of sourceSize bytes.
+std::size_t Lz4CompressBound(std::size_t sourceSize);
+
+// Returns the compressed size, or 0 if it doesn't fit into destinationCapacity.
+std::size_t Lz4Compress(const char *pSource, std::size_t sourceSize, char *pDestination, std::size_t destinationCapacity);
+
+// Decodes a whole block whose decompressed size is known up front.
+// Malformed input is rejected without reading or writing out of bounds.
+bool Lz4Decompress(const char *pSource, std::size_t sourceSize, char *pDestination, std::size_t destinationSize);
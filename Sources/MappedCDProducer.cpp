@@ -0,0 +1,51 @@
+#include "MappedCDProducer.h"
+
+#include "MappedFile.h"
+#include "MemoryStream.h"
+#include "SceneChunkFile.h"
+#include "Scene/SceneDatabase.h"
+
+void MappedCDProducer::Execute(cd::SceneDatabase* pSceneDatabase) {
+	m_failed = true;
+
+	MappedFile file(m_filePath.c_str());
+	if(!file.IsValid()) {
+		printf("Failed to map scene file : %s\n", m_filePath.c_str());
+		return;
+	}
+
+	if(SceneChunkReader::IsChunkFile(file.GetData(), file.GetSize())) {
+		SceneChunkReader reader(std::move(file));
+		if(!reader.IsValid()) {
+			printf("Invalid scene chunk file : %s\n", m_filePath.c_str());
+			return;
+		}
+		if(!reader.ReadAll(pSceneDatabase, 0, m_onQuantizedMesh)) {
+			printf("Corrupt scene chunk file : %s\n", m_filePath.c_str());
+			return;
+		}
+		m_failed = false;
+		return;
+	}
+
+	MemoryInputStream stream(file.GetData(), file.GetSize());
+
+	// .cdbin files start with the endian of the machine which wrote them.
+	uint8_t fileEndian;
+	stream.read(reinterpret_cast<char*>(&fileEndian), sizeof(fileEndian));
+
+	if(static_cast<cd::EndianType>(fileEndian) == cd::Endian::GetNative()) {
+		cd::InputArchive inputArchive(&stream);
+		*pSceneDatabase << inputArchive;
+	}
+	else {
+		cd::InputArchiveSwapBytes inputArchive(&stream);
+		*pSceneDatabase << inputArchive;
+	}
+
+	// The archive reads past the end of a truncated file.
+	m_failed = stream.fail();
+	if(m_failed) {
+		printf("Truncated scene file : %s\n", m_filePath.c_str());
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Framework/IProducer.h"
+
+#include <functional>
+#include <string>
+
+class QuantizedMesh;
+
+// Same as cdtools::CDProducer but reads the .cdbin file through a read-only memory mapping
+// instead of an ifstream, so every archive field is a memcpy from the page cache.
+// Chunked scene files written by SceneChunkWriter are detected by their header and read through SceneChunkReader.
+class MappedCDProducer final : public cdtools::IProducer
+{
+public:
+	MappedCDProducer() = delete;
+	explicit MappedCDProducer(std::string filePath) : m_filePath(std::move(filePath)) {}
+	MappedCDProducer(const MappedCDProducer&) = delete;
+	MappedCDProducer& operator=(const MappedCDProducer&) = delete;
+	MappedCDProducer(MappedCDProducer&&) = delete;
+	MappedCDProducer& operator=(MappedCDProducer&&) = delete;
+	virtual ~MappedCDProducer() = default;
+
+	virtual void Execute(cd::SceneDatabase* pSceneDatabase) override;
+
+	// Called on the reader's workers with every quantized mesh of a chunk file, see SceneChunkReader::ReadAll.
+	void SetQuantizedMeshCallback(std::function<void(const QuantizedMesh&)> onQuantizedMesh) { m_onQuantizedMesh = std::move(onQuantizedMesh); }
+
+	// IProducer can't report errors, so callers check this after the Processor ran.
+	// A failed chunk file leaves the SceneDatabase untouched, a failed .cdbin may have partially filled it.
+	bool HasFailed() const { return m_failed; }
+
+private:
+	std::string m_filePath;
+	std::function<void(const QuantizedMesh&)> m_onQuantizedMesh;
+	bool m_failed = false;
+};
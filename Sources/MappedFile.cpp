@@ -0,0 +1,129 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if(this != &other) {
+		Close();
+		m_pData = std::exchange(other.m_pData, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+		m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+		m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char *pFilePath) {
+	Close();
+
+	HANDLE file = CreateFileA(pFilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void *pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(pView == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_pData = static_cast<const char *>(pView);
+	m_size = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close() {
+	if(m_pData) {
+		UnmapViewOfFile(m_pData);
+	}
+	if(m_mappingHandle) {
+		CloseHandle(m_mappingHandle);
+	}
+	if(m_fileHandle) {
+		CloseHandle(m_fileHandle);
+	}
+	m_pData = nullptr;
+	m_size = 0;
+	m_fileHandle = nullptr;
+	m_mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char *pFilePath) {
+	Close();
+
+	int fd = open(pFilePath, O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	const std::size_t size = static_cast<std::size_t>(fileStat.st_size);
+	void *pView = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file.
+	close(fd);
+	if(pView == MAP_FAILED) {
+		return false;
+	}
+
+	// Scenes are deserialized front to back so let the kernel read ahead aggressively.
+	madvise(pView, size, MADV_SEQUENTIAL);
+
+	m_pData = static_cast<const char *>(pView);
+	m_size = size;
+	return true;
+}
+
+void MappedFile::Close() {
+	if(m_pData) {
+		munmap(const_cast<char *>(m_pData), m_size);
+	}
+	m_pData = nullptr;
+	m_size = 0;
+}
+
+#endif
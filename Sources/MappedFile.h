@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+// Pages are served from the OS page cache on demand, so nothing is copied until the bytes are touched.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const char *pFilePath) { Open(pFilePath); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile() { Close(); }
+
+	bool Open(const char *pFilePath);
+	void Close();
+
+	bool IsValid() const { return m_pData != nullptr; }
+	const char *GetData() const { return m_pData; }
+	std::size_t GetSize() const { return m_size; }
+
+private:
+	const char *m_pData = nullptr;
+	std::size_t m_size = 0;
+
+#ifdef _WIN32
+	void *m_fileHandle = nullptr;
+	void *m_mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstring>
+#include <istream>
+#include <streambuf>
+
+// Read-only streambuf over an existing byte range, for example a MappedFile.
+// cd::InputArchive only knows std::istream so this lets archives read from memory
+// with a plain memcpy per field instead of going through a file stream.
+class MemoryStreamBuf final : public std::streambuf
+{
+public:
+	MemoryStreamBuf(const char *pData, std::size_t size) {
+		char *pBegin = const_cast<char *>(pData);
+		setg(pBegin, pBegin, pBegin + size);
+	}
+	MemoryStreamBuf(const MemoryStreamBuf&) = delete;
+	MemoryStreamBuf& operator=(const MemoryStreamBuf&) = delete;
+
+	const char *GetBegin() const { return eback(); }
+	const char *GetCursor() const { return gptr(); }
+	std::size_t GetSize() const { return static_cast<std::size_t>(egptr() - eback()); }
+	std::size_t GetRemaining() const { return static_cast<std::size_t>(egptr() - gptr()); }
+
+	// gbump only takes an int so large skips go through setg.
+	void Advance(std::size_t bytes) { setg(eback(), gptr() + bytes, egptr()); }
+
+protected:
+	std::streamsize xsgetn(char *pDest, std::streamsize count) override {
+		const std::streamsize available = static_cast<std::streamsize>(GetRemaining());
+		const std::streamsize readCount = count < available ? count : available;
+		std::memcpy(pDest, gptr(), static_cast<std::size_t>(readCount));
+		Advance(static_cast<std::size_t>(readCount));
+		return readCount;
+	}
+
+	int_type underflow() override {
+		return gptr() < egptr() ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+	}
+
+	std::streamsize showmanyc() override {
+		const std::streamsize available = static_cast<std::streamsize>(GetRemaining());
+		return available > 0 ? available : -1;
+	}
+
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+		if(!(which & std::ios_base::in)) {
+			return pos_type(off_type(-1));
+		}
+
+		off_type base = 0;
+		if(direction == std::ios_base::cur) {
+			base = static_cast<off_type>(gptr() - eback());
+		}
+		else if(direction == std::ios_base::end) {
+			base = static_cast<off_type>(GetSize());
+		}
+		return seekpos(pos_type(base + offset), which);
+	}
+
+	pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+		const off_type offset = static_cast<off_type>(position);
+		if(!(which & std::ios_base::in) || offset < 0 || offset > static_cast<off_type>(GetSize())) {
+			return pos_type(off_type(-1));
+		}
+
+		setg(eback(), eback() + offset, egptr());
+		return position;
+	}
+};
+
+class MemoryInputStream final : public std::istream
+{
+public:
+	MemoryInputStream(const char *pData, std::size_t size) : std::istream(nullptr), m_buffer(pData, size) {
+		rdbuf(&m_buffer);
+	}
+	MemoryInputStream(const MemoryInputStream&) = delete;
+	MemoryInputStream& operator=(const MemoryInputStream&) = delete;
+
+	MemoryStreamBuf& GetBuffer() { return m_buffer; }
+	const MemoryStreamBuf& GetBuffer() const { return m_buffer; }
+
+private:
+	MemoryStreamBuf m_buffer;
+};
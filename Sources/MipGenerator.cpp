@@ -0,0 +1,313 @@
+#include "MipGenerator.h"
+
+#include "CpuFeatures.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+constexpr float Pi = 3.14159265358979f;
+constexpr float KaiserAlpha = 4.0f;
+constexpr float KaiserWidth = 3.0f;
+
+// Entries of the linear to sRGB table, fine enough that the 8 bit result is rounded correctly also near black.
+constexpr uint32_t LinearToSRGBTableSize = 65536;
+
+// RGBA float pixels, four floats apart so that one pixel fills one SSE register.
+struct FloatImage
+{
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	std::vector<float> m_pixels;
+
+	void Resize(uint32_t width, uint32_t height) {
+		m_width = width;
+		m_height = height;
+		m_pixels.resize(static_cast<std::size_t>(width) * height * 4);
+	}
+
+	float *GetRow(uint32_t y) { return m_pixels.data() + static_cast<std::size_t>(y) * m_width * 4; }
+	const float *GetRow(uint32_t y) const { return m_pixels.data() + static_cast<std::size_t>(y) * m_width * 4; }
+};
+
+// Source pixels which one destination pixel along an axis is filtered from, wrapping around the edges.
+struct FilterTaps
+{
+	int32_t m_firstSource;
+	uint32_t m_count;
+	uint32_t m_firstWeight;
+};
+
+struct Filter
+{
+	std::vector<FilterTaps> m_taps;
+	std::vector<float> m_weights;
+};
+
+float SRGBToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+const float *GetSRGBToLinearTable() {
+	static const std::vector<float> s_table = []() {
+		std::vector<float> table(256);
+		for(uint32_t value = 0; value < 256; ++value) {
+			table[value] = SRGBToLinear(value / 255.0f);
+		}
+		return table;
+	}();
+	return s_table.data();
+}
+
+const uint8_t *GetLinearToSRGBTable() {
+	static const std::vector<uint8_t> s_table = []() {
+		std::vector<uint8_t> table(LinearToSRGBTableSize);
+		for(uint32_t index = 0; index < LinearToSRGBTableSize; ++index) {
+			table[index] = static_cast<uint8_t>(std::lround(LinearToSRGB(index / static_cast<float>(LinearToSRGBTableSize - 1)) * 255.0f));
+		}
+		return table;
+	}();
+	return s_table.data();
+}
+
+// Zeroth order modified Bessel function of the first kind, which shapes the Kaiser window.
+float BesselI0(float x) {
+	float sum = 1.0f;
+	float term = 1.0f;
+	const float halfX = x * 0.5f;
+	for(uint32_t k = 1; k < 32; ++k) {
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if(term < sum * 1e-8f) {
+			break;
+		}
+	}
+	return sum;
+}
+
+float KaiserSinc(float t) {
+	if(std::abs(t) >= KaiserWidth) {
+		return 0.0f;
+	}
+
+	const float sinc = std::abs(t) < 1e-6f ? 1.0f : std::sin(Pi * t) / (Pi * t);
+	const float windowPosition = t / KaiserWidth;
+	return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0f - windowPosition * windowPosition)) / BesselI0(KaiserAlpha);
+}
+
+// Weights are normalized per destination pixel, so flat areas stay flat whatever the size ratio.
+Filter BuildFilter(uint32_t sourceSize, uint32_t destinationSize, MipFilter mipFilter) {
+	Filter filter;
+	filter.m_taps.resize(destinationSize);
+	const float scale = static_cast<float>(sourceSize) / destinationSize;
+	for(uint32_t destination = 0; destination < destinationSize; ++destination) {
+		FilterTaps &taps = filter.m_taps[destination];
+		taps.m_firstWeight = static_cast<uint32_t>(filter.m_weights.size());
+
+		// Destination pixel extent in source pixels.
+		const float begin = destination * scale;
+		const float end = begin + scale;
+		const float center = begin + scale * 0.5f;
+		const float radius = MipFilter::Box == mipFilter ? scale * 0.5f : KaiserWidth * scale;
+		taps.m_firstSource = static_cast<int32_t>(std::floor(center - radius));
+		const int32_t lastSource = static_cast<int32_t>(std::ceil(center + radius)) - 1;
+
+		float weightSum = 0.0f;
+		for(int32_t source = taps.m_firstSource; source <= lastSource; ++source) {
+			float weight;
+			if(MipFilter::Box == mipFilter) {
+				// Overlap of the source pixel with the destination pixel.
+				weight = std::max(0.0f, std::min(end, source + 1.0f) - std::max(begin, static_cast<float>(source)));
+			}
+			else {
+				weight = KaiserSinc((source + 0.5f - center) / scale);
+			}
+			filter.m_weights.push_back(weight);
+			weightSum += weight;
+		}
+
+		taps.m_count = static_cast<uint32_t>(filter.m_weights.size()) - taps.m_firstWeight;
+		for(uint32_t tap = 0; tap < taps.m_count; ++tap) {
+			filter.m_weights[taps.m_firstWeight + tap] /= weightSum;
+		}
+	}
+	return filter;
+}
+
+uint32_t WrapIndex(int32_t index, uint32_t size) {
+	const int32_t wrapped = index % static_cast<int32_t>(size);
+	return static_cast<uint32_t>(wrapped < 0 ? wrapped + static_cast<int32_t>(size) : wrapped);
+}
+
+void DecodeBase(const uint8_t *pPixels, MipContent content, FloatImage &image, std::size_t threadCount) {
+	const float *pSRGBToLinear = GetSRGBToLinearTable();
+	ParallelFor(image.m_height, [&](std::size_t y) {
+		const uint8_t *pSource = pPixels + y * image.m_width * 4;
+		float *pDestination = image.GetRow(static_cast<uint32_t>(y));
+		for(uint32_t value = 0; value < image.m_width * 4; ++value) {
+			const bool isAlpha = 3 == value % 4;
+			if(MipContent::Color == content && !isAlpha) {
+				pDestination[value] = pSRGBToLinear[pSource[value]];
+			}
+			else if(MipContent::Normal == content && !isAlpha) {
+				pDestination[value] = pSource[value] * (2.0f / 255.0f) - 1.0f;
+			}
+			else {
+				pDestination[value] = pSource[value] * (1.0f / 255.0f);
+			}
+		}
+	}, threadCount);
+}
+
+// Horizontal pass, every destination pixel is a weighted sum of whole RGBA source pixels.
+void FilterRows(const FloatImage &source, const Filter &filter, FloatImage &destination, std::size_t threadCount) {
+	ParallelFor(source.m_height, [&](std::size_t y) {
+		const float *pSourceRow = source.GetRow(static_cast<uint32_t>(y));
+		float *pDestinationRow = destination.GetRow(static_cast<uint32_t>(y));
+		for(uint32_t x = 0; x < destination.m_width; ++x) {
+			const FilterTaps &taps = filter.m_taps[x];
+			const float *pWeights = filter.m_weights.data() + taps.m_firstWeight;
+#if CD_ARCH_X86
+			__m128 sum = _mm_setzero_ps();
+			for(uint32_t tap = 0; tap < taps.m_count; ++tap) {
+				const __m128 pixel = _mm_loadu_ps(pSourceRow + WrapIndex(taps.m_firstSource + static_cast<int32_t>(tap), source.m_width) * 4);
+				sum = _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(pWeights[tap])));
+			}
+			_mm_storeu_ps(pDestinationRow + x * 4, sum);
+#else
+			float sum[4] = {};
+			for(uint32_t tap = 0; tap < taps.m_count; ++tap) {
+				const float *pPixel = pSourceRow + WrapIndex(taps.m_firstSource + static_cast<int32_t>(tap), source.m_width) * 4;
+				for(uint32_t channel = 0; channel < 4; ++channel) {
+					sum[channel] += pPixel[channel] * pWeights[tap];
+				}
+			}
+			std::copy(sum, sum + 4, pDestinationRow + x * 4);
+#endif
+		}
+	}, threadCount);
+}
+
+// Vertical pass, whole source rows are scaled and added to the destination row, which keeps the reads sequential.
+// Normals are renormalized here, so the next level is filtered from unit vectors too.
+void FilterColumns(const FloatImage &source, const Filter &filter, MipContent content, FloatImage &destination, std::size_t threadCount) {
+	ParallelFor(destination.m_height, [&](std::size_t y) {
+		const FilterTaps &taps = filter.m_taps[y];
+		const float *pWeights = filter.m_weights.data() + taps.m_firstWeight;
+		float *pDestinationRow = destination.GetRow(static_cast<uint32_t>(y));
+		const uint32_t valueCount = destination.m_width * 4;
+		std::fill(pDestinationRow, pDestinationRow + valueCount, 0.0f);
+		for(uint32_t tap = 0; tap < taps.m_count; ++tap) {
+			const float *pSourceRow = source.GetRow(WrapIndex(taps.m_firstSource + static_cast<int32_t>(tap), source.m_height));
+#if CD_ARCH_X86
+			const __m128 weight = _mm_set1_ps(pWeights[tap]);
+			for(uint32_t value = 0; value < valueCount; value += 4) {
+				const __m128 sum = _mm_add_ps(_mm_loadu_ps(pDestinationRow + value), _mm_mul_ps(_mm_loadu_ps(pSourceRow + value), weight));
+				_mm_storeu_ps(pDestinationRow + value, sum);
+			}
+#else
+			for(uint32_t value = 0; value < valueCount; ++value) {
+				pDestinationRow[value] += pSourceRow[value] * pWeights[tap];
+			}
+#endif
+		}
+
+		if(MipContent::Normal == content) {
+			for(uint32_t x = 0; x < destination.m_width; ++x) {
+				float *pNormal = pDestinationRow + x * 4;
+				const float length = std::sqrt(pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2]);
+				if(length > 1e-6f) {
+					pNormal[0] /= length;
+					pNormal[1] /= length;
+					pNormal[2] /= length;
+				}
+				else {
+					pNormal[0] = 0.0f;
+					pNormal[1] = 0.0f;
+					pNormal[2] = 1.0f;
+				}
+			}
+		}
+	}, threadCount);
+}
+
+// Sinc lobes overshoot, so every value is clamped to its range before it is encoded again.
+void EncodeLevel(const FloatImage &image, MipContent content, MipLevel &level, std::size_t threadCount) {
+	const uint8_t *pLinearToSRGB = GetLinearToSRGBTable();
+	level.m_width = image.m_width;
+	level.m_height = image.m_height;
+	level.m_pixels.resize(static_cast<std::size_t>(image.m_width) * image.m_height * 4);
+	ParallelFor(image.m_height, [&](std::size_t y) {
+		const float *pSource = image.GetRow(static_cast<uint32_t>(y));
+		uint8_t *pDestination = level.m_pixels.data() + y * image.m_width * 4;
+		for(uint32_t value = 0; value < image.m_width * 4; ++value) {
+			const bool isAlpha = 3 == value % 4;
+			float unorm = pSource[value];
+			if(MipContent::Normal == content && !isAlpha) {
+				unorm = unorm * 0.5f + 0.5f;
+			}
+			unorm = std::min(std::max(unorm, 0.0f), 1.0f);
+
+			if(MipContent::Color == content && !isAlpha) {
+				pDestination[value] = pLinearToSRGB[static_cast<uint32_t>(unorm * (LinearToSRGBTableSize - 1) + 0.5f)];
+			}
+			else {
+				pDestination[value] = static_cast<uint8_t>(unorm * 255.0f + 0.5f);
+			}
+		}
+	}, threadCount);
+}
+
+}
+
+MipContent GetMipContent(cd::MaterialTextureType textureType) {
+	switch(textureType) {
+	case cd::MaterialTextureType::Normal:
+		return MipContent::Normal;
+	case cd::MaterialTextureType::BaseColor:
+	case cd::MaterialTextureType::Emissive:
+		return MipContent::Color;
+	default:
+		return MipContent::Data;
+	}
+}
+
+std::vector<MipLevel> GenerateMips(const uint8_t *pPixels, uint32_t width, uint32_t height, MipContent content, MipFilter filter,
+	std::size_t threadCount) {
+	std::vector<MipLevel> levels;
+	if(0 == width || 0 == height) {
+		return levels;
+	}
+
+	FloatImage level;
+	level.Resize(width, height);
+	DecodeBase(pPixels, content, level, threadCount);
+
+	FloatImage rows;
+	FloatImage nextLevel;
+	while(level.m_width > 1 || level.m_height > 1) {
+		const uint32_t levelWidth = std::max(level.m_width / 2, 1u);
+		const uint32_t levelHeight = std::max(level.m_height / 2, 1u);
+
+		rows.Resize(levelWidth, level.m_height);
+		FilterRows(level, BuildFilter(level.m_width, levelWidth, filter), rows, threadCount);
+		nextLevel.Resize(levelWidth, levelHeight);
+		FilterColumns(rows, BuildFilter(level.m_height, levelHeight, filter), content, nextLevel, threadCount);
+
+		levels.emplace_back();
+		EncodeLevel(nextLevel, content, levels.back(), threadCount);
+		std::swap(level, nextLevel);
+	}
+	return levels;
+}
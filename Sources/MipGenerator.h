@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Base/Platform.h"
+#include "Scene/MaterialTextureType.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How the channels of a texture are filtered.
+enum class MipContent
+{
+	// sRGB encoded color with linear alpha, filtered in linear space so that mips don't darken.
+	Color,
+	// Tangent space normal in RGB, renormalized after filtering. Alpha is filtered on its own.
+	Normal,
+	// Independent linear channels such as occlusion, roughness and metallic.
+	Data,
+};
+
+enum class MipFilter
+{
+	// 2x2 average, cheapest but blurs and aliases more.
+	Box,
+	// Kaiser windowed sinc over 3 destination pixels on each side, sharper mips with less aliasing.
+	Kaiser,
+};
+
+struct MipLevel
+{
+	uint32_t m_width;
+	uint32_t m_height;
+	// Tightly packed RGBA8 rows.
+	std::vector<uint8_t> m_pixels;
+};
+
+// Content of the texture type, normal maps are Normal, base color and emissive are Color and the rest is Data.
+MipContent GetMipContent(cd::MaterialTextureType textureType);
+
+// Builds every level below the RGBA8 base image down to 1x1, each half the size of the previous one rounded down.
+// Levels are filtered from the previous one in float, so rounding doesn't accumulate, and addressing wraps around
+// the edges as the textures repeat. Rows of a level are spread over threadCount threads, 0 means GetDefaultThreadCount().
+std::vector<MipLevel> GenerateMips(const uint8_t *pPixels, uint32_t width, uint32_t height, MipContent content,
+	MipFilter filter = MipFilter::Kaiser, std::size_t threadCount = 0);
@@ -0,0 +1,142 @@
+#include "NodeTransformCache.h"
+
+#include "Scene/SceneDatabase.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+
+// Translation * rotation * scale. Transform::GetMatrix only scales the diagonal, which is wrong for rotated nodes.
+glm::mat4 GetLocalMatrix(const cd::Transform &transform) {
+	const cd::Vec3f &translation = transform.GetTranslation();
+	const cd::Quaternion &rotation = transform.GetRotation();
+	const cd::Vec3f &scale = transform.GetScale();
+
+	glm::mat4 matrix = glm::mat4_cast(glm::quat(rotation.w(), rotation.x(), rotation.y(), rotation.z()));
+	matrix[0] *= scale.x();
+	matrix[1] *= scale.y();
+	matrix[2] *= scale.z();
+	matrix[3] = glm::vec4(translation.x(), translation.y(), translation.z(), 1.0f);
+	return matrix;
+}
+
+}
+
+void NodeTransformCache::Build(const cd::SceneDatabase &sceneDatabase) {
+	const std::vector<cd::Node> &nodes = sceneDatabase.GetNodes();
+	const uint32_t nodeCount = static_cast<uint32_t>(nodes.size());
+
+	std::unordered_map<uint32_t, uint32_t> nodeIndexByID;
+	nodeIndexByID.reserve(nodeCount);
+	for(uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+		nodeIndexByID.emplace(nodes[nodeIndex].GetID().Data(), nodeIndex);
+	}
+	auto findNodeIndex = [&nodeIndexByID](const cd::NodeID &nodeID) {
+		const auto it = nodeIndexByID.find(nodeID.Data());
+		return nodeID.IsValid() && it != nodeIndexByID.end() ? it->second : InvalidIndex;
+	};
+
+	m_nodeSlots.assign(nodeCount, InvalidIndex);
+	m_order.clear();
+	m_order.reserve(nodeCount);
+	m_parentSlots.clear();
+	m_parentSlots.reserve(nodeCount);
+
+	// Depth first from every root. Children are pushed in reverse so that siblings keep their order.
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+	auto visit = [&](uint32_t rootIndex) {
+		stack.emplace_back(rootIndex, InvalidIndex);
+		while(!stack.empty()) {
+			const auto [nodeIndex, parentSlot] = stack.back();
+			stack.pop_back();
+			if(m_nodeSlots[nodeIndex] != InvalidIndex) {
+				continue;
+			}
+
+			const uint32_t slot = static_cast<uint32_t>(m_order.size());
+			m_nodeSlots[nodeIndex] = slot;
+			m_order.push_back(nodeIndex);
+			m_parentSlots.push_back(parentSlot);
+
+			const std::vector<cd::NodeID> &childIDs = nodes[nodeIndex].GetChildIDs();
+			for(auto it = childIDs.rbegin(); it != childIDs.rend(); ++it) {
+				const uint32_t childIndex = findNodeIndex(*it);
+				if(childIndex != InvalidIndex && m_nodeSlots[childIndex] == InvalidIndex) {
+					stack.emplace_back(childIndex, slot);
+				}
+			}
+		}
+	};
+
+	for(uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+		const uint32_t parentIndex = findNodeIndex(nodes[nodeIndex].GetParentID());
+		if(InvalidIndex == parentIndex || nodeIndex == parentIndex) {
+			visit(nodeIndex);
+		}
+	}
+	for(uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+		if(InvalidIndex == m_nodeSlots[nodeIndex]) {
+			visit(nodeIndex);
+		}
+	}
+
+	// A subtree ends where the last subtree of its children ends.
+	m_subtreeEnds.resize(nodeCount);
+	for(uint32_t slot = 0; slot < nodeCount; ++slot) {
+		m_subtreeEnds[slot] = slot + 1;
+	}
+	for(uint32_t slot = nodeCount; slot-- > 0;) {
+		const uint32_t parentSlot = m_parentSlots[slot];
+		if(parentSlot != InvalidIndex) {
+			m_subtreeEnds[parentSlot] = std::max(m_subtreeEnds[parentSlot], m_subtreeEnds[slot]);
+		}
+	}
+
+	m_dirty.assign(nodeCount, 1);
+	m_worldMatrices.resize(nodeCount);
+}
+
+void NodeTransformCache::MarkDirty(uint32_t nodeIndex) {
+	if(nodeIndex < m_nodeSlots.size()) {
+		m_dirty[m_nodeSlots[nodeIndex]] = 1;
+	}
+}
+
+void NodeTransformCache::SetRootMatrix(const glm::mat4 &rootMatrix) {
+	if(rootMatrix == m_rootMatrix) {
+		return;
+	}
+
+	m_rootMatrix = rootMatrix;
+	std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(1));
+}
+
+uint32_t NodeTransformCache::Update(const cd::SceneDatabase &sceneDatabase) {
+	const std::vector<cd::Node> &nodes = sceneDatabase.GetNodes();
+	const uint32_t nodeCount = GetNodeCount();
+
+	// Parents come first, so a dirty node's parent is already up to date and its subtree is the range up to dirtyEnd.
+	uint32_t recomputedCount = 0;
+	uint32_t dirtyEnd = 0;
+	for(uint32_t slot = 0; slot < nodeCount; ++slot) {
+		if(m_dirty[slot]) {
+			m_dirty[slot] = 0;
+			dirtyEnd = std::max(dirtyEnd, m_subtreeEnds[slot]);
+		}
+		if(slot >= dirtyEnd) {
+			continue;
+		}
+
+		const uint32_t parentSlot = m_parentSlots[slot];
+		const glm::mat4 &parentMatrix = InvalidIndex == parentSlot ? m_rootMatrix : m_worldMatrices[parentSlot];
+		m_worldMatrices[slot] = parentMatrix * GetLocalMatrix(nodes[m_order[slot]].GetTransform());
+		++recomputedCount;
+	}
+
+	return recomputedCount;
+}
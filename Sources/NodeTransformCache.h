@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace cd
+{
+
+class SceneDatabase;
+
+}
+
+// World matrices of every cd::Node, cached in a flat array ordered depth first so that each subtree is one contiguous range.
+// Update walks the array once and only recomputes nodes which were marked dirty and their descendants.
+class NodeTransformCache
+{
+public:
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+public:
+	NodeTransformCache() = default;
+	NodeTransformCache(const NodeTransformCache&) = delete;
+	NodeTransformCache& operator=(const NodeTransformCache&) = delete;
+	NodeTransformCache(NodeTransformCache&&) = default;
+	NodeTransformCache& operator=(NodeTransformCache&&) = default;
+	~NodeTransformCache() = default;
+
+	// Orders the hierarchy from the nodes' parent and child IDs and marks every node dirty.
+	// Nodes whose parent is invalid, or which are unreachable from a root because of broken links, become roots.
+	void Build(const cd::SceneDatabase &sceneDatabase);
+
+	// Call after changing the local transform of a node, its whole subtree is recomputed on the next Update.
+	void MarkDirty(uint32_t nodeIndex);
+
+	// Parent of every root, such as a unit conversion. Changing it dirties every node.
+	void SetRootMatrix(const glm::mat4 &rootMatrix);
+	const glm::mat4 &GetRootMatrix() const { return m_rootMatrix; }
+
+	// Returns the number of recomputed world matrices.
+	uint32_t Update(const cd::SceneDatabase &sceneDatabase);
+
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_order.size()); }
+
+	// Node indices with parents before their children.
+	const std::vector<uint32_t> &GetOrder() const { return m_order; }
+
+	const glm::mat4 &GetWorldMatrix(uint32_t nodeIndex) const { return m_worldMatrices[m_nodeSlots[nodeIndex]]; }
+
+private:
+	// Per node index.
+	std::vector<uint32_t> m_nodeSlots;
+
+	// Per slot in depth first order.
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_parentSlots;
+	std::vector<uint32_t> m_subtreeEnds;
+	std::vector<uint8_t> m_dirty;
+	std::vector<glm::mat4> m_worldMatrices;
+
+	glm::mat4 m_rootMatrix = glm::mat4(1.0f);
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the caller doesn't ask for a specific count.
+inline std::size_t GetDefaultThreadCount() {
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 0 ? static_cast<std::size_t>(hardwareThreads) : 1;
+}
+
+// Calls func(index) for every index in [0, count), spread over threadCount threads including the calling one.
+// Indices are handed out one at a time, so uneven work such as meshes of very different sizes still balances.
+// threadCount 0 means GetDefaultThreadCount(). Returns after every call has finished.
+template<typename Func>
+void ParallelFor(std::size_t count, Func &&func, std::size_t threadCount = 0) {
+	if(0 == threadCount) {
+		threadCount = GetDefaultThreadCount();
+	}
+	threadCount = std::min(threadCount, count);
+
+	if(threadCount <= 1) {
+		for(std::size_t index = 0; index < count; ++index) {
+			func(index);
+		}
+		return;
+	}
+
+	std::atomic<std::size_t> nextIndex = 0;
+	auto worker = [&]() {
+		for(std::size_t index = nextIndex++; index < count; index = nextIndex++) {
+			func(index);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for(std::size_t threadIndex = 1; threadIndex < threadCount; ++threadIndex) {
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for(std::thread &thread : threads) {
+		thread.join();
+	}
+}
@@ -0,0 +1,252 @@
+#include "QuantizedMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+constexpr float Unorm16Max = 65535.0f;
+constexpr float Snorm16Max = 32767.0f;
+
+uint16_t QuantizeUnorm16(float value, float minValue, float extent) {
+	if(extent <= 0.0f) {
+		return 0;
+	}
+	const float normalized = std::clamp((value - minValue) / extent, 0.0f, 1.0f);
+	return static_cast<uint16_t>(normalized * Unorm16Max + 0.5f);
+}
+
+float DequantizeUnorm16(uint16_t value, float minValue, float extent) {
+	return minValue + extent * (static_cast<float>(value) / Unorm16Max);
+}
+
+int16_t QuantizeSnorm16(float value) {
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * Snorm16Max));
+}
+
+float SignNotZero(float value) {
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+std::vector<OctahedralSnorm16> EncodeDirections(const std::vector<cd::Direction> &directions) {
+	std::vector<OctahedralSnorm16> encoded(directions.size());
+	std::transform(directions.begin(), directions.end(), encoded.begin(), EncodeOctahedral);
+	return encoded;
+}
+
+// Bounds of count vectors of N floats, with a zero extent for empty input.
+template<typename Vector>
+void ComputeBounds(const std::vector<Vector> &vectors, Vector &minValue, Vector &extent) {
+	if(vectors.empty()) {
+		minValue = Vector(0.0f);
+		extent = Vector(0.0f);
+		return;
+	}
+
+	Vector maxValue = vectors[0];
+	minValue = vectors[0];
+	for(const Vector &vector : vectors) {
+		for(std::size_t component = 0; component < Vector::Size; ++component) {
+			minValue[component] = std::min(minValue[component], vector[component]);
+			maxValue[component] = std::max(maxValue[component], vector[component]);
+		}
+	}
+	extent = maxValue - minValue;
+}
+
+template<typename Vector>
+std::vector<uint16_t> QuantizeVectors(const std::vector<Vector> &vectors, const Vector &minValue, const Vector &extent) {
+	std::vector<uint16_t> quantized;
+	quantized.reserve(vectors.size() * Vector::Size);
+	for(const Vector &vector : vectors) {
+		for(std::size_t component = 0; component < Vector::Size; ++component) {
+			quantized.push_back(QuantizeUnorm16(vector[component], minValue[component], extent[component]));
+		}
+	}
+	return quantized;
+}
+
+}
+
+OctahedralSnorm16 EncodeOctahedral(const cd::Direction &direction) {
+	const float length = std::abs(direction.x()) + std::abs(direction.y()) + std::abs(direction.z());
+	if(length <= std::numeric_limits<float>::min()) {
+		return { 0, 0 };
+	}
+
+	// Project onto the octahedron, then fold the lower hemisphere over the diagonals.
+	float x = direction.x() / length;
+	float y = direction.y() / length;
+	if(direction.z() < 0.0f) {
+		const float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		const float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+	return { QuantizeSnorm16(x), QuantizeSnorm16(y) };
+}
+
+cd::Direction DecodeOctahedral(OctahedralSnorm16 encoded) {
+	float x = static_cast<float>(encoded.m_x) / Snorm16Max;
+	float y = static_cast<float>(encoded.m_y) / Snorm16Max;
+	const float z = 1.0f - std::abs(x) - std::abs(y);
+	if(z < 0.0f) {
+		const float unfoldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		const float unfoldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	const float length = std::sqrt(x * x + y * y + z * z);
+	return cd::Direction(x / length, y / length, z / length);
+}
+
+bool IsQuantizable(const cd::Mesh &mesh) {
+	const std::size_t vertexCount = mesh.GetVertexCount();
+	auto isOptionalStream = [vertexCount](const std::vector<cd::Direction> &directions) {
+		return directions.empty() || directions.size() == vertexCount;
+	};
+
+	if(!mesh.GetMorphs().empty() || mesh.GetVertexInfluenceCount() > 0 || mesh.GetVertexColorSetCount() > 0) {
+		return false;
+	}
+	if(mesh.GetVertexPositions().size() != vertexCount || !isOptionalStream(mesh.GetVertexNormals()) ||
+		!isOptionalStream(mesh.GetVertexTangents()) || !isOptionalStream(mesh.GetVertexBiTangents())) {
+		return false;
+	}
+	for(uint32_t uvSetIndex = 0; uvSetIndex < mesh.GetVertexUVSetCount(); ++uvSetIndex) {
+		if(mesh.GetVertexUV(uvSetIndex).size() != vertexCount) {
+			return false;
+		}
+	}
+
+	const auto &adjacentVertices = mesh.GetVertexAdjacentVertexArrays();
+	const auto &adjacentPolygons = mesh.GetVertexAdjacentPolygonArrays();
+	const auto isEmpty = [](const auto &ids) { return ids.empty(); };
+	return std::all_of(adjacentVertices.begin(), adjacentVertices.end(), isEmpty) &&
+		std::all_of(adjacentPolygons.begin(), adjacentPolygons.end(), isEmpty);
+}
+
+void WriteQuantizedMesh(const cd::Mesh &mesh, cd::OutputArchive &outputArchive) {
+	const std::vector<cd::Point> &positions = mesh.GetVertexPositions();
+	cd::Point positionMin;
+	cd::Point positionExtent;
+	ComputeBounds(positions, positionMin, positionExtent);
+
+	outputArchive << mesh.GetID().Data() << std::string(mesh.GetName()) << mesh.GetMaterialID().Data() << mesh.GetAABB();
+	mesh.GetVertexFormat() >> outputArchive;
+	outputArchive << mesh.GetVertexCount() << mesh.GetPolygonCount() << positionMin << positionExtent << mesh.GetVertexUVSetCount();
+
+	const std::vector<uint16_t> quantizedPositions = QuantizeVectors(positions, positionMin, positionExtent);
+	ExportTypedBuffer(outputArchive, quantizedPositions.data(), quantizedPositions.size());
+	for(const std::vector<cd::Direction> *pDirections : { &mesh.GetVertexNormals(), &mesh.GetVertexTangents(), &mesh.GetVertexBiTangents() }) {
+		const std::vector<OctahedralSnorm16> encoded = EncodeDirections(*pDirections);
+		ExportTypedBuffer(outputArchive, encoded.data(), encoded.size());
+	}
+
+	for(uint32_t uvSetIndex = 0; uvSetIndex < mesh.GetVertexUVSetCount(); ++uvSetIndex) {
+		const std::vector<cd::UV> &uvs = mesh.GetVertexUV(uvSetIndex);
+		cd::UV uvMin;
+		cd::UV uvExtent;
+		ComputeBounds(uvs, uvMin, uvExtent);
+		outputArchive << uvMin << uvExtent;
+
+		const std::vector<uint16_t> quantizedUVs = QuantizeVectors(uvs, uvMin, uvExtent);
+		ExportTypedBuffer(outputArchive, quantizedUVs.data(), quantizedUVs.size());
+	}
+
+	const std::vector<cd::Polygon> &polygons = mesh.GetPolygons();
+	if(mesh.GetVertexCount() <= std::numeric_limits<uint16_t>::max() + 1U) {
+		std::vector<uint16_t> indices;
+		indices.reserve(polygons.size() * 3);
+		for(const cd::Polygon &polygon : polygons) {
+			for(std::size_t corner = 0; corner < cd::Polygon::Size; ++corner) {
+				indices.push_back(static_cast<uint16_t>(polygon[corner].Data()));
+			}
+		}
+		outputArchive << static_cast<uint8_t>(sizeof(uint16_t));
+		ExportTypedBuffer(outputArchive, indices.data(), indices.size());
+	}
+	else {
+		std::vector<uint32_t> indices;
+		indices.reserve(polygons.size() * 3);
+		for(const cd::Polygon &polygon : polygons) {
+			for(std::size_t corner = 0; corner < cd::Polygon::Size; ++corner) {
+				indices.push_back(polygon[corner].Data());
+			}
+		}
+		outputArchive << static_cast<uint8_t>(sizeof(uint32_t));
+		ExportTypedBuffer(outputArchive, indices.data(), indices.size());
+	}
+}
+
+cd::Point QuantizedMesh::DecodePosition(uint32_t vertexIndex) const {
+	const uint16_t *pPosition = m_positions.GetData() + vertexIndex * 3;
+	return cd::Point(DequantizeUnorm16(pPosition[0], m_positionMin.x(), m_positionExtent.x()),
+		DequantizeUnorm16(pPosition[1], m_positionMin.y(), m_positionExtent.y()),
+		DequantizeUnorm16(pPosition[2], m_positionMin.z(), m_positionExtent.z()));
+}
+
+cd::UV QuantizedMesh::DecodeUV(const UVSet &uvSet, uint32_t vertexIndex) const {
+	const uint16_t *pUV = uvSet.m_uvs.GetData() + vertexIndex * 2;
+	return cd::UV(DequantizeUnorm16(pUV[0], uvSet.m_min.x(), uvSet.m_extent.x()),
+		DequantizeUnorm16(pUV[1], uvSet.m_min.y(), uvSet.m_extent.y()));
+}
+
+bool QuantizedMesh::HasValidIndices() const {
+	const uint32_t vertexCount = m_vertexCount;
+	const auto isValid = [vertexCount](uint32_t index) { return index < vertexCount; };
+	return std::all_of(m_indices16.begin(), m_indices16.end(), isValid) && std::all_of(m_indices32.begin(), m_indices32.end(), isValid);
+}
+
+cd::Mesh QuantizedMesh::ToMesh() {
+	cd::Mesh mesh(cd::MeshID(m_meshID), m_name.c_str(), m_vertexCount, m_polygonCount);
+	mesh.SetMaterialID(m_materialID);
+	mesh.SetAABB(cd::MoveTemp(m_aabb));
+	mesh.SetVertexFormat(cd::MoveTemp(m_vertexFormat));
+
+	std::vector<cd::Point> &positions = mesh.GetVertexPositions();
+	positions.resize(m_vertexCount);
+	for(uint32_t vertexIndex = 0; vertexIndex < m_vertexCount; ++vertexIndex) {
+		positions[vertexIndex] = DecodePosition(vertexIndex);
+	}
+
+	auto decodeDirections = [](const BufferView<OctahedralSnorm16> &encoded, std::vector<cd::Direction> &directions) {
+		directions.resize(encoded.GetCount());
+		std::transform(encoded.begin(), encoded.end(), directions.begin(), DecodeOctahedral);
+	};
+	decodeDirections(m_normals, mesh.GetVertexNormals());
+	decodeDirections(m_tangents, mesh.GetVertexTangents());
+	decodeDirections(m_bitangents, mesh.GetVertexBiTangents());
+
+	mesh.SetVertexUVSetCount(static_cast<uint32_t>(m_uvSets.size()));
+	for(uint32_t uvSetIndex = 0; uvSetIndex < m_uvSets.size(); ++uvSetIndex) {
+		std::vector<cd::UV> &uvs = mesh.GetVertexUVs(uvSetIndex);
+		uvs.resize(m_vertexCount);
+		for(uint32_t vertexIndex = 0; vertexIndex < m_vertexCount; ++vertexIndex) {
+			uvs[vertexIndex] = DecodeUV(m_uvSets[uvSetIndex], vertexIndex);
+		}
+	}
+
+	std::vector<unsigned int> indices(static_cast<std::size_t>(m_polygonCount) * 3);
+	DecodeIndices(indices.data());
+	std::vector<cd::Polygon> &polygons = mesh.GetPolygons();
+	polygons.resize(m_polygonCount);
+	for(uint32_t polygonIndex = 0; polygonIndex < m_polygonCount; ++polygonIndex) {
+		const unsigned int *pIndices = indices.data() + polygonIndex * 3;
+		polygons[polygonIndex] = cd::Polygon(cd::VertexID(pIndices[0]), cd::VertexID(pIndices[1]), cd::VertexID(pIndices[2]));
+	}
+
+	return mesh;
+}
+
+void QuantizedMesh::DecodeIndices(unsigned int *pIndices) const {
+	if(!m_indices16.IsEmpty()) {
+		std::copy(m_indices16.begin(), m_indices16.end(), pIndices);
+	}
+	else {
+		std::copy(m_indices32.begin(), m_indices32.end(), pIndices);
+	}
+}
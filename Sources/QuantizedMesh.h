@@ -0,0 +1,181 @@
+#pragma once
+
+#include "BufferView.h"
+#include "Scene/Mesh.h"
+#include "Scene/VertexFormat.h"
+
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+// Compact vertex encoding for static meshes, used for SceneChunkType::QuantizedMesh chunks.
+//   Positions : unorm16 x3 relative to the bounds of the vertex positions.
+//   Normals, tangents and bitangents : octahedral snorm16 x2.
+//   UVs : unorm16 x2 relative to the bounds of each UV set.
+//   Indices : uint16 when every vertex fits, uint32 otherwise.
+// A float vertex with one UV set takes 56 bytes, the quantized one 22.
+// Position error is at most half a step of extent / 65535 per axis and directions stay within about 0.05 degrees.
+struct OctahedralSnorm16
+{
+	// Lets ByteSwapBuffer swap the two components separately.
+	using ValueType = int16_t;
+
+	int16_t m_x;
+	int16_t m_y;
+};
+
+OctahedralSnorm16 EncodeOctahedral(const cd::Direction &direction);
+cd::Direction DecodeOctahedral(OctahedralSnorm16 encoded);
+
+// Only meshes without morphs, skinning, vertex colors or adjacency are quantized, since those aren't stored.
+bool IsQuantizable(const cd::Mesh &mesh);
+
+void WriteQuantizedMesh(const cd::Mesh &mesh, cd::OutputArchive &outputArchive);
+
+// Quantized streams of one mesh.
+// Streams read from an uncompressed chunk in a mapped file borrow the mapping, so they must not outlive the reader.
+class QuantizedMesh
+{
+public:
+	QuantizedMesh() = default;
+	QuantizedMesh(const QuantizedMesh&) = delete;
+	QuantizedMesh& operator=(const QuantizedMesh&) = delete;
+	QuantizedMesh(QuantizedMesh&&) = default;
+	QuantizedMesh& operator=(QuantizedMesh&&) = default;
+	~QuantizedMesh() = default;
+
+	template<bool SwapBytesOrder>
+	bool Read(std::istream &stream);
+
+	// Takes ownership of the chunk data which the streams were read from, such as a decompressed block.
+	void SetStorage(std::vector<char> chunkData) { m_chunkData = std::move(chunkData); }
+
+	uint32_t GetID() const { return m_meshID; }
+	uint32_t GetVertexCount() const { return m_vertexCount; }
+	uint32_t GetPolygonCount() const { return m_polygonCount; }
+
+	// Decodes back to float streams.
+	cd::Mesh ToMesh();
+
+	// Decodes straight into an interleaved vertex buffer of GetVertexCount() vertices, without going through cd::Mesh.
+	// Vertex needs m_position, m_normal, m_tangent, m_bitangent and m_texCoords members which can be assigned from braced floats.
+	// Only the first UV set is decoded, missing streams leave their members untouched.
+	template<typename Vertex>
+	void DecodeVertices(Vertex *pVertices) const;
+
+	// Triangle list indices, widened to uint32.
+	void DecodeIndices(unsigned int *pIndices) const;
+
+private:
+	struct UVSet
+	{
+		cd::UV m_min;
+		cd::UV m_extent;
+		BufferView<uint16_t> m_uvs;
+		std::vector<uint16_t> m_storage;
+	};
+
+	cd::Point DecodePosition(uint32_t vertexIndex) const;
+	cd::UV DecodeUV(const UVSet &uvSet, uint32_t vertexIndex) const;
+	bool HasValidIndices() const;
+
+	uint32_t m_meshID = 0;
+	std::string m_name;
+	uint32_t m_materialID = 0;
+	cd::AABB m_aabb;
+	cd::VertexFormat m_vertexFormat;
+	uint32_t m_vertexCount = 0;
+	uint32_t m_polygonCount = 0;
+
+	cd::Point m_positionMin;
+	cd::Point m_positionExtent;
+	BufferView<uint16_t> m_positions;
+	BufferView<OctahedralSnorm16> m_normals;
+	BufferView<OctahedralSnorm16> m_tangents;
+	BufferView<OctahedralSnorm16> m_bitangents;
+	std::vector<UVSet> m_uvSets;
+	BufferView<uint16_t> m_indices16;
+	BufferView<uint32_t> m_indices32;
+
+	std::vector<char> m_chunkData;
+	std::vector<uint16_t> m_positionStorage;
+	std::vector<OctahedralSnorm16> m_normalStorage;
+	std::vector<OctahedralSnorm16> m_tangentStorage;
+	std::vector<OctahedralSnorm16> m_bitangentStorage;
+	std::vector<uint16_t> m_index16Storage;
+	std::vector<uint32_t> m_index32Storage;
+};
+
+template<bool SwapBytesOrder>
+bool QuantizedMesh::Read(std::istream &stream) {
+	cd::TInputArchive<SwapBytesOrder> inputArchive(&stream);
+
+	uint32_t uvSetCount;
+	inputArchive >> m_meshID >> m_name >> m_materialID >> m_aabb;
+	m_vertexFormat << inputArchive;
+	inputArchive >> m_vertexCount >> m_polygonCount >> m_positionMin >> m_positionExtent >> uvSetCount;
+	if(!stream || uvSetCount > cd::MaxUVSetCount) {
+		return false;
+	}
+
+	// Optional direction streams are stored empty.
+	const std::size_t vertexCount = m_vertexCount;
+	auto isDirectionStream = [vertexCount](const BufferView<OctahedralSnorm16> &view) {
+		return view.IsEmpty() || view.GetCount() == vertexCount;
+	};
+
+	if(!ImportBufferView<SwapBytesOrder>(stream, m_positions, m_positionStorage) || m_positions.GetCount() != vertexCount * 3 ||
+		!ImportBufferView<SwapBytesOrder>(stream, m_normals, m_normalStorage) || !isDirectionStream(m_normals) ||
+		!ImportBufferView<SwapBytesOrder>(stream, m_tangents, m_tangentStorage) || !isDirectionStream(m_tangents) ||
+		!ImportBufferView<SwapBytesOrder>(stream, m_bitangents, m_bitangentStorage) || !isDirectionStream(m_bitangents)) {
+		return false;
+	}
+
+	m_uvSets.resize(uvSetCount);
+	for(UVSet &uvSet : m_uvSets) {
+		inputArchive >> uvSet.m_min >> uvSet.m_extent;
+		if(!ImportBufferView<SwapBytesOrder>(stream, uvSet.m_uvs, uvSet.m_storage) || uvSet.m_uvs.GetCount() != vertexCount * 2) {
+			return false;
+		}
+	}
+
+	const std::size_t indexCount = static_cast<std::size_t>(m_polygonCount) * 3;
+	uint8_t indexBytes;
+	inputArchive >> indexBytes;
+	bool indicesRead = false;
+	if(2 == indexBytes) {
+		indicesRead = ImportBufferView<SwapBytesOrder>(stream, m_indices16, m_index16Storage) && m_indices16.GetCount() == indexCount;
+	}
+	else if(4 == indexBytes) {
+		indicesRead = ImportBufferView<SwapBytesOrder>(stream, m_indices32, m_index32Storage) && m_indices32.GetCount() == indexCount;
+	}
+
+	// Decoded meshes index the vertex streams with these, so a corrupt index would read past them.
+	return indicesRead && HasValidIndices();
+}
+
+template<typename Vertex>
+void QuantizedMesh::DecodeVertices(Vertex *pVertices) const {
+	for(uint32_t vertexIndex = 0; vertexIndex < m_vertexCount; ++vertexIndex) {
+		Vertex &vertex = pVertices[vertexIndex];
+
+		const cd::Point position = DecodePosition(vertexIndex);
+		vertex.m_position = { position.x(), position.y(), position.z() };
+		if(!m_normals.IsEmpty()) {
+			const cd::Direction normal = DecodeOctahedral(m_normals[vertexIndex]);
+			vertex.m_normal = { normal.x(), normal.y(), normal.z() };
+		}
+		if(!m_tangents.IsEmpty()) {
+			const cd::Direction tangent = DecodeOctahedral(m_tangents[vertexIndex]);
+			vertex.m_tangent = { tangent.x(), tangent.y(), tangent.z() };
+		}
+		if(!m_bitangents.IsEmpty()) {
+			const cd::Direction bitangent = DecodeOctahedral(m_bitangents[vertexIndex]);
+			vertex.m_bitangent = { bitangent.x(), bitangent.y(), bitangent.z() };
+		}
+		if(!m_uvSets.empty()) {
+			const cd::UV uv = DecodeUV(m_uvSets[0], vertexIndex);
+			vertex.m_texCoords = { uv.x(), uv.y() };
+		}
+	}
+}
@@ -0,0 +1,231 @@
+#include "RenderQueue.h"
+
+#include "mesh.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+constexpr uint32_t BaseColorSamplerHash = UniformNameHash("s_texBaseColor");
+constexpr uint32_t NormalSamplerHash = UniformNameHash("s_texNormal");
+constexpr uint32_t ORMSamplerHash = UniformNameHash("s_texORM");
+
+constexpr GLuint MaterialTextureUnits[RenderQueue::MaterialTextureCount] = {
+	RenderQueue::BaseColorTextureUnit,
+	RenderQueue::NormalTextureUnit,
+	RenderQueue::ORMTextureUnit,
+};
+
+}
+
+void RenderStats::Print() const {
+	printf("Render stats : %u draws submitted, %u instance groups, %u draw calls (%s), %u state groups, %u program binds, %u texture binds, %u uniform sets\n",
+		m_submittedDraws, m_instanceGroups, m_drawCalls, m_multiDrawIndirect ? "multi draw indirect" : "instanced", m_stateGroups,
+		m_programBinds, m_textureBinds, m_uniformSets);
+}
+
+RenderQueue::~RenderQueue() {
+	glDeleteBuffers(1, &m_indirectBuffer);
+	glDeleteBuffers(1, &m_instanceBuffer);
+}
+
+void RenderQueue::Clear() {
+	m_items.clear();
+	m_matrices.clear();
+}
+
+void RenderQueue::Submit(const Shader &shader, const GLMesh &mesh, const glm::mat4 &worldMatrix) {
+	if(0 == mesh.m_range.m_indexCount) {
+		return;
+	}
+
+	DrawItem item;
+	item.m_pShader = &shader;
+	item.m_program = shader.m_id;
+	item.m_textures[0] = mesh.GetTexture(cd::MaterialTextureType::BaseColor);
+	item.m_textures[1] = mesh.GetTexture(cd::MaterialTextureType::Normal);
+	item.m_textures[2] = mesh.GetTexture(cd::MaterialTextureType::Metallic);
+	item.m_range = mesh.m_range;
+	item.m_matrixIndex = static_cast<uint32_t>(m_matrices.size());
+	m_items.push_back(item);
+	m_matrices.push_back(worldMatrix);
+}
+
+bool RenderQueue::IsSameState(const DrawItem &lhs, const DrawItem &rhs) {
+	return lhs.m_program == rhs.m_program && 0 == std::memcmp(lhs.m_textures, rhs.m_textures, sizeof(lhs.m_textures));
+}
+
+bool RenderQueue::IsSameMesh(const DrawItem &lhs, const DrawItem &rhs) {
+	return lhs.m_range.m_firstIndex == rhs.m_range.m_firstIndex && lhs.m_range.m_indexCount == rhs.m_range.m_indexCount &&
+		lhs.m_range.m_baseVertex == rhs.m_range.m_baseVertex;
+}
+
+void RenderQueue::Flush(const GLMeshArena &arena) {
+	m_stats = RenderStats();
+	m_stats.m_submittedDraws = static_cast<uint32_t>(m_items.size());
+	if(m_items.empty()) {
+		return;
+	}
+
+	// Same states end up adjacent, meshes keep arena order within a state which keeps index fetches sequential
+	// and puts the placements of a mesh next to each other.
+	std::sort(m_items.begin(), m_items.end(), [](const DrawItem &lhs, const DrawItem &rhs) {
+		if(lhs.m_program != rhs.m_program) {
+			return lhs.m_program < rhs.m_program;
+		}
+		const int textureOrder = std::memcmp(lhs.m_textures, rhs.m_textures, sizeof(lhs.m_textures));
+		if(textureOrder != 0) {
+			return textureOrder < 0;
+		}
+		return lhs.m_range.m_firstIndex < rhs.m_range.m_firstIndex;
+	});
+
+	// Groups never span two states, since the state is part of the sort key before the mesh.
+	m_instanceGroups.clear();
+	for(std::size_t itemIndex = 0; itemIndex < m_items.size(); ++itemIndex) {
+		if(m_instanceGroups.empty() || !IsSameState(m_items[itemIndex - 1], m_items[itemIndex]) ||
+			!IsSameMesh(m_items[itemIndex - 1], m_items[itemIndex])) {
+			m_instanceGroups.push_back({ static_cast<uint32_t>(itemIndex), 0 });
+		}
+		++m_instanceGroups.back().m_instanceCount;
+	}
+	m_stats.m_instanceGroups = static_cast<uint32_t>(m_instanceGroups.size());
+
+	const bool useIndirect = GLAD_GL_VERSION_4_3 != 0;
+	m_stats.m_multiDrawIndirect = useIndirect;
+
+	// Attribute state is part of the arena's VAO, so it is set up after binding it.
+	arena.Bind();
+	UploadInstances();
+	if(useIndirect) {
+		UploadIndirectDraws();
+	}
+
+	const DrawItem *pPrevious = nullptr;
+	for(std::size_t groupBegin = 0; groupBegin < m_instanceGroups.size();) {
+		const DrawItem &item = m_items[m_instanceGroups[groupBegin].m_firstItem];
+		std::size_t groupEnd = groupBegin + 1;
+		while(groupEnd < m_instanceGroups.size() && IsSameState(item, m_items[m_instanceGroups[groupEnd].m_firstItem])) {
+			++groupEnd;
+		}
+
+		BindState(item, pPrevious);
+		pPrevious = &item;
+
+		if(useIndirect) {
+			DrawIndirect(groupBegin, groupEnd);
+		}
+		else {
+			DrawDirect(groupBegin, groupEnd);
+		}
+
+		++m_stats.m_stateGroups;
+		groupBegin = groupEnd;
+	}
+
+	glBindVertexArray(0);
+	if(useIndirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void RenderQueue::SetInstanceAttributes(std::size_t firstInstance) {
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for(GLuint column = 0; column < 4; ++column) {
+		glVertexAttribPointer(ModelMatrixAttribute + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			(void *)(firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderQueue::UploadInstances() {
+	// Matrices of the whole frame go up in one upload, sorted item i uses matrix i.
+	m_sortedMatrices.resize(m_items.size());
+	for(std::size_t itemIndex = 0; itemIndex < m_items.size(); ++itemIndex) {
+		m_sortedMatrices[itemIndex] = m_matrices[m_items[itemIndex].m_matrixIndex];
+	}
+
+	if(0 == m_instanceBuffer) {
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	const std::size_t matrixBytes = m_sortedMatrices.size() * sizeof(glm::mat4);
+	m_instanceBufferCapacity = std::max(m_instanceBufferCapacity, matrixBytes);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_instanceBufferCapacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(matrixBytes), m_sortedMatrices.data());
+	for(GLuint column = 0; column < 4; ++column) {
+		glEnableVertexAttribArray(ModelMatrixAttribute + column);
+		glVertexAttribDivisor(ModelMatrixAttribute + column, 1);
+	}
+	SetInstanceAttributes(0);
+}
+
+void RenderQueue::UploadIndirectDraws() {
+	// One command per instance group, its base instance is the group's first matrix.
+	m_commands.resize(m_instanceGroups.size());
+	for(std::size_t groupIndex = 0; groupIndex < m_instanceGroups.size(); ++groupIndex) {
+		const InstanceGroup &group = m_instanceGroups[groupIndex];
+		const GLMeshRange &range = m_items[group.m_firstItem].m_range;
+		m_commands[groupIndex] = { range.m_indexCount, group.m_instanceCount, range.m_firstIndex, range.m_baseVertex, group.m_firstItem };
+	}
+
+	if(0 == m_indirectBuffer) {
+		glGenBuffers(1, &m_indirectBuffer);
+	}
+
+	const std::size_t commandBytes = m_commands.size() * sizeof(DrawElementsIndirectCommand);
+	m_indirectBufferCapacity = std::max(m_indirectBufferCapacity, commandBytes);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(m_indirectBufferCapacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, static_cast<GLsizeiptr>(commandBytes), m_commands.data());
+}
+
+void RenderQueue::DrawIndirect(std::size_t groupBegin, std::size_t groupEnd) {
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		reinterpret_cast<const void *>(groupBegin * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(groupEnd - groupBegin), 0);
+	++m_stats.m_drawCalls;
+}
+
+void RenderQueue::DrawDirect(std::size_t groupBegin, std::size_t groupEnd) {
+	// Without base instances the attribute itself is moved to the group's first matrix.
+	for(std::size_t groupIndex = groupBegin; groupIndex < groupEnd; ++groupIndex) {
+		const InstanceGroup &group = m_instanceGroups[groupIndex];
+		const GLMeshRange &range = m_items[group.m_firstItem].m_range;
+		if(group.m_firstItem != 0) {
+			SetInstanceAttributes(group.m_firstItem);
+		}
+
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.m_indexCount), GL_UNSIGNED_INT,
+			reinterpret_cast<const void *>(static_cast<std::size_t>(range.m_firstIndex) * sizeof(uint32_t)),
+			static_cast<GLsizei>(group.m_instanceCount), range.m_baseVertex);
+		++m_stats.m_drawCalls;
+	}
+}
+
+void RenderQueue::BindState(const DrawItem &item, const DrawItem *pPrevious) {
+	const bool programChanged = !pPrevious || pPrevious->m_program != item.m_program;
+	if(programChanged) {
+		item.m_pShader->Use();
+		item.m_pShader->SetInt(item.m_pShader->GetUniform(BaseColorSamplerHash), BaseColorTextureUnit);
+		item.m_pShader->SetInt(item.m_pShader->GetUniform(NormalSamplerHash), NormalTextureUnit);
+		item.m_pShader->SetInt(item.m_pShader->GetUniform(ORMSamplerHash), ORMTextureUnit);
+		++m_stats.m_programBinds;
+		m_stats.m_uniformSets += 3;
+	}
+
+	// Units keep their textures across programs, only rebind the ones which differ.
+	for(uint32_t textureIndex = 0; textureIndex < MaterialTextureCount; ++textureIndex) {
+		if(pPrevious && pPrevious->m_textures[textureIndex] == item.m_textures[textureIndex]) {
+			continue;
+		}
+		glActiveTexture(GL_TEXTURE0 + MaterialTextureUnits[textureIndex]);
+		glBindTexture(GL_TEXTURE_2D, item.m_textures[textureIndex]);
+		++m_stats.m_textureBinds;
+	}
+}
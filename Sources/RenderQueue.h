@@ -0,0 +1,112 @@
+#pragma once
+
+#include "GLMeshArena.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class GLMesh;
+class Shader;
+
+// GL calls issued by one RenderQueue::Flush, to measure batching without a profiler, e.g. headless under llvmpipe.
+struct RenderStats
+{
+	uint32_t m_submittedDraws = 0;
+	// Runs of the same mesh in the same state, each drawn as instances of one command.
+	uint32_t m_instanceGroups = 0;
+	uint32_t m_drawCalls = 0;
+	uint32_t m_stateGroups = 0;
+	uint32_t m_programBinds = 0;
+	uint32_t m_textureBinds = 0;
+	uint32_t m_uniformSets = 0;
+	bool m_multiDrawIndirect = false;
+
+	void Print() const;
+};
+
+// Collects the draws of a frame, sorts them by program, texture set and mesh and issues them with as few state changes as possible.
+// Every draw has its own world matrix, read by the vertex shader from the per instance a_model attribute at ModelMatrixAttribute.
+// The matrices of the frame are uploaded into one instance buffer in sorted order, so placements of the same mesh are adjacent
+// and drawn as the instances of one command.
+// On GL 4.3 contexts each command indexes the buffer with its base instance, so draws sharing a state are merged into one
+// glMultiDrawElementsIndirect. Older contexts point the attribute at each group's matrices and issue glDrawElementsInstancedBaseVertex.
+// Material textures use fixed units, so the sampler uniforms are only set when the program changes.
+class RenderQueue
+{
+public:
+	static constexpr GLuint BaseColorTextureUnit = 0;
+	static constexpr GLuint NormalTextureUnit = 1;
+	static constexpr GLuint ORMTextureUnit = 2;
+	static constexpr uint32_t MaterialTextureCount = 3;
+
+	// A mat4 attribute takes this location and the next three.
+	static constexpr GLuint ModelMatrixAttribute = 5;
+
+public:
+	RenderQueue() = default;
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+	RenderQueue(RenderQueue&&) = default;
+	RenderQueue& operator=(RenderQueue&&) = default;
+	~RenderQueue();
+
+	void Clear();
+	void Submit(const Shader &shader, const GLMesh &mesh, const glm::mat4 &worldMatrix);
+
+	// Draws everything submitted since the last Clear, every mesh has to come from arena.
+	void Flush(const GLMeshArena &arena);
+
+	const RenderStats &GetStats() const { return m_stats; }
+
+private:
+	struct DrawItem
+	{
+		const Shader *m_pShader;
+		GLuint m_program;
+		GLuint m_textures[MaterialTextureCount];
+		GLMeshRange m_range;
+		uint32_t m_matrixIndex;
+	};
+
+	// Layout fixed by GL for glMultiDrawElementsIndirect.
+	struct DrawElementsIndirectCommand
+	{
+		GLuint m_count;
+		GLuint m_instanceCount;
+		GLuint m_firstIndex;
+		GLint m_baseVertex;
+		GLuint m_baseInstance;
+	};
+
+	// Adjacent sorted items of one mesh, drawn as instanceCount instances with the matrices from m_firstItem on.
+	struct InstanceGroup
+	{
+		uint32_t m_firstItem;
+		uint32_t m_instanceCount;
+	};
+
+	static bool IsSameState(const DrawItem &lhs, const DrawItem &rhs);
+	static bool IsSameMesh(const DrawItem &lhs, const DrawItem &rhs);
+
+	void BindState(const DrawItem &item, const DrawItem *pPrevious);
+	void SetInstanceAttributes(std::size_t firstInstance);
+	void UploadInstances();
+	void UploadIndirectDraws();
+	void DrawIndirect(std::size_t groupBegin, std::size_t groupEnd);
+	void DrawDirect(std::size_t groupBegin, std::size_t groupEnd);
+
+	std::vector<DrawItem> m_items;
+	std::vector<InstanceGroup> m_instanceGroups;
+	std::vector<glm::mat4> m_matrices;
+	std::vector<glm::mat4> m_sortedMatrices;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+	GLuint m_indirectBuffer = 0;
+	GLuint m_instanceBuffer = 0;
+	std::size_t m_indirectBufferCapacity = 0;
+	std::size_t m_instanceBufferCapacity = 0;
+	RenderStats m_stats;
+};
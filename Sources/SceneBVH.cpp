@@ -0,0 +1,440 @@
+#include "SceneBVH.h"
+
+#include "ParallelFor.h"
+
+namespace
+{
+
+// Relative costs of visiting a node and of testing an item for the surface area heuristic.
+constexpr float TraversalCost = 1.0f;
+constexpr float IntersectionCost = 1.0f;
+
+// Scenes below this size aren't worth the threads.
+constexpr uint32_t ParallelBuildItemCount = 4096;
+
+struct Bounds
+{
+	glm::vec3 m_min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 m_max = glm::vec3(-std::numeric_limits<float>::max());
+
+	void Merge(const glm::vec3 &min, const glm::vec3 &max) {
+		m_min = glm::min(m_min, min);
+		m_max = glm::max(m_max, max);
+	}
+
+	// Half of the surface area, the factor doesn't matter for the heuristic.
+	float GetHalfArea() const {
+		const glm::vec3 extent = m_max - m_min;
+		return extent.x < 0.0f ? 0.0f : extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+};
+
+// Items are partitioned as whole records rather than through m_itemIndices, so every pass over a range reads memory in order.
+struct BuildItem
+{
+	glm::vec3 m_min;
+	uint32_t m_index;
+	glm::vec3 m_max;
+	float m_padding;
+
+	float GetCentroid(uint32_t axis) const { return (m_min[axis] + m_max[axis]) * 0.5f; }
+};
+
+// A node whose range is built later, possibly on another thread.
+struct BuildTask
+{
+	uint32_t m_nodeIndex;
+	uint32_t m_depth;
+};
+
+SceneBVHNode MakeNode(const std::vector<BuildItem> &items, uint32_t first, uint32_t count) {
+	Bounds bounds;
+	for(uint32_t itemOffset = first; itemOffset < first + count; ++itemOffset) {
+		bounds.Merge(items[itemOffset].m_min, items[itemOffset].m_max);
+	}
+	return SceneBVHNode{ bounds.m_min, first, bounds.m_max, count };
+}
+
+uint32_t GetBin(float centroid, float axisMin, float binScale, uint32_t binCount) {
+	return std::min(binCount - 1, static_cast<uint32_t>((centroid - axisMin) * binScale));
+}
+
+struct Split
+{
+	// 0 when the range should stay a leaf.
+	uint32_t m_leftCount = 0;
+	Bounds m_leftBounds;
+	Bounds m_rightBounds;
+};
+
+// Items tested together cost as much as one, see SceneBVH::Build.
+float GetBatchCount(uint32_t itemCount, uint32_t batchSize) {
+	return static_cast<float>((itemCount + batchSize - 1) / batchSize);
+}
+
+// Picks the cheapest of the bin boundaries on all three axes, binned in one pass over the range, and partitions the items.
+Split SplitRange(std::vector<BuildItem> &items, const SceneBVHNode &node, uint32_t batchSize) {
+	const auto rangeBegin = items.begin() + node.m_leftOrFirst;
+	const auto rangeEnd = rangeBegin + node.m_itemCount;
+	const uint32_t count = node.m_itemCount;
+
+	Bounds centroidBounds;
+	for(auto it = rangeBegin; it != rangeEnd; ++it) {
+		const glm::vec3 centroid = (it->m_min + it->m_max) * 0.5f;
+		centroidBounds.Merge(centroid, centroid);
+	}
+
+	// Small ranges near the leaves don't need more bins than items, most nodes are there.
+	const uint32_t binCount = std::min(SceneBVH::BinCount, count);
+	const glm::vec3 centroidExtent = centroidBounds.m_max - centroidBounds.m_min;
+	glm::vec3 binScale;
+	for(uint32_t axis = 0; axis < 3; ++axis) {
+		binScale[axis] = centroidExtent[axis] > 0.0f ? binCount / centroidExtent[axis] : 0.0f;
+	}
+
+	Bounds bins[3][SceneBVH::BinCount];
+	uint32_t binCounts[3][SceneBVH::BinCount] = {};
+	for(auto it = rangeBegin; it != rangeEnd; ++it) {
+		const glm::vec3 centroid = (it->m_min + it->m_max) * 0.5f;
+		for(uint32_t axis = 0; axis < 3; ++axis) {
+			const uint32_t bin = GetBin(centroid[axis], centroidBounds.m_min[axis], binScale[axis], binCount);
+			bins[axis][bin].Merge(it->m_min, it->m_max);
+			++binCounts[axis][bin];
+		}
+	}
+
+	// Costs are kept multiplied by the node's area, which also works for flat nodes.
+	Bounds nodeBounds;
+	nodeBounds.Merge(node.m_min, node.m_max);
+	const float nodeArea = nodeBounds.GetHalfArea();
+	float bestCost = std::numeric_limits<float>::max();
+	uint32_t bestAxis = 0;
+	uint32_t bestSplit = 0;
+	for(uint32_t axis = 0; axis < 3; ++axis) {
+		if(0.0f == binScale[axis]) {
+			continue;
+		}
+
+		// Sweep from the right to get the cost of every right side, then from the left to finish the costs of each split.
+		float rightCosts[SceneBVH::BinCount] = {};
+		Bounds rightBounds;
+		uint32_t rightCount = 0;
+		for(uint32_t bin = binCount - 1; bin > 0; --bin) {
+			rightBounds.Merge(bins[axis][bin].m_min, bins[axis][bin].m_max);
+			rightCount += binCounts[axis][bin];
+			rightCosts[bin] = rightBounds.GetHalfArea() * GetBatchCount(rightCount, batchSize);
+		}
+
+		Bounds leftBounds;
+		uint32_t leftCount = 0;
+		for(uint32_t split = 1; split < binCount; ++split) {
+			leftBounds.Merge(bins[axis][split - 1].m_min, bins[axis][split - 1].m_max);
+			leftCount += binCounts[axis][split - 1];
+			if(0 == leftCount || count == leftCount) {
+				continue;
+			}
+
+			const float cost = TraversalCost * nodeArea + IntersectionCost * (leftBounds.GetHalfArea() * GetBatchCount(leftCount, batchSize) + rightCosts[split]);
+			if(cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	Split split;
+	const bool hasSplit = bestSplit > 0;
+	if(count <= SceneBVH::MaxLeafItemCount && (!hasSplit || bestCost >= IntersectionCost * GetBatchCount(count, batchSize) * nodeArea)) {
+		return split;
+	}
+
+	// Items on top of each other can't be binned, halve them so that leaves stay small.
+	if(!hasSplit) {
+		split.m_leftCount = count / 2;
+		split.m_leftBounds = nodeBounds;
+		split.m_rightBounds = nodeBounds;
+		return split;
+	}
+
+	for(uint32_t bin = 0; bin < binCount; ++bin) {
+		Bounds &childBounds = bin < bestSplit ? split.m_leftBounds : split.m_rightBounds;
+		childBounds.Merge(bins[bestAxis][bin].m_min, bins[bestAxis][bin].m_max);
+		split.m_leftCount += bin < bestSplit ? binCounts[bestAxis][bin] : 0;
+	}
+
+	const float axisMin = centroidBounds.m_min[bestAxis];
+	std::partition(rangeBegin, rangeEnd, [&](const BuildItem &item) {
+		return GetBin(item.GetCentroid(bestAxis), axisMin, binScale[bestAxis], binCount) < bestSplit;
+	});
+	return split;
+}
+
+// Splits nodes[rootIndex], whose range is stored like a leaf, until the heuristic prefers leaves.
+// With pTasks, ranges of at most taskItemCount items are left to tasks instead.
+void BuildNodes(std::vector<BuildItem> &items, std::vector<SceneBVHNode> &nodes, uint32_t batchSize,
+	uint32_t rootIndex, uint32_t rootDepth, uint32_t taskItemCount, std::vector<BuildTask> *pTasks) {
+	std::vector<BuildTask> stack;
+	stack.push_back({ rootIndex, rootDepth });
+	while(!stack.empty()) {
+		const BuildTask current = stack.back();
+		stack.pop_back();
+
+		const SceneBVHNode node = nodes[current.m_nodeIndex];
+		if(pTasks && node.m_itemCount <= taskItemCount) {
+			pTasks->push_back(current);
+			continue;
+		}
+		if(current.m_depth >= SceneBVH::MaxDepth) {
+			continue;
+		}
+
+		const Split split = SplitRange(items, node, batchSize);
+		if(0 == split.m_leftCount) {
+			continue;
+		}
+
+		const uint32_t leftIndex = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(SceneBVHNode{ split.m_leftBounds.m_min, node.m_leftOrFirst, split.m_leftBounds.m_max, split.m_leftCount });
+		nodes.push_back(SceneBVHNode{ split.m_rightBounds.m_min, node.m_leftOrFirst + split.m_leftCount, split.m_rightBounds.m_max,
+			node.m_itemCount - split.m_leftCount });
+		nodes[current.m_nodeIndex].m_leftOrFirst = leftIndex;
+		nodes[current.m_nodeIndex].m_itemCount = 0;
+
+		stack.push_back({ leftIndex + 1, current.m_depth + 1 });
+		stack.push_back({ leftIndex, current.m_depth + 1 });
+	}
+}
+}
+
+void SceneBVH::Build(const CullingBoxes &boxes, std::size_t threadCount, uint32_t leafBatchSize) {
+	const uint32_t itemCount = boxes.GetCount();
+	std::vector<BuildItem> items(itemCount);
+	m_itemMins.resize(itemCount);
+	m_itemMaxs.resize(itemCount);
+	for(uint32_t itemIndex = 0; itemIndex < itemCount; ++itemIndex) {
+		const glm::vec3 center(boxes.GetCenterX()[itemIndex], boxes.GetCenterY()[itemIndex], boxes.GetCenterZ()[itemIndex]);
+		const glm::vec3 extent(boxes.GetExtentX()[itemIndex], boxes.GetExtentY()[itemIndex], boxes.GetExtentZ()[itemIndex]);
+		m_itemMins[itemIndex] = center - extent;
+		m_itemMaxs[itemIndex] = center + extent;
+		items[itemIndex] = BuildItem{ m_itemMins[itemIndex], itemIndex, m_itemMaxs[itemIndex], 0.0f };
+	}
+
+	m_nodes.clear();
+	m_itemIndices.resize(itemCount);
+	if(0 == itemCount) {
+		m_leafBoxes.Clear();
+		return;
+	}
+	m_nodes.reserve(2 * itemCount);
+	m_nodes.push_back(MakeNode(items, 0, itemCount));
+
+	if(0 == threadCount) {
+		threadCount = GetDefaultThreadCount();
+	}
+	if(threadCount <= 1 || itemCount < ParallelBuildItemCount) {
+		BuildNodes(items, m_nodes, leafBatchSize, 0, 0, 0, nullptr);
+	}
+	else {
+		// The top of the tree is split here until the ranges are small enough to give every thread several subtrees.
+		// Subtrees partition disjoint ranges of items into their own node arrays, which are appended afterwards.
+		const uint32_t taskItemCount = std::max(ParallelBuildItemCount / 4, itemCount / static_cast<uint32_t>(threadCount * 8));
+		std::vector<BuildTask> tasks;
+		BuildNodes(items, m_nodes, leafBatchSize, 0, 0, taskItemCount, &tasks);
+
+		std::vector<std::vector<SceneBVHNode>> taskNodes(tasks.size());
+		ParallelFor(tasks.size(), [&](std::size_t taskIndex) {
+			std::vector<SceneBVHNode> &nodes = taskNodes[taskIndex];
+			nodes.reserve(2 * m_nodes[tasks[taskIndex].m_nodeIndex].m_itemCount);
+			nodes.push_back(m_nodes[tasks[taskIndex].m_nodeIndex]);
+			BuildNodes(items, nodes, leafBatchSize, 0, tasks[taskIndex].m_depth, 0, nullptr);
+		}, threadCount);
+
+		// The subtree root replaces its placeholder, the other nodes move by the append position.
+		for(std::size_t taskIndex = 0; taskIndex < tasks.size(); ++taskIndex) {
+			const std::vector<SceneBVHNode> &nodes = taskNodes[taskIndex];
+			const uint32_t nodeOffset = static_cast<uint32_t>(m_nodes.size()) - 1;
+			auto relocate = [nodeOffset](SceneBVHNode node) {
+				if(!node.IsLeaf()) {
+					node.m_leftOrFirst += nodeOffset;
+				}
+				return node;
+			};
+
+			m_nodes[tasks[taskIndex].m_nodeIndex] = relocate(nodes[0]);
+			for(std::size_t nodeIndex = 1; nodeIndex < nodes.size(); ++nodeIndex) {
+				m_nodes.push_back(relocate(nodes[nodeIndex]));
+			}
+		}
+	}
+
+	for(uint32_t itemOffset = 0; itemOffset < itemCount; ++itemOffset) {
+		m_itemIndices[itemOffset] = items[itemOffset].m_index;
+	}
+	UpdateLeafBoxes(boxes);
+}
+
+void SceneBVH::Refit(const CullingBoxes &boxes) {
+	if(boxes.GetCount() != GetItemCount()) {
+		Build(boxes);
+		return;
+	}
+
+	for(uint32_t itemIndex = 0; itemIndex < GetItemCount(); ++itemIndex) {
+		const glm::vec3 center(boxes.GetCenterX()[itemIndex], boxes.GetCenterY()[itemIndex], boxes.GetCenterZ()[itemIndex]);
+		const glm::vec3 extent(boxes.GetExtentX()[itemIndex], boxes.GetExtentY()[itemIndex], boxes.GetExtentZ()[itemIndex]);
+		m_itemMins[itemIndex] = center - extent;
+		m_itemMaxs[itemIndex] = center + extent;
+	}
+	UpdateLeafBoxes(boxes);
+
+	// Children always come after their parent, so walking backwards visits them first.
+	for(uint32_t nodeIndex = GetNodeCount(); nodeIndex-- > 0;) {
+		SceneBVHNode &node = m_nodes[nodeIndex];
+		Bounds bounds;
+		if(node.IsLeaf()) {
+			for(uint32_t itemOffset = node.m_leftOrFirst; itemOffset < node.m_leftOrFirst + node.m_itemCount; ++itemOffset) {
+				bounds.Merge(m_itemMins[m_itemIndices[itemOffset]], m_itemMaxs[m_itemIndices[itemOffset]]);
+			}
+		}
+		else {
+			bounds.Merge(m_nodes[node.m_leftOrFirst].m_min, m_nodes[node.m_leftOrFirst].m_max);
+			bounds.Merge(m_nodes[node.m_leftOrFirst + 1].m_min, m_nodes[node.m_leftOrFirst + 1].m_max);
+		}
+		node.m_min = bounds.m_min;
+		node.m_max = bounds.m_max;
+	}
+}
+
+void SceneBVH::Clear() {
+	m_nodes.clear();
+	m_itemIndices.clear();
+	m_itemMins.clear();
+	m_itemMaxs.clear();
+	m_leafBoxes.Clear();
+}
+
+void SceneBVH::QueryFrustum(const FrustumCuller &culler, std::vector<uint32_t> &items) const {
+	if(m_nodes.empty()) {
+		return;
+	}
+
+	glm::vec3 normals[FrustumCuller::PlaneCount];
+	glm::vec3 absNormals[FrustumCuller::PlaneCount];
+	float distances[FrustumCuller::PlaneCount];
+	for(uint32_t planeIndex = 0; planeIndex < FrustumCuller::PlaneCount; ++planeIndex) {
+		const cd::Plane &plane = culler.GetPlanes()[planeIndex];
+		normals[planeIndex] = glm::vec3(plane.GetNormal().x(), plane.GetNormal().y(), plane.GetNormal().z());
+		absNormals[planeIndex] = glm::abs(normals[planeIndex]);
+		distances[planeIndex] = plane.GetDistance();
+	}
+
+	// Tests a box against the planes in planeMask. Returns false when it is outside, otherwise clears the planes it is inside of.
+	auto testBox = [&](const glm::vec3 &boxMin, const glm::vec3 &boxMax, uint32_t &planeMask) {
+		const glm::vec3 center = (boxMin + boxMax) * 0.5f;
+		const glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+		for(uint32_t planeIndex = 0; planeIndex < FrustumCuller::PlaneCount; ++planeIndex) {
+			if(0 == (planeMask & (1u << planeIndex))) {
+				continue;
+			}
+
+			const float distance = glm::dot(normals[planeIndex], center) - distances[planeIndex];
+			const float radius = glm::dot(absNormals[planeIndex], extent);
+			if(distance + radius < 0.0f) {
+				return false;
+			}
+			if(distance - radius >= 0.0f) {
+				planeMask &= ~(1u << planeIndex);
+			}
+		}
+		return true;
+	};
+
+	// A subtree's items are one range, from its leftmost leaf to its rightmost one.
+	auto addSubtree = [&](uint32_t nodeIndex) {
+		uint32_t leftmostIndex = nodeIndex;
+		while(!m_nodes[leftmostIndex].IsLeaf()) {
+			leftmostIndex = m_nodes[leftmostIndex].m_leftOrFirst;
+		}
+		uint32_t rightmostIndex = nodeIndex;
+		while(!m_nodes[rightmostIndex].IsLeaf()) {
+			rightmostIndex = m_nodes[rightmostIndex].m_leftOrFirst + 1;
+		}
+		items.insert(items.end(), m_itemIndices.begin() + m_nodes[leftmostIndex].m_leftOrFirst,
+			m_itemIndices.begin() + m_nodes[rightmostIndex].m_leftOrFirst + m_nodes[rightmostIndex].m_itemCount);
+	};
+
+	constexpr uint32_t AllPlanes = (1u << FrustumCuller::PlaneCount) - 1;
+	uint32_t stackNodes[MaxDepth + 2];
+	uint32_t stackPlaneMasks[MaxDepth + 2];
+	uint32_t stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackPlaneMasks[stackSize++] = AllPlanes;
+	while(stackSize > 0) {
+		--stackSize;
+		const uint32_t nodeIndex = stackNodes[stackSize];
+		uint32_t planeMask = stackPlaneMasks[stackSize];
+		const SceneBVHNode &node = m_nodes[nodeIndex];
+		if(!testBox(node.m_min, node.m_max, planeMask)) {
+			continue;
+		}
+		if(0 == planeMask) {
+			addSubtree(nodeIndex);
+			continue;
+		}
+
+		if(node.IsLeaf()) {
+			// Leaves deeper than MaxDepth may hold more items than the flags.
+			uint8_t visible[MaxLeafItemCount];
+			for(uint32_t batchOffset = 0; batchOffset < node.m_itemCount; batchOffset += MaxLeafItemCount) {
+				const uint32_t firstItem = node.m_leftOrFirst + batchOffset;
+				const uint32_t batchCount = std::min(MaxLeafItemCount, node.m_itemCount - batchOffset);
+				culler.Cull(m_leafBoxes, firstItem, batchCount, visible);
+				for(uint32_t itemOffset = 0; itemOffset < batchCount; ++itemOffset) {
+					if(visible[itemOffset]) {
+						items.push_back(m_itemIndices[firstItem + itemOffset]);
+					}
+				}
+			}
+			continue;
+		}
+
+		stackNodes[stackSize] = node.m_leftOrFirst + 1;
+		stackPlaneMasks[stackSize++] = planeMask;
+		stackNodes[stackSize] = node.m_leftOrFirst;
+		stackPlaneMasks[stackSize++] = planeMask;
+	}
+}
+
+SceneBVHHit SceneBVH::Raycast(const cd::Ray &ray, float maxDistance) const {
+	const RayData rayData = GetRayData(ray);
+	return Raycast(ray, maxDistance, [this, &rayData](uint32_t itemIndex, float closestDistance) {
+		return IntersectBox(m_itemMins[itemIndex], m_itemMaxs[itemIndex], rayData, closestDistance);
+	});
+}
+
+void SceneBVH::UpdateLeafBoxes(const CullingBoxes &boxes) {
+	// Copied from the centers and extents rather than m_itemMins and m_itemMaxs, so leaves cull exactly like FrustumCuller::Cull.
+	m_leafBoxes.Clear();
+	m_leafBoxes.Reserve(m_itemIndices.size());
+	for(uint32_t itemIndex : m_itemIndices) {
+		m_leafBoxes.Add(glm::vec3(boxes.GetCenterX()[itemIndex], boxes.GetCenterY()[itemIndex], boxes.GetCenterZ()[itemIndex]),
+			glm::vec3(boxes.GetExtentX()[itemIndex], boxes.GetExtentY()[itemIndex], boxes.GetExtentZ()[itemIndex]));
+	}
+}
+
+SceneBVH::RayData SceneBVH::GetRayData(const cd::Ray &ray) {
+	// Axis parallel directions give infinite inverses, which the slab test handles.
+	const glm::vec3 direction(ray.Direction().x(), ray.Direction().y(), ray.Direction().z());
+	return RayData{ glm::vec3(ray.Origin().x(), ray.Origin().y(), ray.Origin().z()), 1.0f / direction };
+}
+
+float SceneBVH::IntersectBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const RayData &ray, float maxDistance) {
+	const glm::vec3 t0 = (boxMin - ray.m_origin) * ray.m_inverseDirection;
+	const glm::vec3 t1 = (boxMax - ray.m_origin) * ray.m_inverseDirection;
+	const glm::vec3 tNear = glm::min(t0, t1);
+	const glm::vec3 tFar = glm::max(t0, t1);
+	const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	const float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+	return entry <= exit && entry < maxDistance ? entry : std::numeric_limits<float>::infinity();
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "FrustumCulling.h"
+#include "Math/Ray.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// 32 bytes, two nodes per cache line. Siblings are adjacent, so an interior node only stores its left child.
+struct SceneBVHNode
+{
+	glm::vec3 m_min;
+	// First item of a leaf or left child of an interior node, whose right child follows it.
+	uint32_t m_leftOrFirst;
+	glm::vec3 m_max;
+	// 0 for interior nodes.
+	uint32_t m_itemCount;
+
+	bool IsLeaf() const { return m_itemCount > 0; }
+};
+static_assert(sizeof(SceneBVHNode) == 32, "SceneBVHNode should stay 32 bytes.");
+
+struct SceneBVHHit
+{
+	uint32_t m_itemIndex = UINT32_MAX;
+	float m_distance = std::numeric_limits<float>::infinity();
+
+	bool IsValid() const { return m_itemIndex != UINT32_MAX; }
+};
+
+// Bounding volume hierarchy over axis aligned item boxes, such as the world bounds of the meshes in a scene.
+// Splits are chosen with the binned surface area heuristic and the nodes are stored depth first in one array.
+// Large hierarchies build their subtrees on several threads. Moved items are handled by Refit, which keeps the topology.
+class SceneBVH
+{
+public:
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+	static constexpr uint32_t BinCount = 12;
+	static constexpr uint32_t MaxLeafItemCount = 8;
+	// Deeper ranges become leaves whatever their size, which bounds the traversal stacks.
+	static constexpr uint32_t MaxDepth = 48;
+
+public:
+	SceneBVH() = default;
+	SceneBVH(const SceneBVH&) = delete;
+	SceneBVH& operator=(const SceneBVH&) = delete;
+	SceneBVH(SceneBVH&&) = default;
+	SceneBVH& operator=(SceneBVH&&) = default;
+	~SceneBVH() = default;
+
+	// Item indices are the box indices. threadCount 0 means GetDefaultThreadCount().
+	// leafBatchSize is the number of items which a query tests at the same cost as one, such as FrustumCuller::GetBatchSize(),
+	// so the heuristic keeps fuller leaves instead of splitting below it.
+	void Build(const CullingBoxes &boxes, std::size_t threadCount = 0, uint32_t leafBatchSize = 1);
+
+	// Updates the node bounds for new boxes of the same items, bottom up in one pass.
+	// Cheaper than Build but the tree gets worse as items move far from where they were built.
+	void Refit(const CullingBoxes &boxes);
+
+	void Clear();
+
+	uint32_t GetItemCount() const { return static_cast<uint32_t>(m_itemIndices.size()); }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+	const std::vector<SceneBVHNode> &GetNodes() const { return m_nodes; }
+
+	// Item indices in leaf order, a leaf's items are m_itemCount entries from m_leftOrFirst.
+	const std::vector<uint32_t> &GetItemIndices() const { return m_itemIndices; }
+
+	// Appends the items whose boxes may intersect the frustum. Subtrees completely inside are added without further tests,
+	// the items of the other leaves go through the culler's SIMD kernels.
+	void QueryFrustum(const FrustumCuller &culler, std::vector<uint32_t> &items) const;
+
+	// Closest item along the ray within maxDistance, in units of the ray direction's length.
+	// intersectItem(itemIndex, closestDistance) returns the distance of a finer test, such as against triangles,
+	// or infinity when the item is missed. Items are visited near to far, so most of the tree is skipped.
+	template<typename IntersectItem>
+	SceneBVHHit Raycast(const cd::Ray &ray, float maxDistance, IntersectItem &&intersectItem) const;
+
+	// Closest item box along the ray.
+	SceneBVHHit Raycast(const cd::Ray &ray, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+private:
+	struct RayData
+	{
+		glm::vec3 m_origin;
+		glm::vec3 m_inverseDirection;
+	};
+
+	static RayData GetRayData(const cd::Ray &ray);
+
+	void UpdateLeafBoxes(const CullingBoxes &boxes);
+
+	// Slab test, returns the entry distance or infinity when the box is missed or further than maxDistance.
+	static float IntersectBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const RayData &ray, float maxDistance);
+
+	std::vector<SceneBVHNode> m_nodes;
+	std::vector<uint32_t> m_itemIndices;
+	std::vector<glm::vec3> m_itemMins;
+	std::vector<glm::vec3> m_itemMaxs;
+	// Item boxes in the order of m_itemIndices, so that a leaf's boxes are one range for FrustumCuller.
+	CullingBoxes m_leafBoxes;
+};
+
+template<typename IntersectItem>
+SceneBVHHit SceneBVH::Raycast(const cd::Ray &ray, float maxDistance, IntersectItem &&intersectItem) const {
+	SceneBVHHit hit;
+	hit.m_distance = maxDistance;
+	if(m_nodes.empty()) {
+		return hit;
+	}
+
+	const RayData rayData = GetRayData(ray);
+	if(IntersectBox(m_nodes[0].m_min, m_nodes[0].m_max, rayData, hit.m_distance) == std::numeric_limits<float>::infinity()) {
+		return hit;
+	}
+
+	// Nodes and their entry distances, the nearer child is pushed last so that it is visited first.
+	// Plain arrays, an array of std::pair would be zeroed on every call.
+	uint32_t stackNodes[MaxDepth + 2];
+	float stackDistances[MaxDepth + 2];
+	uint32_t stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackDistances[stackSize++] = 0.0f;
+	while(stackSize > 0) {
+		--stackSize;
+		const uint32_t nodeIndex = stackNodes[stackSize];
+		const float entryDistance = stackDistances[stackSize];
+		if(entryDistance >= hit.m_distance) {
+			continue;
+		}
+
+		const SceneBVHNode &node = m_nodes[nodeIndex];
+		if(node.IsLeaf()) {
+			for(uint32_t itemOffset = 0; itemOffset < node.m_itemCount; ++itemOffset) {
+				const uint32_t itemIndex = m_itemIndices[node.m_leftOrFirst + itemOffset];
+				const float distance = intersectItem(itemIndex, hit.m_distance);
+				if(distance < hit.m_distance) {
+					hit.m_itemIndex = itemIndex;
+					hit.m_distance = distance;
+				}
+			}
+			continue;
+		}
+
+		const uint32_t leftIndex = node.m_leftOrFirst;
+		const uint32_t rightIndex = leftIndex + 1;
+		float leftDistance = IntersectBox(m_nodes[leftIndex].m_min, m_nodes[leftIndex].m_max, rayData, hit.m_distance);
+		float rightDistance = IntersectBox(m_nodes[rightIndex].m_min, m_nodes[rightIndex].m_max, rayData, hit.m_distance);
+		uint32_t nearIndex = leftIndex;
+		uint32_t farIndex = rightIndex;
+		if(rightDistance < leftDistance) {
+			std::swap(leftDistance, rightDistance);
+			std::swap(nearIndex, farIndex);
+		}
+		if(rightDistance != std::numeric_limits<float>::infinity()) {
+			stackNodes[stackSize] = farIndex;
+			stackDistances[stackSize++] = rightDistance;
+		}
+		if(leftDistance != std::numeric_limits<float>::infinity()) {
+			stackNodes[stackSize] = nearIndex;
+			stackDistances[stackSize++] = leftDistance;
+		}
+	}
+
+	return hit;
+}
@@ -0,0 +1,419 @@
+#include "SceneChunkFile.h"
+
+#include "BufferedOutputStream.h"
+#include "Lz4Block.h"
+#include "ParallelFor.h"
+#include "Utilities/ByteSwap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <variant>
+
+namespace
+{
+
+// Chunk payloads start on 16 byte boundaries so that borrowed buffer views into a mapped file stay aligned.
+constexpr uint64_t ChunkAlignment = 16;
+
+class ChunkWriteContext
+{
+public:
+	ChunkWriteContext(BufferedOutputStream &stream, bool compress) :
+		m_stream(stream), m_outputArchive(&stream), m_chunkArchive(&m_chunkStream), m_compress(compress) {}
+
+	// Compressed chunks are serialized into memory first since the stored size is only known after compression.
+	cd::OutputArchive &GetArchive() { return m_compress ? m_chunkArchive : m_outputArchive; }
+	std::vector<SceneChunkEntry> &GetEntries() { return m_entries; }
+	uint64_t GetPosition() { return static_cast<uint64_t>(m_stream.tellp()); }
+
+	void BeginChunk(SceneChunkType type, uint32_t objectID) {
+		static constexpr char padding[ChunkAlignment] = {};
+		const uint64_t misalignment = GetPosition() % ChunkAlignment;
+		if(misalignment != 0) {
+			m_stream.write(padding, static_cast<std::streamsize>(ChunkAlignment - misalignment));
+		}
+
+		m_entries.push_back({ type, objectID, GetPosition(), 0, 0 });
+		if(m_compress) {
+			m_chunkStream.str(std::string());
+		}
+	}
+
+	void EndChunk() {
+		SceneChunkEntry &entry = m_entries.back();
+		if(!m_compress) {
+			entry.m_size = GetPosition() - entry.m_offset;
+			entry.m_storedSize = entry.m_size;
+			return;
+		}
+
+		const std::string chunkData = m_chunkStream.str();
+		entry.m_size = chunkData.size();
+
+		// Chunks which don't shrink, such as already compressed texture payloads, are stored as is.
+		m_compressedData.resize(Lz4CompressBound(chunkData.size()));
+		const std::size_t compressedSize = Lz4Compress(chunkData.data(), chunkData.size(), m_compressedData.data(), m_compressedData.size());
+		if(compressedSize > 0 && compressedSize < chunkData.size()) {
+			m_stream.write(m_compressedData.data(), static_cast<std::streamsize>(compressedSize));
+			entry.m_storedSize = compressedSize;
+		}
+		else {
+			m_stream.write(chunkData.data(), static_cast<std::streamsize>(chunkData.size()));
+			entry.m_storedSize = chunkData.size();
+		}
+	}
+
+	template<typename T>
+	void WriteChunks(const std::vector<T> &objects) {
+		for(const T &object : objects) {
+			BeginChunk(SceneChunkTypeOf<T>::Value, object.GetID().Data());
+			object >> GetArchive();
+			EndChunk();
+		}
+	}
+
+private:
+	BufferedOutputStream &m_stream;
+	cd::OutputArchive m_outputArchive;
+	std::ostringstream m_chunkStream;
+	cd::OutputArchive m_chunkArchive;
+	std::vector<char> m_compressedData;
+	std::vector<SceneChunkEntry> m_entries;
+	bool m_compress;
+};
+
+uint64_t MakeEntryKey(SceneChunkType type, uint32_t objectID) {
+	return (static_cast<uint64_t>(type) << 32) | objectID;
+}
+
+// Chunk type of the object which a chunk decodes to, so that alternative encodings sort together.
+SceneChunkType GetObjectChunkType(SceneChunkType type) {
+	return SceneChunkType::QuantizedMesh == type ? SceneChunkType::Mesh : type;
+}
+
+using DecodedObject = std::variant<std::monostate, cd::Node, cd::Mesh, cd::Morph, cd::Material, cd::Texture,
+	cd::Camera, cd::Light, cd::Bone, cd::Animation, cd::Track>;
+
+template<typename T>
+void DecodeChunk(const SceneChunkReader &reader, const SceneChunkEntry &entry, DecodedObject &object) {
+	std::optional<T> decoded = reader.ReadObject<T>(entry);
+	if(decoded) {
+		object.emplace<T>(cd::MoveTemp(*decoded));
+	}
+	else {
+		printf("Failed to decode chunk %u of type %u.\n", entry.m_objectID, static_cast<uint32_t>(entry.m_type));
+	}
+}
+
+void DecodeQuantizedMeshChunk(const SceneChunkReader &reader, const SceneChunkEntry &entry, DecodedObject &object,
+	const std::function<void(const QuantizedMesh &)> &onQuantizedMesh) {
+	std::optional<QuantizedMesh> quantizedMesh = reader.ReadQuantizedMesh(entry);
+	if(quantizedMesh) {
+		if(onQuantizedMesh) {
+			onQuantizedMesh(*quantizedMesh);
+		}
+		object.emplace<cd::Mesh>(quantizedMesh->ToMesh());
+	}
+	else {
+		printf("Failed to decode quantized mesh chunk %u.\n", entry.m_objectID);
+	}
+}
+
+}
+
+bool SceneChunkWriter::Write(const cd::SceneDatabase &sceneDatabase, const char *pFilePath, const SceneChunkWriteOptions &options) {
+	std::ofstream fout(pFilePath, std::ios::out | std::ios::binary);
+	if(!fout.is_open()) {
+		printf("Failed to open chunk file for writing : %s\n", pFilePath);
+		return false;
+	}
+
+	SceneChunkFileHeader header {};
+	std::memcpy(header.m_magic, SceneChunkFileMagic, sizeof(SceneChunkFileMagic));
+	header.m_version = SceneChunkFileVersion;
+	header.m_endian = static_cast<uint8_t>(cd::Endian::GetNative());
+
+	{
+		BufferedOutputStream stream(fout);
+		ChunkWriteContext context(stream, options.m_compress);
+
+		// Placeholder, patched below once the table of contents position is known.
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+		context.BeginChunk(SceneChunkType::SceneInfo, 0);
+		context.GetArchive() << std::string(sceneDatabase.GetName()) << sceneDatabase.GetAABB()
+			<< sceneDatabase.GetAxisSystem() << static_cast<uint8_t>(sceneDatabase.GetUnit());
+		context.EndChunk();
+
+		context.WriteChunks(sceneDatabase.GetNodes());
+		if(options.m_quantizeMeshes) {
+			for(const cd::Mesh &mesh : sceneDatabase.GetMeshes()) {
+				if(IsQuantizable(mesh)) {
+					context.BeginChunk(SceneChunkType::QuantizedMesh, mesh.GetID().Data());
+					WriteQuantizedMesh(mesh, context.GetArchive());
+					context.EndChunk();
+				}
+				else {
+					context.BeginChunk(SceneChunkType::Mesh, mesh.GetID().Data());
+					mesh >> context.GetArchive();
+					context.EndChunk();
+				}
+			}
+		}
+		else {
+			context.WriteChunks(sceneDatabase.GetMeshes());
+		}
+		context.WriteChunks(sceneDatabase.GetMorphs());
+		context.WriteChunks(sceneDatabase.GetMaterials());
+		context.WriteChunks(sceneDatabase.GetTextures());
+		context.WriteChunks(sceneDatabase.GetCameras());
+		context.WriteChunks(sceneDatabase.GetLights());
+		context.WriteChunks(sceneDatabase.GetBones());
+		context.WriteChunks(sceneDatabase.GetAnimations());
+		context.WriteChunks(sceneDatabase.GetTracks());
+
+		const std::vector<SceneChunkEntry> &entries = context.GetEntries();
+		header.m_chunkCount = static_cast<uint32_t>(entries.size());
+		header.m_tocOffset = context.GetPosition();
+		stream.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(SceneChunkEntry)));
+
+		if(!stream.Flush()) {
+			printf("Failed to write chunk file : %s\n", pFilePath);
+			return false;
+		}
+	}
+
+	fout.seekp(0);
+	fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	return fout.good();
+}
+
+bool SceneChunkReader::IsChunkFile(const char *pData, std::size_t size) {
+	return size >= sizeof(SceneChunkFileHeader) && 0 == std::memcmp(pData, SceneChunkFileMagic, sizeof(SceneChunkFileMagic));
+}
+
+SceneChunkReader::SceneChunkReader(MappedFile file) : m_file(std::move(file)) {
+	if(!m_file.IsValid() || !IsChunkFile(m_file.GetData(), m_file.GetSize())) {
+		return;
+	}
+
+	SceneChunkFileHeader header;
+	std::memcpy(&header, m_file.GetData(), sizeof(header));
+
+	m_swapBytes = static_cast<cd::EndianType>(header.m_endian) != cd::Endian::GetNative();
+	if(m_swapBytes) {
+		header.m_version = cd::byte_swap<uint32_t>(header.m_version);
+		header.m_chunkCount = cd::byte_swap<uint32_t>(header.m_chunkCount);
+		header.m_tocOffset = cd::byte_swap<uint64_t>(header.m_tocOffset);
+	}
+
+	if(header.m_version != SceneChunkFileVersion) {
+		printf("Unsupported chunk file version : %u\n", header.m_version);
+		return;
+	}
+
+	const uint64_t fileSize = m_file.GetSize();
+	const uint64_t tocBytes = static_cast<uint64_t>(header.m_chunkCount) * sizeof(SceneChunkEntry);
+	if(header.m_tocOffset > fileSize || tocBytes > fileSize - header.m_tocOffset) {
+		printf("Chunk file table of contents is out of range.\n");
+		return;
+	}
+
+	m_entries.resize(header.m_chunkCount);
+	std::memcpy(m_entries.data(), m_file.GetData() + header.m_tocOffset, static_cast<std::size_t>(tocBytes));
+
+	m_entryIndices.reserve(m_entries.size());
+	for(uint32_t entryIndex = 0; entryIndex < header.m_chunkCount; ++entryIndex) {
+		SceneChunkEntry &entry = m_entries[entryIndex];
+		if(m_swapBytes) {
+			entry.m_type = static_cast<SceneChunkType>(cd::byte_swap<uint32_t>(static_cast<uint32_t>(entry.m_type)));
+			entry.m_objectID = cd::byte_swap<uint32_t>(entry.m_objectID);
+			entry.m_offset = cd::byte_swap<uint64_t>(entry.m_offset);
+			entry.m_storedSize = cd::byte_swap<uint64_t>(entry.m_storedSize);
+			entry.m_size = cd::byte_swap<uint64_t>(entry.m_size);
+		}
+
+		// A LZ4 block can't expand more than 255 times, which bounds the allocation for a corrupt size.
+		const bool validSize = entry.m_storedSize == entry.m_size ||
+			(entry.m_storedSize < entry.m_size && entry.m_size / 255 <= entry.m_storedSize);
+		if(entry.m_offset > fileSize || entry.m_storedSize > fileSize - entry.m_offset || !validSize) {
+			printf("Chunk %u is out of range.\n", entryIndex);
+			m_entries.clear();
+			m_entryIndices.clear();
+			return;
+		}
+
+		m_entryIndices[MakeEntryKey(entry.m_type, entry.m_objectID)] = entryIndex;
+	}
+
+	m_valid = true;
+}
+
+const char *SceneChunkReader::GetChunkData(const SceneChunkEntry &entry, std::vector<char> &decompressedData) const {
+	const char *pStoredData = m_file.GetData() + entry.m_offset;
+	if(entry.m_storedSize == entry.m_size) {
+		return pStoredData;
+	}
+
+	decompressedData.resize(static_cast<std::size_t>(entry.m_size));
+	if(!Lz4Decompress(pStoredData, static_cast<std::size_t>(entry.m_storedSize), decompressedData.data(), decompressedData.size())) {
+		return nullptr;
+	}
+	return decompressedData.data();
+}
+
+std::optional<QuantizedMesh> SceneChunkReader::ReadQuantizedMesh(uint32_t meshID) const {
+	const SceneChunkEntry *pEntry = FindEntry(SceneChunkType::QuantizedMesh, meshID);
+	if(!pEntry) {
+		return std::nullopt;
+	}
+	return ReadQuantizedMesh(*pEntry);
+}
+
+std::optional<QuantizedMesh> SceneChunkReader::ReadQuantizedMesh(const SceneChunkEntry &entry) const {
+	std::vector<char> decompressedData;
+	const char *pData = GetChunkData(entry, decompressedData);
+	if(!pData) {
+		return std::nullopt;
+	}
+
+	QuantizedMesh quantizedMesh;
+	MemoryInputStream stream(pData, static_cast<std::size_t>(entry.m_size));
+	const bool succeeded = m_swapBytes ? quantizedMesh.Read<true>(stream) : quantizedMesh.Read<false>(stream);
+	if(!succeeded) {
+		return std::nullopt;
+	}
+
+	// Streams borrowed from the decompressed block stay valid, moving a vector keeps its allocation.
+	quantizedMesh.SetStorage(std::move(decompressedData));
+	return quantizedMesh;
+}
+
+const SceneChunkEntry *SceneChunkReader::FindEntry(SceneChunkType type, uint32_t objectID) const {
+	const auto it = m_entryIndices.find(MakeEntryKey(type, objectID));
+	return it != m_entryIndices.end() ? &m_entries[it->second] : nullptr;
+}
+
+bool SceneChunkReader::ReadSceneInfo(cd::SceneDatabase *pSceneDatabase) const {
+	const SceneChunkEntry *pEntry = FindEntry(SceneChunkType::SceneInfo, 0);
+	if(!pEntry) {
+		return false;
+	}
+
+	std::string name;
+	cd::AABB aabb;
+	cd::AxisSystem axisSystem;
+	uint8_t unit;
+
+	std::vector<char> decompressedData;
+	const char *pData = GetChunkData(*pEntry, decompressedData);
+	if(!pData) {
+		return false;
+	}
+
+	MemoryInputStream stream(pData, static_cast<std::size_t>(pEntry->m_size));
+	if(m_swapBytes) {
+		cd::InputArchiveSwapBytes inputArchive(&stream);
+		inputArchive >> name >> aabb >> axisSystem >> unit;
+	}
+	else {
+		cd::InputArchive inputArchive(&stream);
+		inputArchive >> name >> aabb >> axisSystem >> unit;
+	}
+	if(stream.fail()) {
+		return false;
+	}
+
+	pSceneDatabase->SetName(name.c_str());
+	pSceneDatabase->SetAABB(cd::MoveTemp(aabb));
+	pSceneDatabase->SetAxisSystem(cd::MoveTemp(axisSystem));
+	pSceneDatabase->SetUnit(static_cast<cd::Unit>(unit));
+	return true;
+}
+
+bool SceneChunkReader::ReadAll(cd::SceneDatabase *pSceneDatabase, std::size_t threadCount,
+	const std::function<void(const QuantizedMesh &)> &onQuantizedMesh) const {
+	if(!m_valid) {
+		return false;
+	}
+
+	std::vector<DecodedObject> decodedObjects(m_entries.size());
+
+	// Decompression happens inside each worker too, so compressed files decode just as parallel as stored ones.
+	ParallelFor(m_entries.size(), [this, &decodedObjects, &onQuantizedMesh](std::size_t entryIndex) {
+		const SceneChunkEntry &entry = m_entries[entryIndex];
+		DecodedObject &object = decodedObjects[entryIndex];
+		switch(entry.m_type) {
+		case SceneChunkType::Node: DecodeChunk<cd::Node>(*this, entry, object); break;
+		case SceneChunkType::Mesh: DecodeChunk<cd::Mesh>(*this, entry, object); break;
+		case SceneChunkType::Morph: DecodeChunk<cd::Morph>(*this, entry, object); break;
+		case SceneChunkType::Material: DecodeChunk<cd::Material>(*this, entry, object); break;
+		case SceneChunkType::Texture: DecodeChunk<cd::Texture>(*this, entry, object); break;
+		case SceneChunkType::Camera: DecodeChunk<cd::Camera>(*this, entry, object); break;
+		case SceneChunkType::Light: DecodeChunk<cd::Light>(*this, entry, object); break;
+		case SceneChunkType::Bone: DecodeChunk<cd::Bone>(*this, entry, object); break;
+		case SceneChunkType::Animation: DecodeChunk<cd::Animation>(*this, entry, object); break;
+		case SceneChunkType::Track: DecodeChunk<cd::Track>(*this, entry, object); break;
+		case SceneChunkType::QuantizedMesh: DecodeQuantizedMeshChunk(*this, entry, object, onQuantizedMesh); break;
+		case SceneChunkType::SceneInfo: break;
+		default: printf("Unknown chunk type %u.\n", static_cast<uint32_t>(entry.m_type)); break;
+		}
+	}, threadCount);
+
+	for(std::size_t entryIndex = 0; entryIndex < m_entries.size(); ++entryIndex) {
+		if(SceneChunkType::SceneInfo != m_entries[entryIndex].m_type && std::holds_alternative<std::monostate>(decodedObjects[entryIndex])) {
+			return false;
+		}
+	}
+
+	// SceneDatabase looks objects up by index, so they have to be added in ID order whatever order the workers finished in.
+	std::vector<uint32_t> entryOrder(m_entries.size());
+	std::iota(entryOrder.begin(), entryOrder.end(), 0U);
+	std::stable_sort(entryOrder.begin(), entryOrder.end(), [this](uint32_t lhs, uint32_t rhs) {
+		const SceneChunkEntry &lhsEntry = m_entries[lhs];
+		const SceneChunkEntry &rhsEntry = m_entries[rhs];
+		return MakeEntryKey(GetObjectChunkType(lhsEntry.m_type), lhsEntry.m_objectID) <
+			MakeEntryKey(GetObjectChunkType(rhsEntry.m_type), rhsEntry.m_objectID);
+	});
+
+	// Also catches a mesh stored both as a Mesh and a QuantizedMesh chunk.
+	SceneChunkType previousType = SceneChunkType::SceneInfo;
+	uint32_t nextObjectID = 0;
+	for(uint32_t entryIndex : entryOrder) {
+		const SceneChunkEntry &entry = m_entries[entryIndex];
+		const SceneChunkType objectType = GetObjectChunkType(entry.m_type);
+		if(objectType != previousType) {
+			previousType = objectType;
+			nextObjectID = 0;
+		}
+		if(SceneChunkType::SceneInfo != objectType && entry.m_objectID != nextObjectID++) {
+			printf("Chunk %u of type %u is out of ID order.\n", entry.m_objectID, static_cast<uint32_t>(entry.m_type));
+			return false;
+		}
+	}
+
+	if(!ReadSceneInfo(pSceneDatabase)) {
+		printf("Failed to read scene info chunk.\n");
+		return false;
+	}
+
+	for(uint32_t entryIndex : entryOrder) {
+		std::visit([pSceneDatabase](auto &object) {
+			using T = std::decay_t<decltype(object)>;
+			if constexpr (std::is_same_v<T, cd::Node>) { pSceneDatabase->AddNode(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Mesh>) { pSceneDatabase->AddMesh(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Morph>) { pSceneDatabase->AddMorph(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Material>) { pSceneDatabase->AddMaterial(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Texture>) { pSceneDatabase->AddTexture(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Camera>) { pSceneDatabase->AddCamera(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Light>) { pSceneDatabase->AddLight(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Bone>) { pSceneDatabase->AddBone(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Animation>) { pSceneDatabase->AddAnimation(cd::MoveTemp(object)); }
+			else if constexpr (std::is_same_v<T, cd::Track>) { pSceneDatabase->AddTrack(cd::MoveTemp(object)); }
+		}, decodedObjects[entryIndex]);
+	}
+	return true;
+}
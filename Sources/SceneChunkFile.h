@@ -0,0 +1,182 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MemoryStream.h"
+#include "QuantizedMesh.h"
+#include "Scene/SceneDatabase.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Chunked, seekable scene container.
+// Unlike a .cdbin, which has to be deserialized from start to end, every object lives in its own chunk
+// and a table of contents at the end of the file tells where to find it, so readers can load a subset by ID.
+//
+// Layout :
+//   SceneChunkFileHeader
+//   Chunk payloads, each one object serialized by its own operator>>(OutputArchive&)
+//   SceneChunkEntry[chunkCount] at tocOffset
+//
+// Each payload may be an independent LZ4 block, entries whose stored size is smaller than their size are compressed.
+// Chunks never share compression state, so they still decompress in parallel and unread chunks cost nothing.
+// Static meshes may be stored as QuantizedMesh chunks instead of Mesh chunks, readers decode them back to cd::Mesh.
+enum class SceneChunkType : uint32_t
+{
+	SceneInfo,
+	Node,
+	Mesh,
+	Morph,
+	Material,
+	Texture,
+	Camera,
+	Light,
+	Bone,
+	Animation,
+	Track,
+	QuantizedMesh,
+};
+
+struct SceneChunkFileHeader
+{
+	char m_magic[4];
+	uint32_t m_version;
+	uint8_t m_endian;
+	uint8_t m_padding[3];
+	uint32_t m_chunkCount;
+	uint64_t m_tocOffset;
+};
+
+struct SceneChunkEntry
+{
+	SceneChunkType m_type;
+	uint32_t m_objectID;
+	uint64_t m_offset;
+	// Bytes in the file, equal to m_size when the chunk is stored uncompressed.
+	uint64_t m_storedSize;
+	// Bytes of the serialized object.
+	uint64_t m_size;
+};
+
+static_assert(24 == sizeof(SceneChunkFileHeader));
+static_assert(32 == sizeof(SceneChunkEntry));
+
+constexpr char SceneChunkFileMagic[4] = { 'C', 'D', 'C', 'K' };
+constexpr uint32_t SceneChunkFileVersion = 2;
+
+template<typename T>
+struct SceneChunkTypeOf;
+
+template<> struct SceneChunkTypeOf<cd::Node> { static constexpr SceneChunkType Value = SceneChunkType::Node; };
+template<> struct SceneChunkTypeOf<cd::Mesh> { static constexpr SceneChunkType Value = SceneChunkType::Mesh; };
+template<> struct SceneChunkTypeOf<cd::Morph> { static constexpr SceneChunkType Value = SceneChunkType::Morph; };
+template<> struct SceneChunkTypeOf<cd::Material> { static constexpr SceneChunkType Value = SceneChunkType::Material; };
+template<> struct SceneChunkTypeOf<cd::Texture> { static constexpr SceneChunkType Value = SceneChunkType::Texture; };
+template<> struct SceneChunkTypeOf<cd::Camera> { static constexpr SceneChunkType Value = SceneChunkType::Camera; };
+template<> struct SceneChunkTypeOf<cd::Light> { static constexpr SceneChunkType Value = SceneChunkType::Light; };
+template<> struct SceneChunkTypeOf<cd::Bone> { static constexpr SceneChunkType Value = SceneChunkType::Bone; };
+template<> struct SceneChunkTypeOf<cd::Animation> { static constexpr SceneChunkType Value = SceneChunkType::Animation; };
+template<> struct SceneChunkTypeOf<cd::Track> { static constexpr SceneChunkType Value = SceneChunkType::Track; };
+
+struct SceneChunkWriteOptions
+{
+	// Every chunk which gets smaller is stored as an LZ4 block.
+	bool m_compress = false;
+	// Meshes accepted by IsQuantizable are stored as QuantizedMesh chunks. Lossy, see QuantizedMesh.h.
+	bool m_quantizeMeshes = false;
+};
+
+class SceneChunkWriter
+{
+public:
+	static bool Write(const cd::SceneDatabase &sceneDatabase, const char *pFilePath, const SceneChunkWriteOptions &options = SceneChunkWriteOptions());
+};
+
+class SceneChunkReader
+{
+public:
+	// Cheap check on the file header, used to tell chunked files from linear .cdbin files.
+	static bool IsChunkFile(const char *pData, std::size_t size);
+
+public:
+	SceneChunkReader() = delete;
+	explicit SceneChunkReader(const char *pFilePath) : SceneChunkReader(MappedFile(pFilePath)) {}
+	explicit SceneChunkReader(MappedFile file);
+	SceneChunkReader(const SceneChunkReader&) = delete;
+	SceneChunkReader& operator=(const SceneChunkReader&) = delete;
+	~SceneChunkReader() = default;
+
+	bool IsValid() const { return m_valid; }
+	const std::vector<SceneChunkEntry> &GetEntries() const { return m_entries; }
+	const SceneChunkEntry *FindEntry(SceneChunkType type, uint32_t objectID) const;
+
+	// Only reads scene name, AABB, axis system and unit. pSceneDatabase is left as is on failure.
+	bool ReadSceneInfo(cd::SceneDatabase *pSceneDatabase) const;
+
+	template<typename T>
+	std::optional<T> ReadObject(uint32_t objectID) const {
+		const SceneChunkEntry *pEntry = FindEntry(SceneChunkTypeOf<T>::Value, objectID);
+		if(!pEntry) {
+			if constexpr (std::is_same_v<T, cd::Mesh>) {
+				if(std::optional<QuantizedMesh> quantizedMesh = ReadQuantizedMesh(objectID)) {
+					return quantizedMesh->ToMesh();
+				}
+			}
+			return std::nullopt;
+		}
+		return ReadObject<T>(*pEntry);
+	}
+
+	template<typename T>
+	std::optional<T> ReadObject(const SceneChunkEntry &entry) const {
+		std::vector<char> decompressedData;
+		const char *pData = GetChunkData(entry, decompressedData);
+		if(!pData) {
+			return std::nullopt;
+		}
+
+		// Objects which read past the end of their chunk are truncated or corrupt.
+		MemoryInputStream stream(pData, static_cast<std::size_t>(entry.m_size));
+		std::optional<T> object;
+		if(m_swapBytes) {
+			cd::InputArchiveSwapBytes inputArchive(&stream);
+			object.emplace(inputArchive);
+		}
+		else {
+			cd::InputArchive inputArchive(&stream);
+			object.emplace(inputArchive);
+		}
+		if(stream.fail()) {
+			return std::nullopt;
+		}
+		return object;
+	}
+
+	// Reads a QuantizedMesh chunk without decoding it. Every stream and index is checked against the vertex count.
+	std::optional<QuantizedMesh> ReadQuantizedMesh(uint32_t meshID) const;
+	std::optional<QuantizedMesh> ReadQuantizedMesh(const SceneChunkEntry &entry) const;
+
+	// Reads every chunk into pSceneDatabase.
+	// Chunks are independent so they are deserialized on threadCount workers, 0 means one per hardware thread,
+	// each with its own archive over the shared mapping. Objects are then added in deterministic (type, ID) order.
+	// Returns false without touching pSceneDatabase if any chunk fails to decode, has an unknown type,
+	// or the IDs of a type don't run from 0 without gaps, since SceneDatabase looks objects up by ID.
+	// onQuantizedMesh, when set, sees every quantized mesh on its worker before it is decoded to cd::Mesh, so that
+	// consumers can decode the compact streams into their own vertex layout. It may be called for a file which then fails.
+	bool ReadAll(cd::SceneDatabase *pSceneDatabase, std::size_t threadCount = 0,
+		const std::function<void(const QuantizedMesh &)> &onQuantizedMesh = nullptr) const;
+
+private:
+	// Points into the mapping for stored chunks, or decompresses into decompressedData. nullptr if the block is corrupt.
+	const char *GetChunkData(const SceneChunkEntry &entry, std::vector<char> &decompressedData) const;
+
+private:
+	MappedFile m_file;
+	std::vector<SceneChunkEntry> m_entries;
+	std::unordered_map<uint64_t, uint32_t> m_entryIndices;
+	bool m_swapBytes = false;
+	bool m_valid = false;
+};
@@ -0,0 +1,295 @@
+#include "Sha256.h"
+
+#include "CpuFeatures.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+alignas(16) constexpr uint32_t RoundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr std::array<uint32_t, 8> InitialState = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+uint32_t RotateRight(uint32_t value, int count) {
+	return (value >> count) | (value << (32 - count));
+}
+
+uint32_t LoadBigEndian32(const uint8_t *p) {
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void CompressBlocksScalar(uint32_t *pState, const uint8_t *pData, std::size_t blockCount) {
+	for(std::size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex, pData += Sha256::BlockSize) {
+		uint32_t w[64];
+		for(int i = 0; i < 16; ++i) {
+			w[i] = LoadBigEndian32(pData + i * 4);
+		}
+		for(int i = 16; i < 64; ++i) {
+			const uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			const uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = pState[0], b = pState[1], c = pState[2], d = pState[3];
+		uint32_t e = pState[4], f = pState[5], g = pState[6], h = pState[7];
+		for(int i = 0; i < 64; ++i) {
+			const uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+			const uint32_t choice = (e & f) ^ (~e & g);
+			const uint32_t temp1 = h + s1 + choice + RoundConstants[i] + w[i];
+			const uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+			const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+			const uint32_t temp2 = s0 + majority;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + temp1;
+			d = c;
+			c = b;
+			b = a;
+			a = temp1 + temp2;
+		}
+
+		pState[0] += a; pState[1] += b; pState[2] += c; pState[3] += d;
+		pState[4] += e; pState[5] += f; pState[6] += g; pState[7] += h;
+	}
+}
+
+#if CD_ARCH_X86
+
+// Four rounds per step with sha256rnds2, the message schedule for the next steps is computed alongside with sha256msg1/2.
+CD_TARGET("sha,sse4.1,ssse3") void CompressBlocksSHA(uint32_t *pState, const uint8_t *pData, std::size_t blockCount) {
+	const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	// sha256rnds2 wants the state as ABEF and CDGH.
+	__m128i temp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pState)), 0xB1);
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pState + 4)), 0x1B);
+	__m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+	state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+	for(std::size_t blockIndex = 0; blockIndex < blockCount; ++blockIndex, pData += Sha256::BlockSize) {
+		const __m128i savedState0 = state0;
+		const __m128i savedState1 = state1;
+
+		__m128i messages[4];
+		for(int step = 0; step < 16; ++step) {
+			__m128i &current = messages[step % 4];
+			if(step < 4) {
+				current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pData + step * 16)), byteSwapMask);
+			}
+
+			__m128i message = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i *>(RoundConstants + step * 4)));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+
+			if(step >= 3 && step < 15) {
+				__m128i &next = messages[(step + 1) % 4];
+				next = _mm_add_epi32(next, _mm_alignr_epi8(current, messages[(step + 3) % 4], 4));
+				next = _mm_sha256msg2_epu32(next, current);
+			}
+
+			message = _mm_shuffle_epi32(message, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, message);
+
+			if(step >= 1 && step < 13) {
+				__m128i &previous = messages[(step + 3) % 4];
+				previous = _mm_sha256msg1_epu32(previous, current);
+			}
+		}
+
+		state0 = _mm_add_epi32(state0, savedState0);
+		state1 = _mm_add_epi32(state1, savedState1);
+	}
+
+	temp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	state0 = _mm_blend_epi16(temp, state1, 0xF0);
+	state1 = _mm_alignr_epi8(state1, temp, 8);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(pState), state0);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(pState + 4), state1);
+}
+
+#endif
+
+using CompressBlocksFunction = void (*)(uint32_t *, const uint8_t *, std::size_t);
+
+CompressBlocksFunction SelectCompressBlocks() {
+#if CD_ARCH_X86
+	const CpuFeatures &features = CpuFeatures::Get();
+	if(features.m_sha && features.m_sse41 && features.m_ssse3) {
+		return CompressBlocksSHA;
+	}
+#endif
+	return CompressBlocksScalar;
+}
+
+CompressBlocksFunction GetCompressBlocks() {
+	static const CompressBlocksFunction function = SelectCompressBlocks();
+	return function;
+}
+
+void StoreLittleEndian64(uint8_t *p, uint64_t value) {
+	for(int i = 0; i < 8; ++i) {
+		p[i] = static_cast<uint8_t>(value >> (i * 8));
+	}
+}
+
+}
+
+Sha256::Digest Sha256::Hash(const void *pData, std::size_t size) {
+	Sha256 sha;
+	sha.Update(pData, size);
+	return sha.Finalize();
+}
+
+std::string Sha256::ToHexString(const Digest &digest) {
+	static constexpr char HexDigits[] = "0123456789abcdef";
+	std::string result(DigestSize * 2, '0');
+	for(std::size_t i = 0; i < DigestSize; ++i) {
+		result[i * 2] = HexDigits[digest[i] >> 4];
+		result[i * 2 + 1] = HexDigits[digest[i] & 0xF];
+	}
+	return result;
+}
+
+bool Sha256::IsAccelerated() {
+	return GetCompressBlocks() != CompressBlocksScalar;
+}
+
+Sha256::Sha256(bool useAcceleration) :
+	m_pCompressBlocks(useAcceleration ? GetCompressBlocks() : CompressBlocksScalar) {
+	Reset();
+}
+
+void Sha256::Reset() {
+	m_state = InitialState;
+	m_bufferSize = 0;
+	m_totalBytes = 0;
+}
+
+void Sha256::Update(const void *pData, std::size_t size) {
+	// pData may be null then, which memcpy must not get even for zero bytes.
+	if(0 == size) {
+		return;
+	}
+
+	const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+	m_totalBytes += size;
+
+	if(m_bufferSize > 0) {
+		const std::size_t copySize = std::min(size, BlockSize - m_bufferSize);
+		std::memcpy(m_buffer.data() + m_bufferSize, pBytes, copySize);
+		m_bufferSize += copySize;
+		pBytes += copySize;
+		size -= copySize;
+		if(m_bufferSize < BlockSize) {
+			return;
+		}
+		m_pCompressBlocks(m_state.data(), m_buffer.data(), 1);
+		m_bufferSize = 0;
+	}
+
+	// Whole blocks are hashed straight from the caller's memory.
+	const std::size_t blockCount = size / BlockSize;
+	if(blockCount > 0) {
+		m_pCompressBlocks(m_state.data(), pBytes, blockCount);
+		pBytes += blockCount * BlockSize;
+		size -= blockCount * BlockSize;
+	}
+
+	if(size > 0) {
+		std::memcpy(m_buffer.data(), pBytes, size);
+	}
+	m_bufferSize = size;
+}
+
+Sha256::Digest Sha256::Finalize() {
+	const uint64_t totalBits = m_totalBytes * 8;
+
+	// 0x80 terminator, zero padding, then the message length in bits as big endian uint64.
+	uint8_t padding[BlockSize * 2] = { 0x80 };
+	const std::size_t paddingSize = (m_bufferSize < BlockSize - 8 ? BlockSize : BlockSize * 2) - m_bufferSize;
+	for(int i = 0; i < 8; ++i) {
+		padding[paddingSize - 1 - i] = static_cast<uint8_t>(totalBits >> (i * 8));
+	}
+	Update(padding, paddingSize);
+
+	Digest digest;
+	for(std::size_t i = 0; i < 8; ++i) {
+		digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+		digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+		digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+		digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+	}
+
+	Reset();
+	return digest;
+}
+
+std::string Sha256File(const char *pFilePath) {
+	MappedFile file(pFilePath);
+	if(!file.IsValid()) {
+		// Empty files can't be mapped but still have a hash.
+		std::error_code error;
+		const bool isEmptyFile = std::filesystem::is_regular_file(pFilePath, error) && 0 == std::filesystem::file_size(pFilePath, error);
+		return isEmptyFile ? Sha256::ToHexString(Sha256::Hash(nullptr, 0)) : std::string();
+	}
+
+	return Sha256::ToHexString(Sha256::Hash(file.GetData(), file.GetSize()));
+}
+
+std::string Sha256FileTree(const char *pFilePath, std::size_t leafSize, std::size_t threadCount) {
+	if(0 == leafSize) {
+		return std::string();
+	}
+
+	MappedFile file(pFilePath);
+	const char *pData = nullptr;
+	std::size_t fileSize = 0;
+	if(file.IsValid()) {
+		pData = file.GetData();
+		fileSize = file.GetSize();
+	}
+	else {
+		std::error_code error;
+		if(!std::filesystem::is_regular_file(pFilePath, error) || std::filesystem::file_size(pFilePath, error) != 0) {
+			return std::string();
+		}
+	}
+
+	const std::size_t leafCount = (fileSize + leafSize - 1) / leafSize;
+	std::vector<Sha256::Digest> leafDigests(leafCount);
+	ParallelFor(leafCount, [pData, fileSize, leafSize, &leafDigests](std::size_t leafIndex) {
+		const std::size_t offset = leafIndex * leafSize;
+		leafDigests[leafIndex] = Sha256::Hash(pData + offset, std::min(leafSize, fileSize - offset));
+	}, threadCount);
+
+	uint8_t sizes[16];
+	StoreLittleEndian64(sizes, fileSize);
+	StoreLittleEndian64(sizes + 8, leafSize);
+
+	Sha256 root;
+	root.Update(sizes, sizeof(sizes));
+	root.Update(leafDigests.data(), leafDigests.size() * Sha256::DigestSize);
+	return Sha256::ToHexString(root.Finalize());
+}
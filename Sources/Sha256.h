@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental SHA-256.
+// Blocks are compressed with the SHA-NI instructions when the CPU has them, otherwise with a portable implementation.
+class Sha256
+{
+public:
+	static constexpr std::size_t BlockSize = 64;
+	static constexpr std::size_t DigestSize = 32;
+	using Digest = std::array<uint8_t, DigestSize>;
+
+	static Digest Hash(const void *pData, std::size_t size);
+	static std::string ToHexString(const Digest &digest);
+
+	// Whether the SHA-NI kernel is in use, for logging.
+	static bool IsAccelerated();
+
+public:
+	// useAcceleration false keeps the portable implementation on CPUs with SHA-NI, to compare the two.
+	explicit Sha256(bool useAcceleration = true);
+	Sha256(const Sha256&) = default;
+	Sha256& operator=(const Sha256&) = default;
+	~Sha256() = default;
+
+	void Reset();
+	void Update(const void *pData, std::size_t size);
+	Digest Finalize();
+
+private:
+	std::array<uint32_t, 8> m_state;
+	std::array<uint8_t, BlockSize> m_buffer;
+	std::size_t m_bufferSize;
+	uint64_t m_totalBytes;
+	void (*m_pCompressBlocks)(uint32_t *pState, const uint8_t *pData, std::size_t blockCount);
+};
+
+// Hex digest of a whole file read through a memory mapping, the same value sha256sum prints. Empty string if the file can't be read.
+// cd::FileHash streams the file through picosha2 byte by byte and then hashes the digest a second time, so its values differ.
+std::string Sha256File(const char *pFilePath);
+
+// Hex digest of a file hashed as a tree so that large files are hashed on threadCount threads, 0 means one per hardware thread.
+// The file is split into leafSize byte leaves which are hashed independently, the root is the SHA-256 of
+// file size and leaf size as little endian uint64 followed by the leaf digests.
+// It is not the same value as Sha256File, only compare tree hashes made with the same leaf size.
+constexpr std::size_t DefaultTreeHashLeafSize = 4 * 1024 * 1024;
+std::string Sha256FileTree(const char *pFilePath, std::size_t leafSize = DefaultTreeHashLeafSize, std::size_t threadCount = 0);
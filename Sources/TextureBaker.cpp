@@ -0,0 +1,86 @@
+#include "TextureBaker.h"
+
+#include "BlockCompression.h"
+#include "TextureDecoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+bool HasAlpha(const uint8_t *pPixels, std::size_t pixelCount) {
+	for(std::size_t pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex) {
+		if(pPixels[pixelIndex * 4 + 3] != 255) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+cd::TextureFormat ChooseBlockFormat(cd::MaterialTextureType textureType, bool hasAlpha, const TextureBakeOptions &options) {
+	if(cd::MaterialTextureType::Normal == textureType) {
+		return cd::TextureFormat::BC5;
+	}
+	if(options.m_useBC7) {
+		return cd::TextureFormat::BC7;
+	}
+	return hasAlpha ? cd::TextureFormat::BC3 : cd::TextureFormat::BC1;
+}
+
+uint32_t GetMipCount(uint32_t width, uint32_t height) {
+	uint32_t mipCount = 1;
+	for(uint32_t size = std::max(width, height); size > 1; size /= 2) {
+		++mipCount;
+	}
+	return mipCount;
+}
+
+std::size_t GetMipChainSize(cd::TextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount) {
+	std::size_t size = 0;
+	for(uint32_t mip = 0; mip < mipCount; ++mip) {
+		size += GetBlockCompressedSize(format, std::max(width >> mip, 1u), std::max(height >> mip, 1u));
+	}
+	return size;
+}
+
+bool BakeTexture(cd::Texture &texture, const char *pFilePath, const TextureBakeOptions &options) {
+	// An image file embedded in the scene replaces the one on disk.
+	DecodedImage image;
+	const std::vector<std::byte> &rawData = texture.GetRawData();
+	const bool loaded = DecodedImage::IsEncodedImage(rawData.data(), rawData.size()) ?
+		image.LoadFromMemory(rawData.data(), rawData.size(), 4) : image.LoadFromFile(pFilePath, 4);
+	if(!loaded) {
+		printf("Failed to bake texture %s\n", pFilePath);
+		return false;
+	}
+
+	const uint32_t width = image.GetWidth();
+	const uint32_t height = image.GetHeight();
+	const uint32_t mipCount = GetMipCount(width, height);
+	const cd::TextureFormat format = ChooseBlockFormat(texture.GetType(), HasAlpha(image.GetPixels(), static_cast<std::size_t>(width) * height), options);
+
+	const std::vector<MipLevel> mips = GenerateMips(image.GetPixels(), width, height, GetMipContent(texture.GetType()), options.m_mipFilter,
+		options.m_threadCount);
+
+	std::vector<std::byte> blocks(GetMipChainSize(format, width, height, mipCount));
+	std::size_t offset = 0;
+	for(uint32_t mip = 0; mip < mipCount; ++mip) {
+		const uint8_t *pLevelPixels = 0 == mip ? image.GetPixels() : mips[mip - 1].m_pixels.data();
+		const uint32_t levelWidth = std::max(width >> mip, 1u);
+		const uint32_t levelHeight = std::max(height >> mip, 1u);
+		CompressBlocks(format, pLevelPixels, levelWidth, levelHeight, reinterpret_cast<uint8_t *>(blocks.data() + offset), options.m_threadCount);
+		offset += GetBlockCompressedSize(format, levelWidth, levelHeight);
+	}
+
+	texture.SetFormat(format);
+	texture.SetWidth(width);
+	texture.SetHeight(height);
+	texture.SetDepth(1);
+	texture.SetUseMipMap(true);
+	texture.SetRawData(std::move(blocks));
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include "Scene/Texture.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct TextureBakeOptions
+{
+	// BC7 replaces BC1 and BC3, sampling it needs GL 4.2 or ARB_texture_compression_bptc.
+	bool m_useBC7 = false;
+	MipFilter m_mipFilter = MipFilter::Kaiser;
+	// 0 means GetDefaultThreadCount().
+	std::size_t m_threadCount = 0;
+};
+
+// BC5 for normal maps, whose z the shader rebuilds from x and y, BC3 for colors with alpha and BC1 for the rest.
+cd::TextureFormat ChooseBlockFormat(cd::MaterialTextureType textureType, bool hasAlpha, const TextureBakeOptions &options);
+
+// Levels from width x height down to 1x1, each half the size of the previous one rounded down.
+uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+// Bytes of the first mipCount levels of a block compressed texture.
+std::size_t GetMipChainSize(cd::TextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount);
+
+// Decodes the image file, or its bytes when the scene embeds them as the texture's raw data, builds its mip chain
+// and stores it block compressed as the texture's raw data, levels back to back from the largest one. The texture's format, size and mip map use are set to match.
+// Mips are filtered as the texture type's MipContent, see GenerateMips.
+// Returns false and leaves the texture unchanged if the file can't be decoded.
+bool BakeTexture(cd::Texture &texture, const char *pFilePath, const TextureBakeOptions &options = TextureBakeOptions());
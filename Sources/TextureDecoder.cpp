@@ -0,0 +1,145 @@
+#include "TextureDecoder.h"
+
+#include "ThreadPool.h"
+
+#include <stb_image.h>
+
+#include <climits>
+#include <utility>
+
+DecodedImage::DecodedImage(DecodedImage &&other) noexcept :
+	m_pPixels(std::exchange(other.m_pPixels, nullptr)),
+	m_width(std::exchange(other.m_width, 0)),
+	m_height(std::exchange(other.m_height, 0)),
+	m_componentCount(std::exchange(other.m_componentCount, 0)) {
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage &&other) noexcept {
+	if(this != &other) {
+		Reset();
+		m_pPixels = std::exchange(other.m_pPixels, nullptr);
+		m_width = std::exchange(other.m_width, 0);
+		m_height = std::exchange(other.m_height, 0);
+		m_componentCount = std::exchange(other.m_componentCount, 0);
+	}
+	return *this;
+}
+
+DecodedImage::~DecodedImage() {
+	Reset();
+}
+
+bool DecodedImage::LoadFromFile(const char *pFilePath, uint32_t componentCount) {
+	Reset();
+
+	int width, height, fileComponentCount;
+	m_pPixels = stbi_load(pFilePath, &width, &height, &fileComponentCount, static_cast<int>(componentCount));
+	if(!m_pPixels) {
+		return false;
+	}
+
+	m_width = static_cast<uint32_t>(width);
+	m_height = static_cast<uint32_t>(height);
+	m_componentCount = componentCount != 0 ? componentCount : static_cast<uint32_t>(fileComponentCount);
+	return true;
+}
+
+bool DecodedImage::LoadFromMemory(const std::byte *pData, std::size_t byteCount, uint32_t componentCount) {
+	Reset();
+	if(byteCount > static_cast<std::size_t>(INT_MAX)) {
+		return false;
+	}
+
+	int width, height, fileComponentCount;
+	m_pPixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(pData), static_cast<int>(byteCount), &width, &height,
+		&fileComponentCount, static_cast<int>(componentCount));
+	if(!m_pPixels) {
+		return false;
+	}
+
+	m_width = static_cast<uint32_t>(width);
+	m_height = static_cast<uint32_t>(height);
+	m_componentCount = componentCount != 0 ? componentCount : static_cast<uint32_t>(fileComponentCount);
+	return true;
+}
+
+void DecodedImage::Reset() {
+	stbi_image_free(m_pPixels);
+	m_pPixels = nullptr;
+	m_width = 0;
+	m_height = 0;
+	m_componentCount = 0;
+}
+
+bool DecodedImage::IsEncodedImage(const std::byte *pData, std::size_t byteCount) {
+	int width, height, componentCount;
+	return byteCount > 0 && byteCount <= static_cast<std::size_t>(INT_MAX) &&
+		stbi_info_from_memory(reinterpret_cast<const stbi_uc *>(pData), static_cast<int>(byteCount), &width, &height, &componentCount) != 0;
+}
+
+TextureDecodeQueue::~TextureDecodeQueue() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finishedCondition.wait(lock, [this]() { return 0 == m_runningCount; });
+}
+
+uint32_t TextureDecodeQueue::Request(std::string filePath) {
+	return Submit(std::move(filePath), {});
+}
+
+uint32_t TextureDecodeQueue::Request(std::string name, std::vector<std::byte> encodedData) {
+	return Submit(std::move(name), std::move(encodedData));
+}
+
+uint32_t TextureDecodeQueue::Submit(std::string filePath, std::vector<std::byte> encodedData) {
+	const uint32_t ticket = m_nextTicket++;
+	++m_pendingCount;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_runningCount;
+	}
+
+	m_threadPool.Submit([this, ticket, filePath = std::move(filePath), encodedData = std::move(encodedData)]() mutable {
+		DecodedTexture texture;
+		texture.m_ticket = ticket;
+		if(encodedData.empty()) {
+			texture.m_image.LoadFromFile(filePath.c_str());
+		}
+		else {
+			texture.m_image.LoadFromMemory(encodedData.data(), encodedData.size());
+		}
+		texture.m_filePath = std::move(filePath);
+
+		// Notified under the lock, the destructor may destroy the queue as soon as it sees no running decode.
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finished.push_back(std::move(texture));
+		--m_runningCount;
+		m_finishedCondition.notify_all();
+	});
+
+	return ticket;
+}
+
+bool TextureDecodeQueue::TryPop(DecodedTexture &texture) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_finished.empty()) {
+		return false;
+	}
+
+	texture = std::move(m_finished.front());
+	m_finished.pop_front();
+	--m_pendingCount;
+	return true;
+}
+
+bool TextureDecodeQueue::WaitPop(DecodedTexture &texture) {
+	if(0 == m_pendingCount) {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finishedCondition.wait(lock, [this]() { return !m_finished.empty(); });
+	texture = std::move(m_finished.front());
+	m_finished.pop_front();
+	--m_pendingCount;
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// 8 bit pixels decoded by stb_image with the file's component count, rows from the top of the image.
+class DecodedImage
+{
+public:
+	DecodedImage() = default;
+	DecodedImage(const DecodedImage&) = delete;
+	DecodedImage& operator=(const DecodedImage&) = delete;
+	DecodedImage(DecodedImage &&other) noexcept;
+	DecodedImage& operator=(DecodedImage &&other) noexcept;
+	~DecodedImage();
+
+	// Returns false and stays empty when the file can't be read or decoded.
+	// A componentCount other than 0 converts the pixels to that many components.
+	bool LoadFromFile(const char *pFilePath, uint32_t componentCount = 0);
+	// Same for the bytes of an image file which is already in memory, such as a texture embedded in a scene.
+	bool LoadFromMemory(const std::byte *pData, std::size_t byteCount, uint32_t componentCount = 0);
+	void Reset();
+
+	// Whether stb_image recognizes the bytes as an image file it can decode, only reads the header.
+	static bool IsEncodedImage(const std::byte *pData, std::size_t byteCount);
+
+	bool IsValid() const { return m_pPixels != nullptr; }
+	const uint8_t *GetPixels() const { return m_pPixels; }
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+	uint32_t GetComponentCount() const { return m_componentCount; }
+	std::size_t GetByteCount() const { return static_cast<std::size_t>(m_width) * m_height * m_componentCount; }
+
+private:
+	uint8_t *m_pPixels = nullptr;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_componentCount = 0;
+};
+
+struct DecodedTexture
+{
+	uint32_t m_ticket = 0;
+	// Or the name of an embedded image, for messages.
+	std::string m_filePath;
+	DecodedImage m_image;
+};
+
+// Decodes image files on a ThreadPool as soon as they are requested. Results are taken on the requesting thread
+// in the order they finish, so a GL thread can upload each image while the others are still decoding.
+class TextureDecodeQueue
+{
+public:
+	explicit TextureDecodeQueue(ThreadPool &threadPool) : m_threadPool(threadPool) {}
+	TextureDecodeQueue(const TextureDecodeQueue&) = delete;
+	TextureDecodeQueue& operator=(const TextureDecodeQueue&) = delete;
+	TextureDecodeQueue(TextureDecodeQueue&&) = delete;
+	TextureDecodeQueue& operator=(TextureDecodeQueue&&) = delete;
+	// Waits for the decodes still running, which write into this queue.
+	~TextureDecodeQueue();
+
+	// Tickets count up from 0 in request order.
+	uint32_t Request(std::string filePath);
+
+	// Decodes image file bytes instead of reading a file, name only ends up in DecodedTexture::m_filePath.
+	uint32_t Request(std::string name, std::vector<std::byte> encodedData);
+
+	// Requested decodes whose results haven't been taken yet.
+	uint32_t GetPendingCount() const { return m_pendingCount; }
+
+	// Moves out one finished decode, returns false when none has finished yet.
+	bool TryPop(DecodedTexture &texture);
+
+	// Blocks until a decode has finished, returns false when nothing is pending.
+	bool WaitPop(DecodedTexture &texture);
+
+private:
+	// Reads the file when encodedData is empty.
+	uint32_t Submit(std::string filePath, std::vector<std::byte> encodedData);
+
+	ThreadPool &m_threadPool;
+	std::mutex m_mutex;
+	std::condition_variable m_finishedCondition;
+	std::deque<DecodedTexture> m_finished;
+	uint32_t m_runningCount = 0;
+
+	// Only used by the requesting thread.
+	uint32_t m_nextTicket = 0;
+	uint32_t m_pendingCount = 0;
+};
@@ -0,0 +1,239 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+GLenum GetPixelFormat(uint32_t componentCount) {
+	switch(componentCount) {
+	case 1:
+		return GL_RED;
+	case 2:
+		return GL_RG;
+	case 3:
+		return GL_RGB;
+	default:
+		return GL_RGBA;
+	}
+}
+
+}
+
+void TextureStreamStats::Print() const {
+	printf("Texture streaming : %u / %u textures, %.1f MiB in %u frames, at most %.1f MiB per frame\n",
+		m_completedTextures, m_requestedTextures, m_uploadedBytes / (1024.0 * 1024.0), m_uploadFrames, m_maxFrameBytes / (1024.0 * 1024.0));
+}
+
+TextureStreamer::TextureStreamer(ThreadPool &threadPool, std::size_t frameByteBudget, std::size_t slotSize) :
+	m_frameByteBudget(frameByteBudget),
+	m_slotSize(slotSize),
+	m_threadPool(threadPool),
+	m_decodeQueue(m_threadPool) {
+	for(Slot &slot : m_slots) {
+		glGenBuffers(1, &slot.m_bufferID);
+	}
+}
+
+TextureStreamer::~TextureStreamer() {
+	// Workers may still be copying into mapped buffers.
+	m_threadPool.Wait();
+
+	for(Slot &slot : m_slots) {
+		if(slot.m_pMapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_bufferID);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		if(slot.m_fence) {
+			glDeleteSync(slot.m_fence);
+		}
+		glDeleteBuffers(1, &slot.m_bufferID);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+GLuint TextureStreamer::Request(std::string filePath) {
+	return AddRequest(m_decodeQueue.Request(std::move(filePath)));
+}
+
+GLuint TextureStreamer::Request(std::string name, std::vector<std::byte> encodedData) {
+	return AddRequest(m_decodeQueue.Request(std::move(name), std::move(encodedData)));
+}
+
+GLuint TextureStreamer::AddRequest(uint32_t ticket) {
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+
+	m_requestedTextureIDs.resize(std::max<std::size_t>(m_requestedTextureIDs.size(), ticket + 1));
+	m_requestedTextureIDs[ticket] = textureID;
+	++m_stats.m_requestedTextures;
+
+	return textureID;
+}
+
+void TextureStreamer::Update() {
+	if(!IsStreaming()) {
+		return;
+	}
+
+	RetireUploads();
+	SubmitFilledSlots();
+	AcceptDecodedTextures();
+	StartCopies();
+}
+
+void TextureStreamer::RetireUploads() {
+	for(Slot &slot : m_slots) {
+		if(!slot.m_fence) {
+			continue;
+		}
+
+		// Polls without waiting, the flush makes sure that the fence reaches the GPU at all.
+		const GLenum result = glClientWaitSync(slot.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if(GL_ALREADY_SIGNALED == result || GL_CONDITION_SATISFIED == result) {
+			glDeleteSync(slot.m_fence);
+			slot.m_fence = nullptr;
+		}
+	}
+}
+
+void TextureStreamer::SubmitFilledSlots() {
+	// Rows of odd widths aren't padded to 4 bytes in the decoded images.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for(Slot &slot : m_slots) {
+		if(!slot.m_pTexture || !slot.m_filled.load(std::memory_order_acquire)) {
+			continue;
+		}
+
+		StreamingTexture &texture = *slot.m_pTexture;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_bufferID);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		slot.m_pMapped = nullptr;
+
+		glBindTexture(GL_TEXTURE_2D, texture.m_textureID);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(slot.m_firstRow), static_cast<GLsizei>(texture.m_image.GetWidth()),
+			static_cast<GLsizei>(slot.m_rowCount), texture.m_format, GL_UNSIGNED_BYTE, nullptr);
+		slot.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		slot.m_pTexture = nullptr;
+		slot.m_filled.store(false, std::memory_order_relaxed);
+		texture.m_uploadedRows += slot.m_rowCount;
+		if(texture.m_uploadedRows == texture.m_image.GetHeight()) {
+			CompleteTexture(texture);
+		}
+	}
+
+	// Client memory uploads elsewhere expect the default state.
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	m_streamingTextures.erase(std::remove_if(m_streamingTextures.begin(), m_streamingTextures.end(),
+		[](const std::unique_ptr<StreamingTexture> &pTexture) { return !pTexture->m_image.IsValid(); }), m_streamingTextures.end());
+}
+
+void TextureStreamer::AcceptDecodedTextures() {
+	DecodedTexture decoded;
+	while(m_decodeQueue.TryPop(decoded)) {
+		const GLuint textureID = m_requestedTextureIDs[decoded.m_ticket];
+		if(!decoded.m_image.IsValid()) {
+			printf("\n\t\t\t\tTexture failed to load at path: %s\n\n", decoded.m_filePath.c_str());
+			++m_stats.m_completedTextures;
+			continue;
+		}
+
+		auto pTexture = std::make_unique<StreamingTexture>();
+		pTexture->m_textureID = textureID;
+		pTexture->m_format = GetPixelFormat(decoded.m_image.GetComponentCount());
+		pTexture->m_image = std::move(decoded.m_image);
+
+		// Level 0 storage only, sampled without mips while the rows arrive.
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, pTexture->m_format, static_cast<GLsizei>(pTexture->m_image.GetWidth()),
+			static_cast<GLsizei>(pTexture->m_image.GetHeight()), 0, pTexture->m_format, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		m_streamingTextures.push_back(std::move(pTexture));
+	}
+}
+
+void TextureStreamer::StartCopies() {
+	std::size_t frameBytes = 0;
+	auto itTexture = m_streamingTextures.begin();
+	for(Slot &slot : m_slots) {
+		if(slot.m_fence || slot.m_pTexture) {
+			continue;
+		}
+
+		while(itTexture != m_streamingTextures.end() && (*itTexture)->m_copiedRows == (*itTexture)->m_image.GetHeight()) {
+			++itTexture;
+		}
+		if(itTexture == m_streamingTextures.end()) {
+			break;
+		}
+
+		// A band is as many rows as fit in the slot and the rest of the budget, but at least one row per frame.
+		StreamingTexture &texture = **itTexture;
+		const std::size_t rowBytes = static_cast<std::size_t>(texture.m_image.GetWidth()) * texture.m_image.GetComponentCount();
+		const std::size_t remainingBudget = m_frameByteBudget > frameBytes ? m_frameByteBudget - frameBytes : 0;
+		std::size_t rowCount = std::min(std::min(m_slotSize, remainingBudget) / rowBytes,
+			static_cast<std::size_t>(texture.m_image.GetHeight() - texture.m_copiedRows));
+		if(0 == rowCount) {
+			if(frameBytes > 0) {
+				break;
+			}
+			rowCount = 1;
+		}
+
+		const std::size_t bandBytes = rowCount * rowBytes;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_bufferID);
+		if(slot.m_capacity < bandBytes) {
+			slot.m_capacity = std::max(m_slotSize, bandBytes);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(slot.m_capacity), nullptr, GL_STREAM_DRAW);
+		}
+
+		// The fence has signaled, so the previous upload from this buffer is done and the driver needn't check.
+		slot.m_pMapped = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bandBytes),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if(!slot.m_pMapped) {
+			printf("Failed to map texture upload buffer.\n");
+			break;
+		}
+
+		slot.m_pTexture = &texture;
+		slot.m_firstRow = texture.m_copiedRows;
+		slot.m_rowCount = static_cast<uint32_t>(rowCount);
+		texture.m_copiedRows += slot.m_rowCount;
+		frameBytes += bandBytes;
+
+		const uint8_t *pSource = texture.m_image.GetPixels() + slot.m_firstRow * rowBytes;
+		m_threadPool.Submit([&slot, pSource, bandBytes]() {
+			std::memcpy(slot.m_pMapped, pSource, bandBytes);
+			slot.m_filled.store(true, std::memory_order_release);
+		});
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if(frameBytes > 0) {
+		m_stats.m_uploadedBytes += frameBytes;
+		m_stats.m_maxFrameBytes = std::max(m_stats.m_maxFrameBytes, frameBytes);
+		++m_stats.m_uploadFrames;
+	}
+}
+
+void TextureStreamer::CompleteTexture(StreamingTexture &texture) {
+	// Called with the texture bound.
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	// Releasing the pixels also marks the texture for removal.
+	texture.m_image.Reset();
+	++m_stats.m_completedTextures;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "TextureDecoder.h"
+#include "ThreadPool.h"
+
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct TextureStreamStats
+{
+	uint32_t m_requestedTextures = 0;
+	uint32_t m_completedTextures = 0;
+	uint64_t m_uploadedBytes = 0;
+	// Updates which started copying pixels, with the most bytes one of them copied.
+	uint32_t m_uploadFrames = 0;
+	std::size_t m_maxFrameBytes = 0;
+
+	void Print() const;
+};
+
+// Streams textures in while rendering. Files decode on a thread pool, then their rows go to the GPU through a ring
+// of pixel buffer objects: the GL thread maps a free buffer, a worker copies a band of rows into it and a later Update
+// unmaps it and issues glTexSubImage2D from it with a fence, which tells when the buffer can be reused.
+// Each Update starts copies of at most the frame byte budget, so big textures spread over several frames
+// instead of stalling one. Textures sample level 0 only until their last band lands and their mips are generated.
+class TextureStreamer
+{
+public:
+	static constexpr uint32_t SlotCount = 4;
+	static constexpr std::size_t DefaultSlotSize = 4 * 1024 * 1024;
+	static constexpr std::size_t DefaultFrameByteBudget = 8 * 1024 * 1024;
+
+public:
+	// Decodes and row copies run on threadPool, which has to outlive the streamer.
+	explicit TextureStreamer(ThreadPool &threadPool, std::size_t frameByteBudget = DefaultFrameByteBudget, std::size_t slotSize = DefaultSlotSize);
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	TextureStreamer(TextureStreamer&&) = delete;
+	TextureStreamer& operator=(TextureStreamer&&) = delete;
+	// Deletes the pixel buffers, but not the textures which belong to the meshes. Needs the GL context.
+	~TextureStreamer();
+
+	// Creates the texture object right away and starts decoding the file, the pixels arrive during later Updates.
+	GLuint Request(std::string filePath);
+
+	// Same for image file bytes which are already in memory, such as a texture embedded in the scene.
+	GLuint Request(std::string name, std::vector<std::byte> encodedData);
+
+	// Advances the uploads, call once per frame on the GL thread.
+	void Update();
+
+	// Whether any requested texture hasn't been completely uploaded yet.
+	bool IsStreaming() const { return m_stats.m_completedTextures < m_stats.m_requestedTextures; }
+
+	void SetFrameByteBudget(std::size_t frameByteBudget) { m_frameByteBudget = frameByteBudget; }
+	const TextureStreamStats &GetStats() const { return m_stats; }
+
+private:
+	struct StreamingTexture
+	{
+		GLuint m_textureID = 0;
+		GLenum m_format = GL_RGBA;
+		DecodedImage m_image;
+		// Rows handed to slots and rows whose upload has been issued.
+		uint32_t m_copiedRows = 0;
+		uint32_t m_uploadedRows = 0;
+	};
+
+	// Free without a texture, copying while mapped for a texture, in flight while fenced.
+	struct Slot
+	{
+		GLuint m_bufferID = 0;
+		std::size_t m_capacity = 0;
+		GLsync m_fence = nullptr;
+		uint8_t *m_pMapped = nullptr;
+		StreamingTexture *m_pTexture = nullptr;
+		uint32_t m_firstRow = 0;
+		uint32_t m_rowCount = 0;
+		// Set by the worker once the rows are in the buffer.
+		std::atomic<bool> m_filled = false;
+	};
+
+	// Texture object which the decode ticket's pixels go to.
+	GLuint AddRequest(uint32_t ticket);
+
+	void RetireUploads();
+	void SubmitFilledSlots();
+	void AcceptDecodedTextures();
+	void StartCopies();
+	void CompleteTexture(StreamingTexture &texture);
+
+	std::size_t m_frameByteBudget;
+	std::size_t m_slotSize;
+	std::array<Slot, SlotCount> m_slots;
+
+	// Texture object of each decode ticket.
+	std::vector<GLuint> m_requestedTextureIDs;
+	// Decoded textures whose rows are still being uploaded, in decode order.
+	std::vector<std::unique_ptr<StreamingTexture>> m_streamingTextures;
+	TextureStreamStats m_stats;
+
+	ThreadPool &m_threadPool;
+	TextureDecodeQueue m_decodeQueue;
+};
@@ -0,0 +1,118 @@
+#include "ThreadPool.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+
+// Shared with the workers, which may only get to their task after the caller finished every index.
+struct ParallelForBatch
+{
+	const std::function<void(std::size_t)> *m_pFunc;
+	std::size_t m_count;
+	std::atomic<std::size_t> m_nextIndex = 0;
+	std::size_t m_finishedCount = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_finished;
+
+	void Run() {
+		std::size_t runCount = 0;
+		for(std::size_t index = m_nextIndex++; index < m_count; index = m_nextIndex++) {
+			(*m_pFunc)(index);
+			++runCount;
+		}
+		if(0 == runCount) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finishedCount += runCount;
+		if(m_finishedCount == m_count) {
+			m_finished.notify_all();
+		}
+	}
+};
+
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+	if(0 == threadCount) {
+		threadCount = GetDefaultThreadCount();
+	}
+
+	m_threads.reserve(threadCount);
+	for(std::size_t threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		m_threads.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+
+	for(std::thread &thread : m_threads) {
+		thread.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)> &func) {
+	if(0 == count) {
+		return;
+	}
+
+	std::shared_ptr<ParallelForBatch> pBatch = std::make_shared<ParallelForBatch>();
+	pBatch->m_pFunc = &func;
+	pBatch->m_count = count;
+
+	const std::size_t helperCount = std::min(GetThreadCount(), count - 1);
+	for(std::size_t helperIndex = 0; helperIndex < helperCount; ++helperIndex) {
+		Submit([pBatch]() { pBatch->Run(); });
+	}
+	pBatch->Run();
+
+	std::unique_lock<std::mutex> lock(pBatch->m_mutex);
+	pBatch->m_finished.wait(lock, [&pBatch]() { return pBatch->m_finishedCount == pBatch->m_count; });
+}
+
+void ThreadPool::Wait() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_tasks.empty() && 0 == m_runningTaskCount; });
+}
+
+void ThreadPool::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for(;;) {
+		m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+		if(m_tasks.empty()) {
+			return;
+		}
+
+		std::function<void()> task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		++m_runningTaskCount;
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		--m_runningTaskCount;
+		if(m_tasks.empty() && 0 == m_runningTaskCount) {
+			m_idle.notify_all();
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long lived worker threads running submitted tasks in submission order.
+// Unlike ParallelFor the caller doesn't wait, which lets the calling thread keep working while tasks run.
+class ThreadPool
+{
+public:
+	// threadCount 0 means GetDefaultThreadCount().
+	explicit ThreadPool(std::size_t threadCount = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+	// Runs the tasks still queued before joining the threads.
+	~ThreadPool();
+
+	std::size_t GetThreadCount() const { return m_threads.size(); }
+
+	void Submit(std::function<void()> task);
+
+	// Calls func(index) for every index in [0, count) on the workers and the calling thread, like ::ParallelFor but
+	// without starting threads. Returns once these calls finished, other submitted tasks may still be queued or running.
+	void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &func);
+
+	// Blocks until the queue is empty and no task is running.
+	void Wait();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_idle;
+	std::size_t m_runningTaskCount = 0;
+	bool m_stopping = false;
+};
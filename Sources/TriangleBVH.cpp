@@ -0,0 +1,344 @@
+#include "TriangleBVH.h"
+
+#include "CpuFeatures.h"
+#include "FrustumCulling.h"
+
+#include "Scene/Mesh.h"
+
+#include <algorithm>
+
+#if CD_ARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+struct RayData
+{
+	float m_origin[3];
+	float m_direction[3];
+	float m_inverseDirection[3];
+};
+
+// Lane results of one packet test, only lanes set in the returned mask hit closer than the current closest distance.
+struct PacketHits
+{
+	alignas(32) float m_distances[TrianglePacket::Width];
+	alignas(32) float m_u[TrianglePacket::Width];
+	alignas(32) float m_v[TrianglePacket::Width];
+};
+
+using IntersectPacketFunc = uint32_t (*)(const TrianglePacket &packet, const RayData &ray, float closestDistance, PacketHits &hits);
+
+#if !CD_ARCH_X86
+
+// Moller-Trumbore without branches. Degenerate triangles and unused lanes divide by a zero determinant,
+// the resulting infinities and NaNs fail the ordered comparisons.
+uint32_t IntersectPacketScalar(const TrianglePacket &packet, const RayData &ray, float closestDistance, PacketHits &hits) {
+	uint32_t hitMask = 0;
+	for(uint32_t lane = 0; lane < TrianglePacket::Width; ++lane) {
+		const float px = ray.m_direction[1] * packet.m_edge2Z[lane] - ray.m_direction[2] * packet.m_edge2Y[lane];
+		const float py = ray.m_direction[2] * packet.m_edge2X[lane] - ray.m_direction[0] * packet.m_edge2Z[lane];
+		const float pz = ray.m_direction[0] * packet.m_edge2Y[lane] - ray.m_direction[1] * packet.m_edge2X[lane];
+		const float inverseDeterminant = 1.0f / (packet.m_edge1X[lane] * px + packet.m_edge1Y[lane] * py + packet.m_edge1Z[lane] * pz);
+
+		const float tx = ray.m_origin[0] - packet.m_vertexX[lane];
+		const float ty = ray.m_origin[1] - packet.m_vertexY[lane];
+		const float tz = ray.m_origin[2] - packet.m_vertexZ[lane];
+		const float u = (tx * px + ty * py + tz * pz) * inverseDeterminant;
+
+		const float qx = ty * packet.m_edge1Z[lane] - tz * packet.m_edge1Y[lane];
+		const float qy = tz * packet.m_edge1X[lane] - tx * packet.m_edge1Z[lane];
+		const float qz = tx * packet.m_edge1Y[lane] - ty * packet.m_edge1X[lane];
+		const float v = (ray.m_direction[0] * qx + ray.m_direction[1] * qy + ray.m_direction[2] * qz) * inverseDeterminant;
+		const float distance = (packet.m_edge2X[lane] * qx + packet.m_edge2Y[lane] * qy + packet.m_edge2Z[lane] * qz) * inverseDeterminant;
+
+		hits.m_distances[lane] = distance;
+		hits.m_u[lane] = u;
+		hits.m_v[lane] = v;
+		if(u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f && distance < closestDistance) {
+			hitMask |= 1u << lane;
+		}
+	}
+	return hitMask;
+}
+
+#else
+
+// Same as the scalar version 4 lanes at a time, twice per packet.
+uint32_t IntersectPacketSSE(const TrianglePacket &packet, const RayData &ray, float closestDistance, PacketHits &hits) {
+	const __m128 directionX = _mm_set1_ps(ray.m_direction[0]);
+	const __m128 directionY = _mm_set1_ps(ray.m_direction[1]);
+	const __m128 directionZ = _mm_set1_ps(ray.m_direction[2]);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 closest = _mm_set1_ps(closestDistance);
+
+	uint32_t hitMask = 0;
+	for(uint32_t offset = 0; offset < TrianglePacket::Width; offset += 4) {
+		const __m128 edge1X = _mm_load_ps(packet.m_edge1X + offset);
+		const __m128 edge1Y = _mm_load_ps(packet.m_edge1Y + offset);
+		const __m128 edge1Z = _mm_load_ps(packet.m_edge1Z + offset);
+		const __m128 edge2X = _mm_load_ps(packet.m_edge2X + offset);
+		const __m128 edge2Y = _mm_load_ps(packet.m_edge2Y + offset);
+		const __m128 edge2Z = _mm_load_ps(packet.m_edge2Z + offset);
+
+		const __m128 px = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+		const __m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+		const __m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+		const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, px), _mm_mul_ps(edge1Y, py)), _mm_mul_ps(edge1Z, pz));
+		const __m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+		const __m128 tx = _mm_sub_ps(_mm_set1_ps(ray.m_origin[0]), _mm_load_ps(packet.m_vertexX + offset));
+		const __m128 ty = _mm_sub_ps(_mm_set1_ps(ray.m_origin[1]), _mm_load_ps(packet.m_vertexY + offset));
+		const __m128 tz = _mm_sub_ps(_mm_set1_ps(ray.m_origin[2]), _mm_load_ps(packet.m_vertexZ + offset));
+		const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDeterminant);
+
+		const __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, edge1Z), _mm_mul_ps(tz, edge1Y));
+		const __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, edge1X), _mm_mul_ps(tx, edge1Z));
+		const __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, edge1Y), _mm_mul_ps(ty, edge1X));
+		const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)),
+			inverseDeterminant);
+		const __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qx), _mm_mul_ps(edge2Y, qy)), _mm_mul_ps(edge2Z, qz)),
+			inverseDeterminant);
+
+		__m128 mask = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+		mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(distance, zero), _mm_cmplt_ps(distance, closest)));
+
+		_mm_store_ps(hits.m_distances + offset, distance);
+		_mm_store_ps(hits.m_u + offset, u);
+		_mm_store_ps(hits.m_v + offset, v);
+		hitMask |= static_cast<uint32_t>(_mm_movemask_ps(mask)) << offset;
+	}
+	return hitMask;
+}
+
+CD_TARGET("avx2") uint32_t IntersectPacketAVX(const TrianglePacket &packet, const RayData &ray, float closestDistance, PacketHits &hits) {
+	const __m256 directionX = _mm256_set1_ps(ray.m_direction[0]);
+	const __m256 directionY = _mm256_set1_ps(ray.m_direction[1]);
+	const __m256 directionZ = _mm256_set1_ps(ray.m_direction[2]);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	const __m256 edge1X = _mm256_load_ps(packet.m_edge1X);
+	const __m256 edge1Y = _mm256_load_ps(packet.m_edge1Y);
+	const __m256 edge1Z = _mm256_load_ps(packet.m_edge1Z);
+	const __m256 edge2X = _mm256_load_ps(packet.m_edge2X);
+	const __m256 edge2Y = _mm256_load_ps(packet.m_edge2Y);
+	const __m256 edge2Z = _mm256_load_ps(packet.m_edge2Z);
+
+	const __m256 px = _mm256_sub_ps(_mm256_mul_ps(directionY, edge2Z), _mm256_mul_ps(directionZ, edge2Y));
+	const __m256 py = _mm256_sub_ps(_mm256_mul_ps(directionZ, edge2X), _mm256_mul_ps(directionX, edge2Z));
+	const __m256 pz = _mm256_sub_ps(_mm256_mul_ps(directionX, edge2Y), _mm256_mul_ps(directionY, edge2X));
+	const __m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge1X, px), _mm256_mul_ps(edge1Y, py)), _mm256_mul_ps(edge1Z, pz));
+	const __m256 inverseDeterminant = _mm256_div_ps(one, determinant);
+
+	const __m256 tx = _mm256_sub_ps(_mm256_set1_ps(ray.m_origin[0]), _mm256_load_ps(packet.m_vertexX));
+	const __m256 ty = _mm256_sub_ps(_mm256_set1_ps(ray.m_origin[1]), _mm256_load_ps(packet.m_vertexY));
+	const __m256 tz = _mm256_sub_ps(_mm256_set1_ps(ray.m_origin[2]), _mm256_load_ps(packet.m_vertexZ));
+	const __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)),
+		inverseDeterminant);
+
+	const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, edge1Z), _mm256_mul_ps(tz, edge1Y));
+	const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, edge1X), _mm256_mul_ps(tx, edge1Z));
+	const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, edge1Y), _mm256_mul_ps(ty, edge1X));
+	const __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, qx), _mm256_mul_ps(directionY, qy)),
+		_mm256_mul_ps(directionZ, qz)), inverseDeterminant);
+	const __m256 distance = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge2X, qx), _mm256_mul_ps(edge2Y, qy)),
+		_mm256_mul_ps(edge2Z, qz)), inverseDeterminant);
+
+	__m256 mask = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+	mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(distance, zero, _CMP_GE_OQ),
+		_mm256_cmp_ps(distance, _mm256_set1_ps(closestDistance), _CMP_LT_OQ)));
+
+	_mm256_store_ps(hits.m_distances, distance);
+	_mm256_store_ps(hits.m_u, u);
+	_mm256_store_ps(hits.m_v, v);
+	return static_cast<uint32_t>(_mm256_movemask_ps(mask));
+}
+
+#endif
+
+// AVX tests a packet in one pass instead of two. The box tests of the traversal dominate either way,
+// the triangle-ray benchmark has AVX closest hit queries level with SSE or up to 10% ahead.
+IntersectPacketFunc GetIntersectPacketFunc(bool useAVX) {
+#if CD_ARCH_X86
+	return useAVX && CpuFeatures::Get().m_avx2 ? IntersectPacketAVX : IntersectPacketSSE;
+#else
+	return IntersectPacketScalar;
+#endif
+}
+
+// Slab test, returns the entry distance or infinity when the box is missed or further than maxDistance.
+float IntersectBox(const SceneBVHNode &node, const RayData &ray, float maxDistance) {
+	float entry = 0.0f;
+	float exit = maxDistance;
+	for(uint32_t axis = 0; axis < 3; ++axis) {
+		const float t0 = (node.m_min[axis] - ray.m_origin[axis]) * ray.m_inverseDirection[axis];
+		const float t1 = (node.m_max[axis] - ray.m_origin[axis]) * ray.m_inverseDirection[axis];
+		entry = std::max(entry, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+}
+
+void TriangleBVH::Build(const cd::Mesh &mesh, std::size_t threadCount) {
+	Build(mesh.GetVertexPositions(), mesh.GetPolygons(), threadCount);
+}
+
+void TriangleBVH::Build(const std::vector<cd::Point> &positions, const std::vector<cd::Polygon> &polygons, std::size_t threadCount) {
+	m_triangleCount = static_cast<uint32_t>(polygons.size());
+
+	CullingBoxes triangleBoxes;
+	triangleBoxes.Reserve(m_triangleCount);
+	for(const cd::Polygon &polygon : polygons) {
+		const cd::Point &a = positions[polygon[0].Data()];
+		const cd::Point &b = positions[polygon[1].Data()];
+		const cd::Point &c = positions[polygon[2].Data()];
+		const glm::vec3 boxMin(std::min({ a.x(), b.x(), c.x() }), std::min({ a.y(), b.y(), c.y() }), std::min({ a.z(), b.z(), c.z() }));
+		const glm::vec3 boxMax(std::max({ a.x(), b.x(), c.x() }), std::max({ a.y(), b.y(), c.y() }), std::max({ a.z(), b.z(), c.z() }));
+		triangleBoxes.Add((boxMin + boxMax) * 0.5f, (boxMax - boxMin) * 0.5f);
+	}
+
+	SceneBVH bvh;
+	bvh.Build(triangleBoxes, threadCount, TrianglePacket::Width);
+
+	// Leaves rarely exceed MaxLeafItemCount, which is the packet width, so almost all of them become exactly one packet.
+	static_assert(SceneBVH::MaxLeafItemCount == TrianglePacket::Width, "Leaves should fill one triangle packet.");
+	m_nodes = bvh.GetNodes();
+	m_packets.clear();
+	m_packets.reserve(m_triangleCount / 2);
+	for(SceneBVHNode &node : m_nodes) {
+		if(!node.IsLeaf()) {
+			continue;
+		}
+
+		const uint32_t firstPacket = static_cast<uint32_t>(m_packets.size());
+		for(uint32_t itemOffset = 0; itemOffset < node.m_itemCount; ++itemOffset) {
+			const uint32_t lane = itemOffset % TrianglePacket::Width;
+			if(0 == lane) {
+				TrianglePacket &packet = m_packets.emplace_back();
+				std::fill(std::begin(packet.m_triangleIndices), std::end(packet.m_triangleIndices), UINT32_MAX);
+			}
+
+			const uint32_t triangleIndex = bvh.GetItemIndices()[node.m_leftOrFirst + itemOffset];
+			const cd::Polygon &polygon = polygons[triangleIndex];
+			const cd::Point &a = positions[polygon[0].Data()];
+			const cd::Point edge1 = positions[polygon[1].Data()] - a;
+			const cd::Point edge2 = positions[polygon[2].Data()] - a;
+
+			TrianglePacket &packet = m_packets.back();
+			packet.m_vertexX[lane] = a.x();
+			packet.m_vertexY[lane] = a.y();
+			packet.m_vertexZ[lane] = a.z();
+			packet.m_edge1X[lane] = edge1.x();
+			packet.m_edge1Y[lane] = edge1.y();
+			packet.m_edge1Z[lane] = edge1.z();
+			packet.m_edge2X[lane] = edge2.x();
+			packet.m_edge2Y[lane] = edge2.y();
+			packet.m_edge2Z[lane] = edge2.z();
+			packet.m_triangleIndices[lane] = triangleIndex;
+		}
+
+		node.m_leftOrFirst = firstPacket;
+		node.m_itemCount = static_cast<uint32_t>(m_packets.size()) - firstPacket;
+	}
+}
+
+void TriangleBVH::Clear() {
+	m_nodes.clear();
+	m_packets.clear();
+	m_triangleCount = 0;
+}
+
+TriangleHit TriangleBVH::Raycast(const cd::Ray &ray, float maxDistance) const {
+	return Traverse<false>(ray, maxDistance);
+}
+
+bool TriangleBVH::IsOccluded(const cd::Ray &ray, float maxDistance) const {
+	return Traverse<true>(ray, maxDistance).IsValid();
+}
+
+template<bool AnyHit>
+TriangleHit TriangleBVH::Traverse(const cd::Ray &ray, float maxDistance) const {
+	TriangleHit hit;
+	hit.m_distance = maxDistance;
+	if(m_nodes.empty()) {
+		return hit;
+	}
+
+	// Axis parallel directions give infinite inverses, which the slab test handles.
+	RayData rayData;
+	for(uint32_t axis = 0; axis < 3; ++axis) {
+		rayData.m_origin[axis] = ray.Origin()[axis];
+		rayData.m_direction[axis] = ray.Direction()[axis];
+		rayData.m_inverseDirection[axis] = 1.0f / ray.Direction()[axis];
+	}
+	if(IntersectBox(m_nodes[0], rayData, hit.m_distance) == std::numeric_limits<float>::infinity()) {
+		return hit;
+	}
+
+	const IntersectPacketFunc intersectPacket = GetIntersectPacketFunc(m_useAVX);
+	PacketHits packetHits;
+
+	// Nodes and their entry distances, the nearer child is pushed last so that it is visited first.
+	// Plain arrays, an array of std::pair would be zeroed on every call.
+	uint32_t stackNodes[SceneBVH::MaxDepth + 2];
+	float stackDistances[SceneBVH::MaxDepth + 2];
+	uint32_t stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackDistances[stackSize++] = 0.0f;
+	while(stackSize > 0) {
+		--stackSize;
+		const uint32_t nodeIndex = stackNodes[stackSize];
+		const float entryDistance = stackDistances[stackSize];
+		if(entryDistance >= hit.m_distance) {
+			continue;
+		}
+
+		const SceneBVHNode &node = m_nodes[nodeIndex];
+		if(node.IsLeaf()) {
+			for(uint32_t packetIndex = node.m_leftOrFirst; packetIndex < node.m_leftOrFirst + node.m_itemCount; ++packetIndex) {
+				const uint32_t hitMask = intersectPacket(m_packets[packetIndex], rayData, hit.m_distance, packetHits);
+				for(uint32_t lane = 0; hitMask != 0 && lane < TrianglePacket::Width; ++lane) {
+					if((hitMask & (1u << lane)) && packetHits.m_distances[lane] < hit.m_distance) {
+						hit.m_triangleIndex = m_packets[packetIndex].m_triangleIndices[lane];
+						hit.m_distance = packetHits.m_distances[lane];
+						hit.m_u = packetHits.m_u[lane];
+						hit.m_v = packetHits.m_v[lane];
+					}
+				}
+				if(AnyHit && hit.IsValid()) {
+					return hit;
+				}
+			}
+			continue;
+		}
+
+		const uint32_t leftIndex = node.m_leftOrFirst;
+		const uint32_t rightIndex = leftIndex + 1;
+		float nearDistance = IntersectBox(m_nodes[leftIndex], rayData, hit.m_distance);
+		float farDistance = IntersectBox(m_nodes[rightIndex], rayData, hit.m_distance);
+		uint32_t nearIndex = leftIndex;
+		uint32_t farIndex = rightIndex;
+		if(farDistance < nearDistance) {
+			std::swap(nearDistance, farDistance);
+			std::swap(nearIndex, farIndex);
+		}
+		if(farDistance != std::numeric_limits<float>::infinity()) {
+			stackNodes[stackSize] = farIndex;
+			stackDistances[stackSize++] = farDistance;
+		}
+		if(nearDistance != std::numeric_limits<float>::infinity()) {
+			stackNodes[stackSize] = nearIndex;
+			stackDistances[stackSize++] = nearDistance;
+		}
+	}
+
+	return hit;
+}
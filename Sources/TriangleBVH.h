@@ -0,0 +1,89 @@
+#pragma once
+
+#include "SceneBVH.h"
+
+#include "Math/Ray.hpp"
+#include "Scene/VertexAttribute.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cd
+{
+
+class Mesh;
+
+}
+
+struct TriangleHit
+{
+	uint32_t m_triangleIndex = UINT32_MAX;
+	float m_distance = std::numeric_limits<float>::infinity();
+
+	// Barycentric coordinates of the hit point, the first vertex's weight is 1 - u - v.
+	float m_u = 0.0f;
+	float m_v = 0.0f;
+
+	bool IsValid() const { return m_triangleIndex != UINT32_MAX; }
+};
+
+// Up to PacketWidth triangles in SoA layout, as the first vertex and the two edges from it which Moller-Trumbore uses.
+// Unused lanes have zero edges, which never hit.
+struct alignas(32) TrianglePacket
+{
+	static constexpr uint32_t Width = 8;
+
+	float m_vertexX[Width];
+	float m_vertexY[Width];
+	float m_vertexZ[Width];
+	float m_edge1X[Width];
+	float m_edge1Y[Width];
+	float m_edge1Z[Width];
+	float m_edge2X[Width];
+	float m_edge2Y[Width];
+	float m_edge2Z[Width];
+	uint32_t m_triangleIndices[Width];
+};
+
+// Ray casts against the triangles of one mesh. The hierarchy is built by SceneBVH over the triangle bounds,
+// then each leaf's triangles are packed so that one leaf is tested 8 triangles at a time with AVX, or 4 with SSE.
+class TriangleBVH
+{
+public:
+	TriangleBVH() = default;
+	TriangleBVH(const TriangleBVH&) = delete;
+	TriangleBVH& operator=(const TriangleBVH&) = delete;
+	TriangleBVH(TriangleBVH&&) = default;
+	TriangleBVH& operator=(TriangleBVH&&) = default;
+	~TriangleBVH() = default;
+
+	// threadCount 0 means GetDefaultThreadCount(), pass 1 when building many meshes in parallel already.
+	void Build(const cd::Mesh &mesh, std::size_t threadCount = 0);
+	void Build(const std::vector<cd::Point> &positions, const std::vector<cd::Polygon> &polygons, std::size_t threadCount = 0);
+
+	void Clear();
+
+	// Leaves are tested with AVX on CPUs which have it, false keeps them on SSE to compare the two.
+	void SetUseAVX(bool useAVX) { m_useAVX = useAVX; }
+
+	uint32_t GetTriangleCount() const { return m_triangleCount; }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+	uint32_t GetPacketCount() const { return static_cast<uint32_t>(m_packets.size()); }
+
+	// Closest triangle along the ray within maxDistance, in units of the ray direction's length. Both faces are hit.
+	TriangleHit Raycast(const cd::Ray &ray, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	// Whether any triangle is hit within maxDistance, which stops at the first hit for visibility tests.
+	bool IsOccluded(const cd::Ray &ray, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+private:
+	template<bool AnyHit>
+	TriangleHit Traverse(const cd::Ray &ray, float maxDistance) const;
+
+	// Same layout as SceneBVH, but leaves point at m_itemCount packets from m_leftOrFirst.
+	std::vector<SceneBVHNode> m_nodes;
+	std::vector<TrianglePacket> m_packets;
+	uint32_t m_triangleCount = 0;
+	bool m_useAVX = true;
+};
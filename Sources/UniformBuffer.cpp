@@ -0,0 +1,52 @@
+#include "UniformBuffer.h"
+
+#include "Scene/Light.h"
+
+#include <algorithm>
+#include <cstdio>
+
+std::size_t FillLightBlock(const std::vector<cd::Light> &lights, LightBlock &lightBlock) {
+	const uint32_t lightCount = static_cast<uint32_t>(std::min<std::size_t>(lights.size(), MaxLightCount));
+	if(lightCount < lights.size()) {
+		static bool s_warned = false;
+		if(!s_warned) {
+			printf("Scene has %zu lights, only the first %u are shaded.\n", lights.size(), MaxLightCount);
+			s_warned = true;
+		}
+	}
+
+	lightBlock.m_lightCount = static_cast<int32_t>(lightCount);
+	for(uint32_t lightIndex = 0; lightIndex < lightCount; ++lightIndex) {
+		const cd::Light &light = lights[lightIndex];
+		LightUniforms &uniforms = lightBlock.m_lights[lightIndex];
+		uniforms.m_position = { light.GetPosition().x(), light.GetPosition().y(), light.GetPosition().z() };
+		uniforms.m_range = light.GetRange();
+		uniforms.m_color = { light.GetColor().x(), light.GetColor().y(), light.GetColor().z() };
+		uniforms.m_intensity = light.GetIntensity();
+		uniforms.m_direction = { light.GetDirection().x(), light.GetDirection().y(), light.GetDirection().z() };
+		uniforms.m_type = static_cast<int32_t>(light.GetType());
+	}
+
+	return offsetof(LightBlock, m_lights) + lightCount * sizeof(LightUniforms);
+}
+
+UniformBuffer::UniformBuffer(UniformBlockBinding binding, std::size_t size) :
+	m_size(size) {
+	glGenBuffers(1, &m_id);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_size), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(binding), m_id);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer() {
+	glDeleteBuffers(1, &m_id);
+}
+
+void UniformBuffer::Update(const void *pData, std::size_t size) {
+	size = std::min(size, m_size);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_size), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), pData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cd
+{
+
+class Light;
+
+}
+
+// Binding points of the uniform blocks shared by the shaders, see Shader::BindUniformBlock.
+enum class UniformBlockBinding : GLuint
+{
+	Frame = 0,
+	Lights = 1,
+};
+
+// std140 layout of FrameBlock in vs_PBR.glsl and fs_PBR.glsl.
+struct FrameUniforms
+{
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	glm::vec3 m_cameraPosition;
+
+	// Maps fragments to light clusters, see LightClusterBuilder.
+	float m_clusterSliceScale;
+	glm::vec2 m_framebufferSize;
+	float m_clusterSliceBias;
+	float m_padding;
+	glm::ivec4 m_clusterGrid;
+};
+static_assert(offsetof(FrameUniforms, m_clusterSliceScale) == 140 && offsetof(FrameUniforms, m_clusterGrid) == 160 && sizeof(FrameUniforms) == 176,
+	"FrameUniforms must match the std140 layout of FrameBlock.");
+
+// std140 layout of Light in fs_PBR.glsl, a float or int after a vec3 shares its 16 byte slot.
+struct LightUniforms
+{
+	glm::vec3 m_position;
+	float m_range;
+	glm::vec3 m_color;
+	float m_intensity;
+	glm::vec3 m_direction;
+	int32_t m_type;
+};
+static_assert(sizeof(LightUniforms) == 48, "LightUniforms must match the std140 layout of Light.");
+
+// Must match D_MAX_LIGHT_COUNT in fs_PBR.glsl.
+// 256 lights keep LightBlock within the 16 KiB which every GL implementation supports for a uniform block.
+constexpr uint32_t MaxLightCount = 256;
+
+// std140 layout of LightBlock in fs_PBR.glsl.
+struct LightBlock
+{
+	int32_t m_lightCount;
+	int32_t m_padding[3];
+	LightUniforms m_lights[MaxLightCount];
+};
+static_assert(sizeof(LightBlock) <= 16 * 1024, "LightBlock must fit in GL_MAX_UNIFORM_BLOCK_SIZE.");
+
+// Converts the scene lights to LightBlock and returns the number of bytes to upload, which only covers the used lights.
+// Lights beyond MaxLightCount are dropped.
+std::size_t FillLightBlock(const std::vector<cd::Light> &lights, LightBlock &lightBlock);
+
+// Uniform buffer object bound to a fixed binding point for the lifetime of the object.
+class UniformBuffer
+{
+public:
+	UniformBuffer() = delete;
+	UniformBuffer(UniformBlockBinding binding, std::size_t size);
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+	UniformBuffer(UniformBuffer&&) = delete;
+	UniformBuffer& operator=(UniformBuffer&&) = delete;
+	~UniformBuffer();
+
+	// Replaces the first size bytes of the buffer with one glBufferSubData call.
+	// The storage is orphaned first, so the driver doesn't stall on draws of the previous frame which still read it.
+	void Update(const void *pData, std::size_t size);
+
+	template<typename T>
+	void Update(const T &data) { Update(&data, sizeof(T)); }
+
+	GLuint GetID() const { return m_id; }
+
+private:
+	GLuint m_id = 0;
+	std::size_t m_size;
+};
@@ -5,6 +5,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "GLMeshArena.h"
 #include "Scene/SceneDatabase.h"
 
 struct GLVertex {
@@ -21,20 +22,19 @@ struct GLTexture {
     std::string m_path;
 };
 
+// Geometry lives in a GLMeshArena shared with the other meshes of the scene, a GLMesh only knows its range.
+// Meshes are drawn through a RenderQueue.
 class GLMesh {
 public:
     GLMesh() = default;
-    GLMesh(std::vector<GLVertex> &vertices, std::vector<unsigned int> &indices, std::vector<GLTexture> &textures);
+    GLMesh(GLMeshArena &arena, const std::vector<GLVertex> &vertices, const std::vector<unsigned int> &indices, std::vector<GLTexture> &textures, const cd::AABB &bounds);
 
-    void Draw(const Shader &shader) const;
+    // Texture of the material slot, 0 if the material has none.
+    GLuint GetTexture(cd::MaterialTextureType type) const;
 
-    std::vector<GLVertex> m_vertices;
-    std::vector<unsigned int> m_indices;
+    GLMeshRange m_range;
     std::vector<GLTexture> m_textures;
-    unsigned int m_VAO;
 
-private:
-    void SetupMesh();
-    
-    unsigned int m_VBO, m_EBO;
+    // Local space bounds for frustum culling, the cd::Mesh AABB.
+    cd::AABB m_bounds = cd::AABB::Empty();
 };
@@ -1,17 +1,213 @@
 #include "scene.h"
 
+#include "AssetCache.h"
+#include "ParallelFor.h"
+#include "SceneChunkFile.h"
+#include "TextureBaker.h"
+#include "Utilities/PerformanceProfiler.h"
+
+namespace
+{
+
+// Bump when anything which changes the cached scene changes, such as processor settings, the chunk writer options
+// or the texture baking.
+constexpr const char SceneCacheOptions[] = "SceneChunkFile v2 compress quantize, BC textures v2";
+constexpr const char SceneCacheExtension[] = ".cdck";
+
+}
+
 void GLScene::LoadModel(const char *path) {
-	cdtools::CDProducer producer(path);
-	GLConsumer consumer("");
+	cdtools::PerformanceProfiler profiler("LoadModel");
+
+	// The cache keeps a compressed chunk file per source scene, which maps and decodes in parallel.
+	// Static meshes are stored quantized, they are decoded back to float streams by the chunk reader.
+	// Textures are baked for what this context samples, so that is part of the key.
+	TextureBakeOptions bakeOptions;
+	bakeOptions.m_useBC7 = GLAD_GL_VERSION_4_2 != 0;
+	AssetCache assetCache("AssetCache");
+	const std::string cacheKey = AssetCache::MakeKey(path, std::string(SceneCacheOptions) + (bakeOptions.m_useBC7 ? " BC7" : ""));
+	const std::optional<std::filesystem::path> cachedScenePath = assetCache.Find(cacheKey, SceneCacheExtension);
 
-	cdtools::Processor processor(&producer, &consumer, m_pScene);
-	processor.Run();
+	if(!m_pMeshArena) {
+		m_pMeshArena = std::make_unique<GLMeshArena>();
+		m_pRenderQueue = std::make_unique<RenderQueue>();
+		m_pTextureStreamer = std::make_unique<TextureStreamer>(m_threadPool);
+	}
+
+	std::unique_ptr<GLConsumer> pConsumer;
+	auto loadScene = [this, &pConsumer](const std::string &scenePath) {
+		MappedCDProducer producer(scenePath);
+		pConsumer = std::make_unique<GLConsumer>("", *m_pMeshArena, *m_pTextureStreamer);
+
+		// Quantized meshes of the cache decode into GL vertices on the reader's workers, instead of being expanded to
+		// float cd::Mesh streams and converted again by the consumer.
+		producer.SetQuantizedMeshCallback([pGLConsumer = pConsumer.get()](const QuantizedMesh &quantizedMesh) {
+			pGLConsumer->AddQuantizedMesh(quantizedMesh);
+		});
+
+		cdtools::Processor processor(&producer, pConsumer.get(), m_pScene);
+		processor.Run();
+		return !producer.HasFailed();
+	};
+
+	// A corrupt chunk file loads nothing, so the entry is dropped and rebuilt from the source.
+	const bool loadedFromCache = cachedScenePath && loadScene(cachedScenePath->string());
+	if(cachedScenePath && !loadedFromCache) {
+		printf("Rebuilding asset cache entry : %s\n", cachedScenePath->string().c_str());
+		assetCache.Remove(cacheKey, SceneCacheExtension);
+	}
 
-	m_meshes = consumer.GetMeshes();
+	if(!loadedFromCache && loadScene(path)) {
+		SceneChunkWriteOptions writeOptions;
+		writeOptions.m_compress = true;
+		writeOptions.m_quantizeMeshes = true;
+		// The entry holds baked copies of the image files, so editing one of them has to miss as well.
+		std::vector<std::filesystem::path> textureFilePaths;
+		for(const cd::Texture &texture : m_pScene->GetTextures()) {
+			textureFilePaths.emplace_back(GLConsumer::GetTextureFilePath(texture.GetPath()));
+		}
+		assetCache.Store(cacheKey, SceneCacheExtension, [this, &writeOptions, &bakeOptions](const std::filesystem::path &entryPath) {
+			// This load already uploaded the image files, the compressed mip chains are for the next ones.
+			for(cd::Texture &texture : m_pScene->GetTextures()) {
+				BakeTexture(texture, GLConsumer::GetTextureFilePath(texture.GetPath()).c_str(), bakeOptions);
+			}
+			const bool written = SceneChunkWriter::Write(*m_pScene, entryPath.string().c_str(), writeOptions);
+			for(cd::Texture &texture : m_pScene->GetTextures()) {
+				texture.ClearRawData();
+			}
+			return written;
+		}, textureFilePaths);
+	}
+
+	m_meshes = pConsumer->GetMeshes();
+	m_nodeTransforms.Build(*m_pScene);
+
+	// One mesh per thread, so each hierarchy builds on a single one.
+	m_triangleBVHs.clear();
+	m_triangleBVHs.resize(m_pScene->GetMeshCount());
+	ParallelFor(m_triangleBVHs.size(), [this](std::size_t meshIndex) {
+		m_triangleBVHs[meshIndex].Build(m_pScene->GetMesh(static_cast<uint32_t>(meshIndex)), 1);
+	});
+
+	m_meshesPlacedByNodes = false;
+	for(const cd::Node &node : m_pScene->GetNodes()) {
+		m_meshesPlacedByNodes |= node.GetMeshCount() > 0;
+	}
+
+	// Scenes whose nodes don't reference meshes place every mesh once at the root.
+	m_drawCandidates.clear();
+	if(!m_meshesPlacedByNodes) {
+		for(uint32_t meshIndex = 0; meshIndex < m_meshes.size(); ++meshIndex) {
+			m_drawCandidates.push_back({ meshIndex, SceneBVH::InvalidIndex, &m_nodeTransforms.GetRootMatrix() });
+		}
+	}
+	for(uint32_t nodeIndex : m_nodeTransforms.GetOrder()) {
+		const cd::Node &node = m_pScene->GetNode(nodeIndex);
+		for(const cd::MeshID &meshID : node.GetMeshIDs()) {
+			if(meshID.Data() < m_meshes.size()) {
+				m_drawCandidates.push_back({ meshID.Data(), nodeIndex, &m_nodeTransforms.GetWorldMatrix(nodeIndex) });
+			}
+		}
+	}
+	m_bvhBuilt = false;
 }
 
-void GLScene::Draw(const Shader &shader) const {
-	for(const auto &mesh : m_meshes) {
-		mesh.Draw(shader);
+void GLScene::SetNodeTransform(uint32_t nodeIndex, cd::Transform transform) {
+	if(nodeIndex >= m_pScene->GetNodeCount()) {
+		return;
 	}
+
+	m_pScene->GetNodes()[nodeIndex].SetTransform(cd::MoveTemp(transform));
+	m_nodeTransforms.MarkDirty(nodeIndex);
+}
+
+void GLScene::UpdateBounds() {
+	m_cullingBoxes.Clear();
+	m_cullingBoxes.Reserve(m_drawCandidates.size());
+	for(const DrawCandidate &candidate : m_drawCandidates) {
+		const GLMesh &mesh = m_meshes[candidate.m_meshIndex];
+		m_cullingBoxes.AddTransformed(mesh.m_bounds, *candidate.m_pWorldMatrix);
+	}
+
+	// Moved nodes only refit the hierarchy, it is rebuilt when a new scene is loaded.
+	if(m_bvhBuilt) {
+		m_bvh.Refit(m_cullingBoxes);
+	}
+	else {
+		m_bvh.Build(m_cullingBoxes, 0, FrustumCuller::GetBatchSize());
+		m_bvhBuilt = true;
+	}
+}
+
+void GLScene::Draw(const Shader &shader, const glm::mat4 &viewProjection) {
+	if(!m_pMeshArena) {
+		return;
+	}
+
+	m_pTextureStreamer->Update();
+
+	if(m_nodeTransforms.Update(*m_pScene) > 0 || !m_bvhBuilt) {
+		UpdateBounds();
+	}
+
+	m_frustumCuller.SetViewProjection(viewProjection);
+	m_visibleCandidates.clear();
+	m_bvh.QueryFrustum(m_frustumCuller, m_visibleCandidates);
+	m_cullingStats.m_testedBoxes = m_cullingBoxes.GetCount();
+	m_cullingStats.m_visibleBoxes = static_cast<uint32_t>(m_visibleCandidates.size());
+
+	m_pRenderQueue->Clear();
+	for(uint32_t candidateIndex : m_visibleCandidates) {
+		const DrawCandidate &candidate = m_drawCandidates[candidateIndex];
+		m_pRenderQueue->Submit(shader, m_meshes[candidate.m_meshIndex], *candidate.m_pWorldMatrix);
+	}
+	m_pRenderQueue->Flush(*m_pMeshArena);
+}
+
+ScenePickResult GLScene::Pick(const cd::Ray &ray) const {
+	// The local ray keeps the parameterization of the world one, so distances of different meshes compare directly.
+	ScenePickResult result;
+	const glm::vec3 worldOrigin(ray.Origin().x(), ray.Origin().y(), ray.Origin().z());
+	const glm::vec3 worldDirection(ray.Direction().x(), ray.Direction().y(), ray.Direction().z());
+	const SceneBVHHit hit = m_bvh.Raycast(ray, std::numeric_limits<float>::infinity(), [&](uint32_t candidateIndex, float closestDistance) {
+		const DrawCandidate &candidate = m_drawCandidates[candidateIndex];
+		if(candidate.m_meshIndex >= m_triangleBVHs.size()) {
+			return std::numeric_limits<float>::infinity();
+		}
+
+		const glm::mat4 worldToLocal = glm::inverse(*candidate.m_pWorldMatrix);
+		const glm::vec3 localOrigin = glm::vec3(worldToLocal * glm::vec4(worldOrigin, 1.0f));
+		const glm::vec3 localDirection = glm::vec3(worldToLocal * glm::vec4(worldDirection, 0.0f));
+		const cd::Ray localRay(cd::Point(localOrigin.x, localOrigin.y, localOrigin.z), cd::Direction(localDirection.x, localDirection.y, localDirection.z));
+		const TriangleHit triangleHit = m_triangleBVHs[candidate.m_meshIndex].Raycast(localRay, closestDistance);
+		if(!triangleHit.IsValid()) {
+			return std::numeric_limits<float>::infinity();
+		}
+
+		result.m_triangleIndex = triangleHit.m_triangleIndex;
+		result.m_u = triangleHit.m_u;
+		result.m_v = triangleHit.m_v;
+		return triangleHit.m_distance;
+	});
+
+	if(hit.IsValid()) {
+		result.m_nodeIndex = m_drawCandidates[hit.m_itemIndex].m_nodeIndex;
+		result.m_meshIndex = m_drawCandidates[hit.m_itemIndex].m_meshIndex;
+		result.m_distance = hit.m_distance;
+	}
+	else {
+		result.m_triangleIndex = SceneBVH::InvalidIndex;
+	}
+	return result;
+}
+
+void GLScene::Clear() {
+	m_meshes.clear();
+	m_drawCandidates.clear();
+	m_bvh.Clear();
+	m_bvhBuilt = false;
+	m_triangleBVHs.clear();
+	m_pRenderQueue.reset();
+	m_pTextureStreamer.reset();
+	m_pMeshArena.reset();
 }
@@ -4,38 +4,115 @@
 
 #include "Framework/IConsumer.h"
 #include "Scene/SceneDatabase.h"
-#include "Producers/CDProducer/CDProducer.h"
 #include "Framework/Processor.h"
+#include "FrustumCulling.h"
 #include "GLConsumer.h"
+#include "MappedCDProducer.h"
+#include "NodeTransformCache.h"
+#include "RenderQueue.h"
+#include "SceneBVH.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "TriangleBVH.h"
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
 
+// Closest triangle along a picking ray.
+struct ScenePickResult
+{
+	// Invalid for meshes which aren't placed by nodes.
+	uint32_t m_nodeIndex = SceneBVH::InvalidIndex;
+	uint32_t m_meshIndex = SceneBVH::InvalidIndex;
+	uint32_t m_triangleIndex = SceneBVH::InvalidIndex;
+	float m_distance = 0.0f;
+
+	// Barycentric coordinates in the triangle, see TriangleHit.
+	float m_u = 0.0f;
+	float m_v = 0.0f;
+
+	bool IsValid() const { return m_meshIndex != SceneBVH::InvalidIndex; }
+};
+
 class GLScene
 {
 public:
 	GLScene() { m_pScene = new cd::SceneDatabase(); }
 
 	cd::SceneDatabase *GetSene() { return m_pScene; }
+	// Workers for per frame jobs of the renderer, shared with texture decoding.
+	ThreadPool &GetThreadPool() { return m_threadPool; }
 
 	void LoadModel(const char *path);
 
 	void SetShader(const Shader &shader) { m_shader = shader; }
 
-	void Draw(const Shader &shader) const;
+	// Parent transform of the whole scene.
+	void SetRootTransform(const glm::mat4 &rootMatrix) { m_nodeTransforms.SetRootMatrix(rootMatrix); }
 
-private:
-	void DrawNode(const cd::Node &node) const;
-	void DrawMesh(const cd::Node &node) const;
+	// Changes the local transform of a node, only its subtree's world matrices are recomputed on the next Draw.
+	void SetNodeTransform(uint32_t nodeIndex, cd::Transform transform);
+
+	// Draws every mesh of every node with the node's world matrix.
+	// Meshes whose world space bounds are outside of the frustum of viewProjection are skipped.
+	// Textures still loading get their next upload band first, see TextureStreamer.
+	void Draw(const Shader &shader, const glm::mat4 &viewProjection);
+
+	bool IsStreamingTextures() const { return m_pTextureStreamer && m_pTextureStreamer->IsStreaming(); }
+	const TextureStreamStats &GetTextureStreamStats() const { return m_pTextureStreamer ? m_pTextureStreamer->GetStats() : m_emptyTextureStreamStats; }
 
+	// Counters of the last Draw.
+	const RenderStats &GetRenderStats() const { return m_pRenderQueue ? m_pRenderQueue->GetStats() : m_emptyRenderStats; }
+	const CullingStats &GetCullingStats() const { return m_cullingStats; }
+
+	// Closest triangle which the ray hits, with meshes placed as of the last Draw.
+	// The scene hierarchy finds candidate meshes, whose triangle hierarchies are then tested in local space.
+	ScenePickResult Pick(const cd::Ray &ray) const;
+
+	// Releases GL objects, call before the context goes away.
+	void Clear();
+
+private:
 	cd::SceneDatabase *m_pScene;
+	NodeTransformCache m_nodeTransforms;
+	bool m_meshesPlacedByNodes = false;
 
 	// Use it to manage the vertex buffer layout.
 	// The remaining data can be obtained from the SceneDatabase.
 	std::vector<GLMesh> m_meshes;
+	std::unique_ptr<GLMeshArena> m_pMeshArena;
+	std::unique_ptr<RenderQueue> m_pRenderQueue;
+	// Texture decode and light clustering workers, started with the scene and reused by every load and by the
+	// streamer recreated after Clear.
+	// Declared before the streamer, which is destroyed first.
+	ThreadPool m_threadPool;
+	std::unique_ptr<TextureStreamer> m_pTextureStreamer;
+	RenderStats m_emptyRenderStats;
+	TextureStreamStats m_emptyTextureStreamStats;
+
+	// Every placed mesh, found once per load, with world boxes at the same indices.
+	struct DrawCandidate
+	{
+		uint32_t m_meshIndex;
+		uint32_t m_nodeIndex;
+		const glm::mat4 *m_pWorldMatrix;
+	};
+	void UpdateBounds();
+
+	std::vector<DrawCandidate> m_drawCandidates;
+	CullingBoxes m_cullingBoxes;
+	SceneBVH m_bvh;
+
+	// Per mesh, for picking.
+	std::vector<TriangleBVH> m_triangleBVHs;
+	bool m_bvhBuilt = false;
+	std::vector<uint32_t> m_visibleCandidates;
+	FrustumCuller m_frustumCuller;
+	CullingStats m_cullingStats;
 
 	Shader m_shader;
 };
@@ -1,5 +1,7 @@
 #include "shader.h"
 
+#include <algorithm>
+
 Shader::Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath) {
     // 1. Read file
     std::string vertexCode;
@@ -65,6 +67,7 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath, const char *geo
     }
     glLinkProgram(m_id);
     CheckCompileErrors(m_id, "PROGRAM");
+    ReflectUniforms();
     glDeleteShader(vertex);
     glDeleteShader(fragment);
     if (geometryPath) {
@@ -76,41 +79,159 @@ void Shader::Use() const {
     glUseProgram(m_id);
 }
 
+void Shader::BindUniformBlock(const char *blockName, GLuint binding) const {
+    const GLuint blockIndex = glGetUniformBlockIndex(m_id, blockName);
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_id, blockIndex, binding);
+    }
+}
+
+UniformHandle Shader::GetUniform(std::string_view name) const {
+    const auto it = m_uniforms.find(UniformNameHash(name));
+    if (it == m_uniforms.end()) {
+        return UniformHandle();
+    }
+    if (!it->second.m_colliding) {
+        return it->second.m_name == name ? UniformHandle{ it->second.m_location } : UniformHandle();
+    }
+
+    for (const UniformEntry &entry : m_collidingUniforms) {
+        if (entry.m_name == name) {
+            return UniformHandle{ entry.m_location };
+        }
+    }
+    return UniformHandle();
+}
+
+UniformHandle Shader::GetUniform(uint32_t nameHash) const {
+    const auto it = m_uniforms.find(nameHash);
+    return it != m_uniforms.end() && !it->second.m_colliding ? UniformHandle{ it->second.m_location } : UniformHandle();
+}
+
+void Shader::SetBool(UniformHandle handle, bool value) const {
+    glUniform1i(handle.m_location, (int)value);
+}
+void Shader::SetInt(UniformHandle handle, int value) const {
+    glUniform1i(handle.m_location, value);
+}
+void Shader::SetFloat(UniformHandle handle, float value) const {
+    glUniform1f(handle.m_location, value);
+}
+void Shader::SetVec2(UniformHandle handle, const glm::vec2 &value) const {
+    glUniform2fv(handle.m_location, 1, &value[0]);
+}
+void Shader::SetVec3(UniformHandle handle, const glm::vec3 &value) const {
+    glUniform3fv(handle.m_location, 1, &value[0]);
+}
+void Shader::SetVec4(UniformHandle handle, const glm::vec4 &value) const {
+    glUniform4fv(handle.m_location, 1, &value[0]);
+}
+void Shader::SetMat2(UniformHandle handle, const glm::mat2 &mat) const {
+    glUniformMatrix2fv(handle.m_location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::SetMat3(UniformHandle handle, const glm::mat3 &mat) const {
+    glUniformMatrix3fv(handle.m_location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::SetMat4(UniformHandle handle, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(handle.m_location, 1, GL_FALSE, &mat[0][0]);
+}
+
 void Shader::SetBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(m_id, name.c_str()), (int)value);
+    SetBool(GetUniform(name), value);
 }
 void Shader::SetInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
+    SetInt(GetUniform(name), value);
 }
 void Shader::SetFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
+    SetFloat(GetUniform(name), value);
 }
 void Shader::SetVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    SetVec2(GetUniform(name), value);
 }
 void Shader::SetVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+    glUniform2f(GetUniform(name).m_location, x, y);
 }
 void Shader::SetVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    SetVec3(GetUniform(name), value);
 }
 void Shader::SetVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+    glUniform3f(GetUniform(name).m_location, x, y, z);
 }
 void Shader::SetVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    SetVec4(GetUniform(name), value);
 }
 void Shader::SetVec4(const std::string &name, float x, float y, float z, float w) const {
-    glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+    glUniform4f(GetUniform(name).m_location, x, y, z, w);
 }
 void Shader::SetMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SetMat2(GetUniform(name), mat);
 }
 void Shader::SetMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SetMat3(GetUniform(name), mat);
 }
 void Shader::SetMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SetMat4(GetUniform(name), mat);
+}
+
+void Shader::AddUniform(std::string_view name, GLint location) {
+    const auto [it, inserted] = m_uniforms.try_emplace(UniformNameHash(name), UniformEntry{ std::string(name), location, false });
+    if (inserted || it->second.m_name == name) {
+        it->second.m_location = location;
+        return;
+    }
+
+    printf("Uniforms %s and %.*s have the same name hash %u, only name lookups can tell them apart.\n",
+        it->second.m_name.c_str(), static_cast<int>(name.size()), name.data(), it->first);
+    if (!it->second.m_colliding) {
+        it->second.m_colliding = true;
+        m_collidingUniforms.push_back(it->second);
+    }
+    const auto collidingIt = std::find_if(m_collidingUniforms.begin(), m_collidingUniforms.end(),
+        [name](const UniformEntry &entry) { return entry.m_name == name; });
+    if (collidingIt != m_collidingUniforms.end()) {
+        collidingIt->m_location = location;
+    }
+    else {
+        m_collidingUniforms.push_back(UniformEntry{ std::string(name), location, true });
+    }
+}
+
+void Shader::ReflectUniforms() {
+    m_uniforms.clear();
+    m_collidingUniforms.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(static_cast<std::size_t>(maxNameLength), '\0');
+    for (GLint uniformIndex = 0; uniformIndex < uniformCount; ++uniformIndex) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_id, static_cast<GLuint>(uniformIndex), maxNameLength, &nameLength, &arraySize, &type, &name[0]);
+        const std::string_view uniformName(name.data(), static_cast<std::size_t>(nameLength));
+
+        // Uniforms in blocks have no location.
+        const GLint location = glGetUniformLocation(m_id, name.c_str());
+        if (location < 0) {
+            continue;
+        }
+        AddUniform(uniformName, location);
+
+        // Arrays of basic types are reported once as "name[0]", register "name" and every element as well.
+        // Arrays of structs are reported per member, e.g. "u_lights[1].position", so they are covered above.
+        constexpr std::string_view firstElementSuffix = "[0]";
+        if (uniformName.size() > firstElementSuffix.size() && uniformName.substr(uniformName.size() - firstElementSuffix.size()) == firstElementSuffix) {
+            const std::string baseName(uniformName.substr(0, uniformName.size() - firstElementSuffix.size()));
+            AddUniform(baseName, location);
+            for (GLint elementIndex = 1; elementIndex < arraySize; ++elementIndex) {
+                const std::string elementName = baseName + '[' + std::to_string(elementIndex) + ']';
+                AddUniform(elementName, glGetUniformLocation(m_id, elementName.c_str()));
+            }
+        }
+    }
 }
 
 void Shader::CheckCompileErrors(const GLuint shader, const std::string type) {
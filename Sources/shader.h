@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "Hashers/StringHash.hpp"
+
+// Pre-resolved uniform location, from Shader::GetUniform.
+// Setters taking a handle neither hash a name nor ask the driver, so resolve handles once outside of frame loops.
+struct UniformHandle
+{
+    GLint m_location = -1;
+
+    bool IsValid() const { return m_location >= 0; }
+};
+
+// Key of a uniform name in the location table, usable at compile time for literal names.
+constexpr uint32_t UniformNameHash(std::string_view name) {
+    return cd::StringHash<uint32_t>(name);
+}
+
 class Shader
 {
 public:
@@ -16,6 +36,27 @@ public:
 
     void Use() const;
 
+    // Connects a uniform block of the program to a buffer binding point, GLSL 330 has no layout(binding).
+    // Blocks which the program doesn't use are ignored.
+    void BindUniformBlock(const char *blockName, GLuint binding) const;
+
+    // Handles of uniforms which aren't active in the program are invalid, setting them is a no-op like in GL.
+    UniformHandle GetUniform(std::string_view name) const;
+    // Hashes shared by several active uniforms can't tell them apart and return an invalid handle.
+    // Those are reported when the program is linked, look them up by name instead.
+    UniformHandle GetUniform(uint32_t nameHash) const;
+
+    void SetBool(UniformHandle handle, bool value) const;
+    void SetInt(UniformHandle handle, int value) const;
+    void SetFloat(UniformHandle handle, float value) const;
+    void SetVec2(UniformHandle handle, const glm::vec2 &value) const;
+    void SetVec3(UniformHandle handle, const glm::vec3 &value) const;
+    void SetVec4(UniformHandle handle, const glm::vec4 &value) const;
+    void SetMat2(UniformHandle handle, const glm::mat2 &mat) const;
+    void SetMat3(UniformHandle handle, const glm::mat3 &mat) const;
+    void SetMat4(UniformHandle handle, const glm::mat4 &mat) const;
+
+    // Name based setters look the name up in the location table, prefer handles in hot loops.
     void SetBool(const std::string &name, bool value) const;
     void SetInt(const std::string &name, int value) const;
     void SetFloat(const std::string &name, float value) const;
@@ -33,4 +74,17 @@ public:
 
 private:
     void CheckCompileErrors(const GLuint shader, const std::string type);
+    void ReflectUniforms();
+    void AddUniform(std::string_view name, GLint location);
+
+    struct UniformEntry
+    {
+        std::string m_name;
+        GLint m_location;
+        // Another active uniform has the same hash, the entries of all of them are in m_collidingUniforms.
+        bool m_colliding;
+    };
+
+    std::unordered_map<uint32_t, UniformEntry> m_uniforms;
+    std::vector<UniformEntry> m_collidingUniforms;
 };